@@ -0,0 +1,286 @@
+/******************************************************************************
+ * boundedqueue.hpp
+ *
+ * Project:  terrace - A library for processing of Lidar
+ *           data.
+ * Purpose:  Bounded lock-free queue for any number of producers and
+ *           consumers (D. Vyukov's array based queue). Used to connect
+ *           stages of pipelined processing. Blocking push and pop spin
+ *           shortly and then sleep until the queue changes.
+ * Author:   Vladimir Pajic, pajicv@gmail.com
+ *
+ ******************************************************************************
+ * Copyright (c) 2014, Vladimir Pajic
+ *
+ *****************************************************************************/
+
+#ifndef TERRACE_BOUNDEDQUEUE_HPP_INCLUDED
+#define TERRACE_BOUNDEDQUEUE_HPP_INCLUDED
+
+///////////////////////////////////////////////////////////////////////////////
+// Included dependacies
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////
+// Actual class
+
+namespace terrace
+{
+namespace util
+{
+
+template <class T>
+class BoundedQueue
+{
+public:
+
+	/// Creates empty queue.
+	/// \param theCapacity maximal number of elements, rounded up to
+	/// power of two
+	explicit BoundedQueue(std::size_t theCapacity);
+
+	/// Adds element if queue is not full.
+	/// \return false if queue is full
+	bool tryPush(const T& theValue);
+
+	/// Removes element if queue is not empty.
+	/// \return false if queue is empty
+	bool tryPop(T& theValue);
+
+	/// Adds element, waits while queue is full
+	void push(const T& theValue);
+
+	/// Removes element, waits while queue is empty
+	T pop();
+
+	/// Number of failed attempts before blocking push or pop sleeps
+	static const unsigned int SPIN_LIMIT = 64;
+
+private:
+
+	// Not copyable
+	BoundedQueue(const BoundedQueue&);
+	BoundedQueue& operator=(const BoundedQueue&);
+
+	/// Smallest power of two not less than theCapacity
+	static std::size_t roundCapacity(std::size_t theCapacity);
+
+	/// Adds element without waking sleeping threads
+	bool insert(const T& theValue);
+
+	/// Removes element without waking sleeping threads
+	bool remove(T& theValue);
+
+	/// Wakes threads sleeping in push or pop after queue changed
+	void notify();
+
+	struct Slot
+	{
+		std::atomic<std::size_t> sequence;
+		T value;
+	};
+
+	/// Keeps frequently written positions on separate cache lines
+	static const std::size_t CACHE_LINE = 64;
+
+	std::vector<Slot> mSlots;
+	std::size_t mMask;
+	char mPad0[CACHE_LINE];
+	std::atomic<std::size_t> mHead;
+	char mPad1[CACHE_LINE];
+	std::atomic<std::size_t> mTail;
+	char mPad2[CACHE_LINE];
+
+	/// Number of threads sleeping in push or pop
+	std::atomic<unsigned int> mSleeping;
+	std::mutex mMutex;
+	std::condition_variable mChanged;
+
+}; // class BoundedQueue
+
+///////////////////////////////////////////////////////////////////////////////
+// Implementation
+
+template <class T>
+std::size_t BoundedQueue<T>::roundCapacity(std::size_t theCapacity)
+{
+	std::size_t capacity = 2;
+	while(capacity < theCapacity)
+	{
+		capacity *= 2;
+	}
+	return capacity;
+}
+
+template <class T>
+BoundedQueue<T>::BoundedQueue(std::size_t theCapacity) : 
+	mSlots(roundCapacity(theCapacity)), 
+	mMask(roundCapacity(theCapacity) - 1), 
+	mHead(0), 
+	mTail(0),
+	mSleeping(0)
+{
+	for(std::size_t i = 0; i < mSlots.size(); ++i)
+	{
+		mSlots[i].sequence.store(i, std::memory_order_relaxed);
+	}
+}
+
+template <class T>
+bool BoundedQueue<T>::tryPush(const T& theValue)
+{
+	if(!insert(theValue))
+	{
+		return false;
+	}
+	notify();
+	return true;
+}
+
+template <class T>
+bool BoundedQueue<T>::tryPop(T& theValue)
+{
+	if(!remove(theValue))
+	{
+		return false;
+	}
+	notify();
+	return true;
+}
+
+template <class T>
+bool BoundedQueue<T>::insert(const T& theValue)
+{
+	std::size_t position = mTail.load(std::memory_order_relaxed);
+	for(;;)
+	{
+		Slot& slot = mSlots[position & mMask];
+		std::size_t sequence = slot.sequence.load(std::memory_order_acquire);
+		std::ptrdiff_t difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position);
+
+		if(difference == 0)
+		{
+			if(mTail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+			{
+				slot.value = theValue;
+				slot.sequence.store(position + 1, std::memory_order_release);
+				return true;
+			}
+		}
+		else if(difference < 0)
+		{
+			// Full
+			return false;
+		}
+		else
+		{
+			position = mTail.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+template <class T>
+bool BoundedQueue<T>::remove(T& theValue)
+{
+	std::size_t position = mHead.load(std::memory_order_relaxed);
+	for(;;)
+	{
+		Slot& slot = mSlots[position & mMask];
+		std::size_t sequence = slot.sequence.load(std::memory_order_acquire);
+		std::ptrdiff_t difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position + 1);
+
+		if(difference == 0)
+		{
+			if(mHead.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+			{
+				theValue = slot.value;
+				slot.sequence.store(position + mMask + 1, std::memory_order_release);
+				return true;
+			}
+		}
+		else if(difference < 0)
+		{
+			// Empty
+			return false;
+		}
+		else
+		{
+			position = mHead.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+template <class T>
+void BoundedQueue<T>::push(const T& theValue)
+{
+	for(unsigned int i = 0; i < SPIN_LIMIT; ++i)
+	{
+		if(tryPush(theValue))
+		{
+			return;
+		}
+		std::this_thread::yield();
+	}
+
+	std::unique_lock<std::mutex> lock(mMutex);
+	mSleeping.fetch_add(1);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	while(!insert(theValue))
+	{
+		mChanged.wait(lock);
+	}
+	mSleeping.fetch_sub(1);
+	lock.unlock();
+	notify();
+}
+
+template <class T>
+T BoundedQueue<T>::pop()
+{
+	T value;
+	for(unsigned int i = 0; i < SPIN_LIMIT; ++i)
+	{
+		if(tryPop(value))
+		{
+			return value;
+		}
+		std::this_thread::yield();
+	}
+
+	std::unique_lock<std::mutex> lock(mMutex);
+	mSleeping.fetch_add(1);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	while(!remove(value))
+	{
+		mChanged.wait(lock);
+	}
+	mSleeping.fetch_sub(1);
+	lock.unlock();
+	notify();
+	return value;
+}
+
+template <class T>
+void BoundedQueue<T>::notify()
+{
+	// Sleeper registers before it checks the queue again, so either it
+	// sees the change or the change sees it. Sleeper holds the mutex 
+	// until it waits, so the notification cannot come in between.
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if(mSleeping.load(std::memory_order_relaxed) > 0)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mChanged.notify_all();
+	}
+}
+
+}
+} // namespace terrace::util
+
+#endif // TERRACE_BOUNDEDQUEUE_HPP_INCLUDED
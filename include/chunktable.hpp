@@ -0,0 +1,84 @@
+/******************************************************************************
+ * chunktable.hpp
+ *
+ * Project:  terrace - A library for processing of Lidar
+ *           data.
+ * Purpose:  Table of bounding boxes of fixed size chunks of point
+ *           records, stored in variable length records of LAS files
+ *           written in spatial order. Readers use it to decode only
+ *           the chunks a region needs.
+ * Author:   Vladimir Pajic, pajicv@gmail.com
+ *
+ ******************************************************************************
+ * Copyright (c) 2014, Vladimir Pajic
+ *
+ *****************************************************************************/
+
+#ifndef TERRACE_CHUNKTABLE_HPP_INCLUDED
+#define TERRACE_CHUNKTABLE_HPP_INCLUDED
+
+///////////////////////////////////////////////////////////////////////////////
+// Included dependacies
+
+#include <vector>
+
+#include <stdint.h>
+
+#include "lasformat.hpp"
+#include "lasreader.hpp"
+#include "region.hpp"
+
+///////////////////////////////////////////////////////////////////////////////
+// Actual class
+
+namespace terrace
+{
+namespace lidar
+{
+
+///
+/// Every entry holds first record and number of records of chunk (uint32)
+/// followed by minimal and maximal quantized X, Y, Z (int32). Entries are
+/// split over as many variable length records as needed, all with the
+/// same user and record id, in the order of chunks.
+///
+class ChunkTable
+{
+public:
+
+	/// User id of variable length records holding the table
+	static const char* const USER_ID;
+
+	/// Record id of variable length records holding the table
+	static const uint16_t RECORD_ID = 1000;
+
+	/// Size of one entry in bytes
+	static const std::size_t ENTRY_SIZE = 32;
+
+	/// Encodes chunk bounds into variable length records.
+	/// \param theChunks chunks in file order
+	/// \param[out] theVlrs records are appended
+	static void encode(const std::vector<ChunkSummary>& theChunks, std::vector<las::VariableLengthRecord>& theVlrs);
+
+	/// Decodes chunk bounds from variable length records of a file.
+	/// \param theVlrs all variable length records of file
+	/// \param[out] theChunks chunks in file order, class counts are not stored
+	/// \return false if there is no chunk table
+	static bool decode(const std::vector<las::VariableLengthRecord>& theVlrs, std::vector<ChunkSummary>& theChunks);
+
+	/// Record ranges of the chunks whose bounds intersect region.
+	/// \param theChunks decoded chunk table
+	/// \param theHeader header with scales and offsets of the file
+	/// \param theRegion region of interest
+	/// \param[out] theRanges ranges in file order, adjacent chunks are merged
+	static void query(const std::vector<ChunkSummary>& theChunks,
+					  const las::Header& theHeader,
+					  const Region& theRegion,
+					  std::vector<RecordRange>& theRanges);
+
+}; // class ChunkTable
+
+}
+} // namespace terrace::lidar
+
+#endif // TERRACE_CHUNKTABLE_HPP_INCLUDED
@@ -0,0 +1,97 @@
+/******************************************************************************
+ * datasetcache.hpp
+ *
+ * Project:  terrace - A library for processing of Lidar
+ *           data.
+ * Purpose:  Binary cache of loaded lidar data set. Holds quantized
+ *           coordinates, classification, metadata, estimated point
+ *           density and grid index, so the data set can be reopened
+ *           without decoding the source file and rebuilding the index.
+ * Author:   Vladimir Pajic, pajicv@gmail.com
+ *
+ ******************************************************************************
+ * Copyright (c) 2014, Vladimir Pajic
+ *
+ *****************************************************************************/
+
+#ifndef TERRACE_DATASETCACHE_HPP_INCLUDED
+#define TERRACE_DATASETCACHE_HPP_INCLUDED
+
+///////////////////////////////////////////////////////////////////////////////
+// Included dependacies
+
+#include <string>
+
+#include <stdint.h>
+
+///////////////////////////////////////////////////////////////////////////////
+// Actual class
+
+namespace terrace
+{
+namespace lidar
+{
+
+class LidarDataset;
+struct LoadOptions;
+
+///
+/// Cache file starts with fixed size header followed by sections
+/// aligned to SECTION_ALIGNMENT bytes:
+/// X, Y, Z (int32 each), classification (uint8), cell offsets
+/// (uint32, rows * columns + 1) and cell point indices (uint32).
+/// Cell offsets and indices are grid index in compressed row form:
+/// points of cell i are indices[offsets[i]] ... indices[offsets[i + 1] - 1].
+///
+class DatasetCache
+{
+public:
+
+	/// Version of cache layout. Caches of other versions are ignored.
+	static const uint32_t VERSION = 4;
+
+	/// Alignment of sections in file
+	static const uint64_t SECTION_ALIGNMENT = 64;
+
+	/// Writes loaded data set to cache file.
+	/// \param theCache path to cache file
+	/// \param theOptions options the data set was loaded with
+	/// \param theDataset loaded data set
+	/// \return true if cache is written
+	static bool write(const std::string& theCache, const LoadOptions& theOptions, 
+					  const LidarDataset& theDataset);
+
+	/// Reads data set from cache file if cache is valid for source and
+	/// holds what the options ask for: grid index with requested cell
+	/// size (or estimated one if none is given) and points in requested
+	/// order (order of records, or reordered along requested curve).
+	/// \param theCache path to cache file
+	/// \param theSource path to LAS file the cache was created from
+	/// \param theOptions options the data set is loaded with
+	/// \param[out] theDataset data set that is not loaded yet
+	/// \return true if cache is valid and data set is read
+	static bool read(const std::string& theCache, const std::string& theSource, 
+					 const LoadOptions& theOptions, LidarDataset& theDataset);
+
+	/// Checksum of source file. Combines file size, complete header
+	/// and variable length records, and a sample of CHECKSUM_SAMPLES
+	/// evenly spaced blocks of the point data, so it is cheap to compute
+	/// even for very large files.
+	/// \param theSource path to source file
+	/// \param[out] theSize size of source file
+	/// \param[out] theChecksum checksum of source file
+	/// \return false if file cannot be read
+	static bool checksum(const std::string& theSource, uint64_t& theSize, uint64_t& theChecksum);
+
+	/// Number of point data blocks included in checksum
+	static const unsigned int CHECKSUM_SAMPLES = 256;
+
+	/// Size of each sampled point data block
+	static const unsigned int CHECKSUM_BLOCK = 4096;
+
+}; // class DatasetCache
+
+}
+} // namespace terrace::lidar
+
+#endif // TERRACE_DATASETCACHE_HPP_INCLUDED
@@ -0,0 +1,59 @@
+/******************************************************************************
+ * dequantize.hpp
+ *
+ * Project:  terrace - A library for processing of Lidar
+ *           data.
+ * Purpose:  Conversion of arrays of quantized coordinates to real
+ *           coordinates (value * scale + offset). Uses AVX-512 or AVX2
+ *           when the compiler targets them, plain loop otherwise.
+ * Author:   Vladimir Pajic, pajicv@gmail.com
+ *
+ ******************************************************************************
+ * Copyright (c) 2014, Vladimir Pajic
+ *
+ *****************************************************************************/
+
+#ifndef TERRACE_DEQUANTIZE_HPP_INCLUDED
+#define TERRACE_DEQUANTIZE_HPP_INCLUDED
+
+///////////////////////////////////////////////////////////////////////////////
+// Included dependacies
+
+#include <cstddef>
+
+#include <stdint.h>
+
+///////////////////////////////////////////////////////////////////////////////
+// Actual functions
+
+namespace terrace
+{
+namespace util
+{
+
+/// Converts quantized values to doubles. Multiplication and addition
+/// are rounded separately in all kernels, so results are equal to
+/// value * scale + offset computed one by one.
+/// \param theValues quantized values
+/// \param theCount number of values
+/// \param theScale scale of values
+/// \param theOffset offset of values
+/// \param[out] theResult room for theCount doubles
+void dequantize(const int32_t* theValues, std::size_t theCount,
+				double theScale, double theOffset, double* theResult);
+
+/// Converts quantized values to floats. Meant for coordinates relative
+/// to a local origin (offset minus origin), which stay small enough
+/// for float precision.
+/// \param theValues quantized values
+/// \param theCount number of values
+/// \param theScale scale of values
+/// \param theOffset offset of values relative to local origin
+/// \param[out] theResult room for theCount floats
+void dequantize(const int32_t* theValues, std::size_t theCount,
+				double theScale, double theOffset, float* theResult);
+
+}
+} // namespace terrace::util
+
+#endif // TERRACE_DEQUANTIZE_HPP_INCLUDED
@@ -4,8 +4,10 @@
  * Project:  terrace - A library for processing of Lidar 
  *           data.
  * Purpose:  Grid index on vector of lidar points. Each cell of 
- *			 grid index stores vector of LidarPoint iterators ordered by 
- *			 ascending elevation.
+ *			 grid index refers to 32 bit point indices ordered by 
+ *			 ascending elevation. Indices of all cells are stored in
+ *			 one array in compressed row form. Index can also keep
+ *			 only the lowest point of every cell.
  * Author:   Vladimir Pajic, pajicv@gmail.com
  *
  ******************************************************************************
@@ -26,6 +28,11 @@
 #include "lidarpoint.hpp"
 //#include "georaster.hpp"
 
+#include <cstddef>
+#include <vector>
+
+#include <stdint.h>
+
 ///////////////////////////////////////////////////////////////////////////////
 // Actual class
 
@@ -36,30 +43,287 @@ namespace lidar
 
 class LidarMetadata;
 
+///
+/// Counts points per cell of a regular grid. Used to estimate
+/// point density without building grid index.
+///
+class DensityEstimator
+{
+public:
+
+	/// Creates counting grid over bounds from metadata
+	/// \param theMetadata metadata with bounds of points
+	/// \param theCellSize size of cells used for counting
+	DensityEstimator(const LidarMetadata& theMetadata, double theCellSize = 1.0);
+
+	/// Counts point at given coordinates
+	/// \return false if point is outside of bounds
+	inline bool add(double theX, double theY)
+	{
+		double c = (theX - mMinX) / mCellSize;
+		double r = (mMaxY - theY) / mCellSize;
+		if(c < 0 || r < 0 || c >= mCols || r >= mRows)
+		{
+			return false;
+		}
+		++mCounts[unsigned int(r) * mCols + unsigned int(c)];
+		++mPoints;
+		return true;
+	}
+
+	/// Number of counted points divided by area of cells that contain points
+	double density() const;
+
+private:
+
+	double mMinX;
+	double mMaxY;
+	double mCellSize;
+	unsigned int mRows;
+	unsigned int mCols;
+	unsigned long mPoints;
+	std::vector<unsigned int> mCounts;
+};
+
 class GridIndex
 {
 
 public:
 	
-	typedef std::vector< LidarPoint::VectorIterator > Cell;
+	///
+	/// Indices of points of one cell in the cloud. Refers to storage
+	/// of the index and is valid until the index changes.
+	///
+	class Cell
+	{
+	public:
+
+		typedef const uint32_t* const_iterator;
+
+		Cell(const uint32_t* theBegin, const uint32_t* theEnd) : mBegin(theBegin), mEnd(theEnd)
+		{
+		}
+
+		inline const_iterator begin() const
+		{
+			return mBegin;
+		}
+
+		inline const_iterator end() const
+		{
+			return mEnd;
+		}
+
+		inline std::size_t size() const
+		{
+			return mEnd - mBegin;
+		}
+
+		inline bool empty() const
+		{
+			return mBegin == mEnd;
+		}
+
+		/// Index of the lowest point
+		inline uint32_t front() const
+		{
+			return *mBegin;
+		}
+
+		inline uint32_t operator[](std::size_t theIndex) const
+		{
+			return mBegin[theIndex];
+		}
+
+	private:
+
+		const uint32_t* mBegin;
+		const uint32_t* mEnd;
+	};
+
 	typedef wykobi::rectangle<double> BoundingRectangle;
 
-	GridIndex() : mCells(0), 
-				  mCellSize(0.0), 
+	/// What cells of index keep
+	enum Mode
+	{
+		/// All points of cell ordered by elevation
+		ALL_POINTS,
+		/// Only the lowest point of cell. Cells are found in one pass
+		/// without point lists or sorting. Of points with equal lowest
+		/// elevation the one with the smallest index is kept.
+		LOWEST_POINT
+	};
+
+	GridIndex() : mCellSize(0.0), 
 				  mRows(0), 
 				  mCols(0),
-				  mExtent(wykobi::make_rectangle(double(0.0), double(0.0), double(0.0), double(0.0)))
+				  mExtent(wykobi::make_rectangle(double(0.0), double(0.0), double(0.0), double(0.0))),
+				  mMode(ALL_POINTS),
+				  mNumberOfPoints(0),
+				  mOffsets(1, 0)
 	{
 	}
 
-	~GridIndex()
+	/// Builds index of all points. Cells of points are found in parallel
+	/// blocks and cells are built by finish.
+	/// \param theMetadata metadata with bounds of points
+	/// \param thePoints points
+	/// \param thePool threads used for building
+	/// \param theCellSize size of grid cells
+	/// \param theMode what cells keep
+	void create(const LidarMetadata& theMetadata, PointCloud& thePoints, 
+				util::ThreadPool& thePool, double theCellSize = 1.0, Mode theMode = ALL_POINTS);
+
+	/// Prepares empty index over bounds from metadata. Points are added with
+	/// insert and ordered with finish. Used when points arrive in blocks.
+	void reset(const LidarMetadata& theMetadata, double theCellSize, Mode theMode = ALL_POINTS);
+
+	/// Adds theCount points from theFirst to their cells, converting
+	/// coordinates a block at a time.
+	/// \return false if a point is outside of index extent, points
+	/// after it are not added
+	bool insert(PointCloud& thePoints, std::size_t theFirst, std::size_t theCount);
+
+	/// Builds cells of inserted points and orders points in every cell
+	/// by ascending elevation. Points are grouped by parallel radix sort
+	/// of (cell, index) keys, which counts digits per thread, takes prefix
+	/// sums and scatters keys in parallel. Cell offsets are found and
+	/// cells are ordered in parallel blocks of cells. Index of lowest
+	/// points only takes the lowest point of every cell.
+	/// \param thePoints cloud the indices refer to
+	/// \param thePool threads used for building
+	void finish(const PointCloud& thePoints, util::ThreadPool& thePool);
+
+	/// Estimates point density (points per square unit) over occupied
+	/// area without building the index. Only number of points per cell
+	/// is counted, so it is much cheaper than create.
+	/// \param theMetadata metadata with bounds of points
+	/// \param thePoints points
+	/// \param theCellSize size of cells used for counting
+	/// \return number of points divided by area of cells that contain points
+	static double estimateDensity(const LidarMetadata& theMetadata, 
+								  const PointCloud& thePoints, 
+								  double theCellSize = 1.0);
+
+	/// Makes cells refer to the same points after the points were
+	/// permuted (point i became point theOrder[i] of previous order).
+	/// Order of points inside of cells does not change.
+	void remap(const std::vector<uint32_t>& theOrder);
+
+	/// Recreates index from cells stored in compressed row form
+	/// (e.g. read from cache). Points of cell i are
+	/// theIndices[theOffsets[i]] ... theIndices[theOffsets[i + 1] - 1]
+	/// ordered by ascending elevation.
+	void assign(const BoundingRectangle& theExtent, 
+				double theCellSize, 
+				unsigned int theRows, 
+				unsigned int theCols,
+				const uint32_t* theOffsets, 
+				const uint32_t* theIndices);
+
+	//////////////////////////// Queries ///////////////////////////
+	// Queries do not change index, so they can run concurrently.
+	// Results are written to buffers of caller, which are reused
+	// without allocation once they are large enough. Index that keeps
+	// only lowest points finds only lowest points.
+
+	/// Distance used by queries
+	enum Distance
 	{
-		delete mCells;
-	}
+		/// Distance in XY plane
+		PLANAR,
+		/// Distance in space
+		SPATIAL
+	};
+
+	/// Finds points inside of rectangle (borders included)
+	/// \param thePoints cloud the index refers to
+	/// \param theBox rectangle in real coordinates
+	/// \param[out] theResult indices of found points
+	/// \return number of found points
+	std::size_t box(const PointCloud& thePoints, 
+					const BoundingRectangle& theBox, 
+					std::vector<uint32_t>& theResult) const;
+
+	/// Finds points within theRadius of theCenter (border included)
+	/// \param thePoints cloud the index refers to
+	/// \param theCenter center in real coordinates
+	/// \param theRadius radius
+	/// \param theDistance PLANAR for circle, SPATIAL for sphere
+	/// \param[out] theResult indices of found points
+	/// \return number of found points
+	std::size_t radius(const PointCloud& thePoints, 
+					   const wykobi::point3d<double>& theCenter, 
+					   double theRadius, 
+					   Distance theDistance, 
+					   std::vector<uint32_t>& theResult) const;
+
+	/// Finds points inside of every rectangle in parallel blocks.
+	/// Points of query i are theResult[theOffsets[i]] ... theResult[theOffsets[i + 1] - 1].
+	/// \param thePoints cloud the index refers to
+	/// \param theBoxes rectangles in real coordinates
+	/// \param thePool threads used for queries
+	/// \param[out] theResult indices of found points of all queries
+	/// \param[out] theOffsets theBoxes.size() + 1 offsets into theResult
+	void box(const PointCloud& thePoints, 
+			 const std::vector<BoundingRectangle>& theBoxes, 
+			 util::ThreadPool& thePool, 
+			 std::vector<uint32_t>& theResult, 
+			 std::vector<std::size_t>& theOffsets) const;
+
+	/// Finds points within theRadius of every center in parallel blocks.
+	/// Points of query i are theResult[theOffsets[i]] ... theResult[theOffsets[i + 1] - 1].
+	/// \param thePoints cloud the index refers to
+	/// \param theCenters centers in real coordinates
+	/// \param theRadius radius
+	/// \param theDistance PLANAR for circle, SPATIAL for sphere
+	/// \param thePool threads used for queries
+	/// \param[out] theResult indices of found points of all queries
+	/// \param[out] theOffsets theCenters.size() + 1 offsets into theResult
+	void radius(const PointCloud& thePoints, 
+				const std::vector< wykobi::point3d<double> >& theCenters, 
+				double theRadius, 
+				Distance theDistance, 
+				util::ThreadPool& thePool, 
+				std::vector<uint32_t>& theResult, 
+				std::vector<std::size_t>& theOffsets) const;
+
+	/// Finds theK points nearest to theQuery. Rings of cells around the
+	/// cell of query are searched until no closer point can be found.
+	/// \param thePoints cloud the index refers to
+	/// \param theQuery query point in real coordinates
+	/// \param theK number of neighbours
+	/// \param theDistance distance used for ranking
+	/// \param[out] theIndices indices of neighbours by ascending distance
+	/// \param[out] theSquaredDistances squared distances of neighbours
+	/// \return number of found neighbours, less than theK only if index
+	/// has fewer points
+	unsigned int nearest(const PointCloud& thePoints, 
+						 const wykobi::point3d<double>& theQuery, 
+						 unsigned int theK, 
+						 Distance theDistance, 
+						 std::vector<uint32_t>& theIndices, 
+						 std::vector<double>& theSquaredDistances) const;
 
-	void create(const LidarMetadata& theMetadata, std::vector<LidarPoint>& thePoints, double theCellSize = 1.0);
+	/// Finds theK nearest points of every query point in parallel blocks.
+	/// Neighbours of query i are at theIndices[i * theK] ... theIndices[i * theK + theK - 1]
+	/// by ascending distance. Missing neighbours are PointCloud::NO_POINT.
+	/// \param thePoints cloud the index refers to
+	/// \param theQueries query points in real coordinates
+	/// \param theK number of neighbours
+	/// \param theDistance distance used for ranking
+	/// \param thePool threads used for queries
+	/// \param[out] theIndices theK indices per query
+	/// \param[out] theSquaredDistances theK squared distances per query
+	void nearest(const PointCloud& thePoints, 
+				 const std::vector< wykobi::point3d<double> >& theQueries, 
+				 unsigned int theK, 
+				 Distance theDistance, 
+				 util::ThreadPool& thePool, 
+				 std::vector<uint32_t>& theIndices, 
+				 std::vector<double>& theSquaredDistances) const;
 
-	inline const BoundingRectangle& extent()
+	inline const BoundingRectangle& extent() const
 	{
 		return mExtent;
 	}
@@ -79,9 +343,39 @@ public:
 		return mCols;
 	}
 
-	inline const std::vector< Cell >* cells() const
+	inline Mode mode() const
+	{
+		return mMode;
+	}
+
+	/// Number of points in index
+	inline std::size_t numberOfPoints() const
+	{
+		return mMode == ALL_POINTS ? mIndices.size() : mNumberOfPoints;
+	}
+
+	/// Start of every cell in indices(), rows * columns + 1 values.
+	/// Points of cell i are indices()[offsets()[i]] ... indices()[offsets()[i + 1] - 1].
+	/// Empty if index keeps only lowest points.
+	inline const std::vector<uint32_t>& offsets() const
+	{
+		return mOffsets;
+	}
+
+	/// Point indices of all cells, cell after cell
+	inline const std::vector<uint32_t>& indices() const
 	{
-		return mCells;
+		return mIndices;
+	}
+
+	/// Index of the lowest point of cell, PointCloud::NO_POINT if cell is empty
+	inline uint32_t lowest(unsigned int theIndex) const
+	{
+		if(mMode == LOWEST_POINT)
+		{
+			return mLowest[theIndex];
+		}
+		return mOffsets[theIndex] != mOffsets[theIndex + 1] ? mIndices[mOffsets[theIndex]] : PointCloud::NO_POINT;
 	}
 
 	inline unsigned int x2col(double theX) const
@@ -99,21 +393,67 @@ public:
 		return r * mCols + c;
 	}
 
-	inline const Cell& operator[](unsigned int theIndex) const
+	/// Points of cell. If index keeps only lowest points, cell holds
+	/// the lowest point or none.
+	inline Cell operator[](unsigned int theIndex) const
 	{
-		return mCells->operator[](theIndex);
+		if(mMode == LOWEST_POINT)
+		{
+			const uint32_t* lowest = &mLowest[theIndex];
+			return Cell(lowest, *lowest != PointCloud::NO_POINT ? lowest + 1 : lowest);
+		}
+		const uint32_t* indices = mIndices.empty() ? 0 : &mIndices[0];
+		return Cell(indices + mOffsets[theIndex], indices + mOffsets[theIndex + 1]);
 	}
 	
 	void elevationToRaster(const std::string& filename) const;
 
 private:
 
-	void clear()
+	/// Sets extent, cell size and number of rows and columns
+	void setGeometry(const LidarMetadata& theMetadata, double theCellSize);
+
+	/// Cell of point that is not inserted
+	static const uint32_t NO_CELL = 0xFFFFFFFF;
+
+	/// k nearest search writing to arrays of theK elements
+	unsigned int nearest(const PointCloud& thePoints, 
+						 const wykobi::point3d<double>& theQuery, 
+						 unsigned int theK, 
+						 Distance theDistance, 
+						 uint32_t* theIndices, 
+						 double* theSquaredDistances) const;
+
+	/// Finds lowest point of every cell in parallel blocks
+	void createLowest(const PointCloud& thePoints, util::ThreadPool& thePool);
+
+	/// Finds cell of point
+	/// \return false if point is outside of index extent
+	inline bool findCell(double theX, double theY, unsigned int& theCell) const
 	{
-		if(mCells != 0)
+		if(theX < mExtent[0].x || theY > mExtent[1].y)
 		{
-			delete mCells;
+			return false;
 		}
+		unsigned int c = x2col(theX);
+		unsigned int r = y2row(theY);
+		if(c >= mCols || r >= mRows)
+		{
+			return false;
+		}
+		theCell = index(r, c);
+		return true;
+	}
+
+	void clear()
+	{
+		mMode = ALL_POINTS;
+		mNumberOfPoints = 0;
+		mOffsets.assign(1, 0);
+		mIndices.clear();
+		mPointCells.clear();
+		mLowest.clear();
+		mLowestKeys.clear();
 		mRows = 0;
 		mCols = 0;
 		mExtent = wykobi::make_rectangle(double(0.0), double(0.0), double(0.0), double(0.0));
@@ -128,8 +468,20 @@ private:
 	unsigned int mRows;
 	/// Number of cols in grid (along X axis)
 	unsigned int mCols;
-	/// Vector of cells
-	std::vector< Cell >* mCells;
+	/// What cells keep
+	Mode mMode;
+	/// Number of inserted points if only lowest points are kept
+	std::size_t mNumberOfPoints;
+	/// Start of every cell in mIndices and end of the last cell
+	std::vector<uint32_t> mOffsets;
+	/// Point indices of all cells
+	std::vector<uint32_t> mIndices;
+	/// Cell of every inserted point until finish
+	std::vector<uint32_t> mPointCells;
+	/// Lowest point of every cell if only lowest points are kept
+	std::vector<uint32_t> mLowest;
+	/// Elevation and index of lowest point of every cell until finish
+	std::vector<uint64_t> mLowestKeys;
 
 };
 
@@ -19,6 +19,8 @@
 
 ///////////////////////////////////////////////////////////////////////////////
 // Included dependacies
+#include <string>
+
 #include "lidardataset.hpp"
 #include "lidarpoint.hpp"
 #include "tin.hpp"
@@ -51,7 +53,9 @@ public:
 		class Level
 		{
 		public:
-			std::vector<LidarPoint::VectorIterator> cells;
+			/// Index of the lowest point of each cell,
+			/// PointCloud::NO_POINT for empty cells
+			std::vector<uint32_t> cells;
 			unsigned int number;
 			double cellSize;
 			unsigned int rows;
@@ -60,15 +64,45 @@ public:
 
 		std::vector<Level *> levels;
 		Level* currentLevel;
-		LidarPoint::VectorIterator empty;
 
 		Pyramid(LidarDataset& lidarDs);
 		~Pyramid();
 	};
 
+	/// Number of rows of pyramid level cells checked by one task. Rows 
+	/// are split into bands of fixed size, so result does not depend on
+	/// number of threads.
+	static const unsigned int BAND_ROWS = 16;
+
+	/// Number of triangle planes cached by one band of rows
+	static const unsigned int PLANE_CACHE_SIZE = 1024;
+
+	/// Plane of TIN triangle with its reduced angle threshold. It is 
+	/// computed once per triangle and orientation, so points are checked
+	/// against it without square roots and asin.
+	struct TrianglePlane
+	{
+		/// Triangle of TIN, 0 for empty slot of cache
+		const TTriangle* key;
+		/// Orientation triangle was found with. Reduced angle depends on
+		/// the order of vertices, so it is part of key.
+		int orient;
+		/// Unit normal of plane
+		wykobi::vector3d<double> normal;
+		/// Constant of plane with unit normal
+		double constant;
+		/// Squared sine of reduced angle threshold
+		double squaredSine;
+	};
+
 	/// Constructor
+	/// \param threads number of threads checking cells of pyramid 
+	/// level (0 for all hardware threads)
+	/// \param groundPath if not empty, coordinates of ground points
+	/// are written to this file as tab separated XYZ
 	GroundClassifier(LidarDataset& lidarDs, double angleTreshold,
-		double distanceTreshold, double edgeLengthTreshold);
+		double distanceTreshold, double edgeLengthTreshold, 
+		unsigned int threads = 1, const std::string& groundPath = std::string());
 
 	/// Destructor
 	~GroundClassifier()
@@ -91,29 +125,47 @@ private:
 	/// Creates tin and assigns it to mTIN
 	void createTIN();
 
+	/// Inserts classified points from theFirstPoint on into mTIN, 
+	/// so mTIN is not created again for every pyramid level
+	void densifyTIN(std::size_t theFirstPoint);
+
+	/// Plane of triangle found by hint. Planes are cached in slots of 
+	/// theCache by triangle and orientation, only a missing plane is 
+	/// computed, so checks give the same results as without cache.
+	const TrianglePlane& trianglePlane(const wykobi::triangle3d& triangle, 
+		const TOrientedTriangle& hint, std::vector<TrianglePlane>& theCache) const;
+
 	/// Check angle constraint
-	bool checkAngle(const wykobi::point3d<double>& point, const wykobi::triangle3d& triangle) const;
+	bool checkAngle(const wykobi::point3d<double>& point, const wykobi::triangle3d& triangle, 
+		const TrianglePlane& plane) const;
 
 	/// Check angle for mirrored point (absolute value is checked)
-	bool checkMirrorAngle(const wykobi::point3d<double>& point, const wykobi::triangle3d& triangle) const;
+	bool checkMirrorAngle(const wykobi::point3d<double>& point, const wykobi::triangle3d& triangle, 
+		const TrianglePlane& plane) const;
 
 	/// Check distance constraint
-	bool checkDistance(const wykobi::point3d<double>& point, const wykobi::triangle3d& triangle) const;
+	bool checkDistance(const wykobi::point3d<double>& point, const TrianglePlane& plane) const;
 
 	/// Reduce angle if longest triangle edge is shorter than mEdgeLengthTreshold
 	double reduceAngle(const wykobi::triangle3d& triangle) const;
 
 	/// Find mirror point
 	wykobi::point3d<double>* findMirrorPoint(const wykobi::point3d<double>& point, 
-		const wykobi::triangle<double, 3>& triangle);
+		const wykobi::triangle<double, 3>& triangle) const;
 
 	/// Checks angle and distance constraints for point.
 	/// If those are not satisfied finds mirror point and 
 	/// checks constraint for mirrored point. 
-	/// If point or mirrored point meets costraints returns true
-	bool checkPoint(const wykobi::point3d<double>& point);
+	/// If point or mirrored point meets costraints returns true.
+	/// Triangles are searched from hint, which is updated, so 
+	/// threads with own hints and caches can check points concurrently. 
+	/// Point outside of TIN is mirrored over the hull triangle where 
+	/// search left TIN.
+	bool checkPoint(const wykobi::point3d<double>& point, TOrientedTriangle& hint,
+		std::vector<TrianglePlane>& cache) const;
 
 	/// Set classification for lidar points classified as ground
+	/// and writes them to mGroundPath
 	void applyClassification();
 	
 	/// Pointer to LidarDataset being classified
@@ -122,8 +174,8 @@ private:
 	/// TIN of ground points
 	TIN* mTIN;
 
-	/// Classified points
-	std::vector< LidarPoint::VectorIterator > mClassifiedPoints;
+	/// Indices of classified points
+	std::vector< uint32_t > mClassifiedPoints;
 
 	Pyramid mPyramid;
 
@@ -136,6 +188,11 @@ private:
 	double mEdgeLengthTreshold;
 
 	double mEdgeDistance;
+
+	unsigned int mThreads;
+
+	/// File ground points are written to, empty for none
+	std::string mGroundPath;
 };
 
 }
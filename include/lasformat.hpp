@@ -0,0 +1,239 @@
+/******************************************************************************
+ * lasformat.hpp
+ *
+ * Project:  terrace - A library for processing of Lidar
+ *           data.
+ * Purpose:  Layout of the LAS public header block and point data
+ *           records (formats 0 - 3) as defined in LAS 1.0 - 1.2
+ *           specification.
+ * Author:   Vladimir Pajic, pajicv@gmail.com
+ *
+ ******************************************************************************
+ * Copyright (c) 2014, Vladimir Pajic
+ *
+ *****************************************************************************/
+
+#ifndef TERRACE_LASFORMAT_HPP_INCLUDED
+#define TERRACE_LASFORMAT_HPP_INCLUDED
+
+///////////////////////////////////////////////////////////////////////////////
+// Included dependacies
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+///////////////////////////////////////////////////////////////////////////////
+// Actual class
+
+namespace terrace
+{
+namespace lidar
+{
+namespace las
+{
+
+/// Size of public header block in LAS 1.0 - 1.2
+const std::size_t HEADER_SIZE = 227;
+
+/// Size of variable length record header
+const std::size_t VLR_HEADER_SIZE = 54;
+
+/// Maximal size of data of one variable length record
+const std::size_t MAX_VLR_DATA = 65535;
+
+/// Highest point data format that is decoded natively
+const unsigned char MAX_NATIVE_FORMAT = 3;
+
+/// Point data format written by terrace
+const unsigned char OUTPUT_FORMAT = 3;
+
+/// System identifier written in header. Same as the one
+/// liblas writes, so native output matches liblas output.
+const char* const SYSTEM_IDENTIFIER = "libLAS";
+
+/// Generating software written in header (liblas default)
+const char* const GENERATING_SOFTWARE = "libLAS 1.7.0";
+
+/// Mask of the bits of classification field that hold the class
+const unsigned char CLASS_MASK = 0x1F;
+
+/// Offsets of fields in the point data record. They are the
+/// same for formats 0 - 3.
+enum RecordOffset
+{
+	RECORD_X = 0,
+	RECORD_Y = 4,
+	RECORD_Z = 8,
+	RECORD_INTENSITY = 12,
+	RECORD_RETURNS = 14,
+	RECORD_CLASSIFICATION = 15,
+	RECORD_SCAN_ANGLE = 16,
+	RECORD_USER_DATA = 17,
+	RECORD_POINT_SOURCE = 18,
+	RECORD_EXTRA = 20
+};
+
+/// Minimal length of point data record for formats 0 - 3
+inline std::size_t recordLength(unsigned char theFormat)
+{
+	static const std::size_t lengths[] = { 20, 28, 26, 34 };
+	return theFormat <= MAX_NATIVE_FORMAT ? lengths[theFormat] : 0;
+}
+
+/// Offsets of fields that only some point data formats have,
+/// -1 if format does not have the field
+struct RecordLayout
+{
+public:
+	/// Length of record in bytes
+	std::size_t length;
+	/// Offset of GPS time (double)
+	int gpsTime;
+	/// Offset of red, green and blue (uint16 each)
+	int rgb;
+
+	RecordLayout() : length(0), gpsTime(-1), rgb(-1)
+	{
+	}
+};
+
+/// Layout of records of formats 0 - 3.
+/// \param theFormat point data format
+/// \param theLength record length from header, may exceed minimal length
+inline RecordLayout recordLayout(unsigned char theFormat, std::size_t theLength)
+{
+	RecordLayout layout;
+	layout.length = theLength;
+	if(theFormat == 1 || theFormat == 3)
+	{
+		layout.gpsTime = RECORD_EXTRA;
+	}
+	if(theFormat == 2)
+	{
+		layout.rgb = RECORD_EXTRA;
+	}
+	else if(theFormat == 3)
+	{
+		layout.rgb = RECORD_EXTRA + 8;
+	}
+	return layout;
+}
+
+/// Reads little endian value from unaligned memory.
+/// \note Assumes little endian host as all supported platforms are.
+template <typename T>
+inline T readLE(const char* theBytes)
+{
+	T value;
+	std::memcpy(&value, theBytes, sizeof(T));
+	return value;
+}
+
+/// Writes value to unaligned memory in little endian order.
+template <typename T>
+inline void writeLE(char* theBytes, T theValue)
+{
+	std::memcpy(theBytes, &theValue, sizeof(T));
+}
+
+/// Fields of LAS public header block
+struct Header
+{
+public:
+	char signature[4];
+	uint16_t fileSourceId;
+	uint16_t globalEncoding;
+	char projectGuid[16];
+	unsigned char versionMajor;
+	unsigned char versionMinor;
+	char systemIdentifier[32];
+	char generatingSoftware[32];
+	uint16_t creationDay;
+	uint16_t creationYear;
+	uint16_t headerSize;
+	uint32_t pointDataOffset;
+	uint32_t numberOfVlrs;
+	unsigned char pointDataFormat;
+	uint16_t pointDataRecordLength;
+	uint32_t numberOfPoints;
+	uint32_t numberOfPointsByReturn[5];
+	double scale[3];
+	double offset[3];
+	double max[3];
+	double min[3];
+
+	/// Creates header with the same defaults liblas uses: version 1.2,
+	/// no variable length records and creation date set to today.
+	Header();
+
+	/// Point data format without compression bits
+	inline unsigned char format() const
+	{
+		return pointDataFormat & 0x3F;
+	}
+
+	/// True if point data is compressed (LAZ)
+	inline bool compressed() const
+	{
+		return (pointDataFormat & 0xC0) != 0;
+	}
+};
+
+/// Variable length record stored between header and point data
+struct VariableLengthRecord
+{
+public:
+	char userId[16];
+	uint16_t recordId;
+	char description[32];
+	std::vector<char> data;
+
+	VariableLengthRecord();
+
+	VariableLengthRecord(const char* theUserId, uint16_t theRecordId, const char* theDescription);
+
+	/// True if record has given user and record id
+	bool is(const char* theUserId, uint16_t theRecordId) const;
+};
+
+/// Encodes public header block.
+/// \param theHeader header to encode
+/// \param[out] theBytes buffer of at least HEADER_SIZE bytes
+void encodeHeader(const Header& theHeader, char* theBytes);
+
+/// Decodes public header block.
+/// \param theBytes beginning of the file
+/// \param theSize number of available bytes
+/// \param[out] theHeader decoded header
+/// \return true if bytes hold valid LAS header, false otherwise
+bool decodeHeader(const char* theBytes, std::size_t theSize, Header& theHeader);
+
+/// Copies fields other than coordinates from one record to another.
+/// Intensity, returns, classification with its flags, scan angle, user
+/// data and point source id are always copied, GPS time and colors when
+/// both layouts have them.
+void copyRecordFields(const char* theSource, const RecordLayout& theSourceLayout,
+					  char* theDestination, const RecordLayout& theDestinationLayout);
+
+/// Encodes variable length record and appends it to theBytes.
+/// Data longer than MAX_VLR_DATA is truncated.
+void encodeVlr(const VariableLengthRecord& theVlr, std::vector<char>& theBytes);
+
+/// Decodes variable length records that follow the header.
+/// \param theBytes beginning of the file
+/// \param theSize number of available bytes
+/// \param theHeader decoded header of the file
+/// \param[out] theVlrs decoded records
+/// \return false if records do not fit between header and point data
+bool decodeVlrs(const char* theBytes, std::size_t theSize, const Header& theHeader, 
+				std::vector<VariableLengthRecord>& theVlrs);
+
+}
+}
+} // namespace terrace::lidar::las
+
+#endif // TERRACE_LASFORMAT_HPP_INCLUDED
@@ -0,0 +1,95 @@
+/******************************************************************************
+ * laspipeline.hpp
+ *
+ * Project:  terrace - A library for processing of Lidar
+ *           data.
+ * Purpose:  Pipelined loading of LAS point records. A reader thread
+ *           reads raw record blocks from disk, decoder threads turn
+ *           them into points and the bucketing stage puts points into
+ *           grid cells as blocks arrive. Stages are connected by
+ *           bounded lock-free queues.
+ * Author:   Vladimir Pajic, pajicv@gmail.com
+ *
+ ******************************************************************************
+ * Copyright (c) 2014, Vladimir Pajic
+ *
+ *****************************************************************************/
+
+#ifndef TERRACE_LASPIPELINE_HPP_INCLUDED
+#define TERRACE_LASPIPELINE_HPP_INCLUDED
+
+///////////////////////////////////////////////////////////////////////////////
+// Included dependacies
+
+#include <string>
+#include <vector>
+
+#include "lasformat.hpp"
+#include "lasreader.hpp"
+#include "gridindex.hpp"
+#include "lidarpoint.hpp"
+#include "lidarmetadata.hpp"
+
+///////////////////////////////////////////////////////////////////////////////
+// Actual class
+
+namespace terrace
+{
+namespace lidar
+{
+
+class LasPipeline
+{
+public:
+
+	/// Result of pipelined loading
+	enum Result
+	{
+		/// Points are loaded and grid index is built
+		INDEXED,
+		/// Points are loaded and density is estimated, index has to be built
+		COUNTED,
+		/// Points are loaded, but some lie outside of bounds from header,
+		/// so neither index nor density estimate is complete
+		OUT_OF_BOUNDS
+	};
+
+	/// \param theSource path to LAS file
+	/// \param theHeader decoded header of the file
+	/// \param theThreads total number of threads (0 for all hardware threads)
+	LasPipeline(const std::string& theSource, const las::Header& theHeader, unsigned int theThreads);
+
+	/// Loads all point records. Throws std::runtime_error if file cannot be read.
+	/// \param theMetadata metadata the points will refer to (bounds are used for bucketing)
+	/// \param theCellSize cell size of grid index. If it is not greater than 0
+	/// the bucketing stage only counts points for density estimation.
+	/// \param theGridMode what cells of grid index keep
+	/// \param[out] thePoints resized to number of records and filled with points,
+	/// it has to refer to theMetadata
+	/// \param[out] theChunks summaries of decoded blocks in file order
+	/// \param[out] theGridIndex grid index, built if theCellSize is greater than 0
+	/// \param[out] theDensity estimated density, if theCellSize is not greater than 0
+	/// \return what has been done with the points
+	Result run(const LidarMetadata& theMetadata,
+			   double theCellSize,
+			   GridIndex::Mode theGridMode,
+			   PointCloud& thePoints,
+			   std::vector<ChunkSummary>& theChunks,
+			   GridIndex& theGridIndex,
+			   double& theDensity);
+
+	/// Number of records in one block
+	static const unsigned long BLOCK_SIZE = 1 << 16;
+
+private:
+
+	std::string mSource;
+	las::Header mHeader;
+	unsigned int mDecoders;
+
+}; // class LasPipeline
+
+}
+} // namespace terrace::lidar
+
+#endif // TERRACE_LASPIPELINE_HPP_INCLUDED
@@ -0,0 +1,259 @@
+/******************************************************************************
+ * lasreader.hpp
+ *
+ * Project:  terrace - A library for processing of Lidar
+ *           data.
+ * Purpose:  Native reader of LAS files. Memory maps the file and
+ *           decodes point data formats 0 - 3 directly from the
+ *           mapped bytes, without going through liblas.
+ * Author:   Vladimir Pajic, pajicv@gmail.com
+ *
+ ******************************************************************************
+ * Copyright (c) 2014, Vladimir Pajic
+ *
+ *****************************************************************************/
+
+#ifndef TERRACE_LASREADER_HPP_INCLUDED
+#define TERRACE_LASREADER_HPP_INCLUDED
+
+///////////////////////////////////////////////////////////////////////////////
+// Included dependacies
+
+#include <algorithm>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "lasformat.hpp"
+#include "lidarmetadata.hpp"
+#include "pointcloud.hpp"
+#include "mappedfile.hpp"
+#include "region.hpp"
+#include "threadpool.hpp"
+
+///////////////////////////////////////////////////////////////////////////////
+// Actual class
+
+namespace terrace
+{
+namespace lidar
+{
+
+/// Summary of a contiguous range of point records computed
+/// while they are decoded.
+struct ChunkSummary
+{
+public:
+	/// Index of first record in chunk
+	unsigned long first;
+	/// Number of points decoded from chunk. Equals number of records
+	/// in chunk unless points are filtered by region.
+	unsigned long count;
+	/// Minimal quantized coordinates [ X, Y, Z ]
+	long min[3];
+	/// Maximal quantized coordinates [ X, Y, Z ]
+	long max[3];
+	/// Number of points per class
+	unsigned long classCounts[32];
+
+	ChunkSummary() : first(0), count(0)
+	{
+		for(unsigned int i = 0; i < 3; ++i)
+		{
+			min[i] = std::numeric_limits<long>::max();
+			max[i] = std::numeric_limits<long>::min();
+		}
+		std::fill(classCounts, classCounts + 32, 0);
+	}
+
+	/// Extends bounds and class counts with those of other chunk
+	void merge(const ChunkSummary& theOther);
+};
+
+/// Contiguous range of point records
+struct RecordRange
+{
+public:
+	/// Index of first record
+	unsigned long first;
+	/// Number of records
+	unsigned long count;
+
+	RecordRange() : first(0), count(0)
+	{
+	}
+
+	RecordRange(unsigned long theFirst, unsigned long theCount) : first(theFirst), count(theCount)
+	{
+	}
+};
+
+class LasReader
+{
+public:
+
+	LasReader() : mFile(), mHeader(), mLayout(), mVlrs(), mSupported(false)
+	{
+	}
+
+	/// Maps the file and decodes its public header block.
+	/// \param theSource path to LAS file
+	/// \return true if file is mapped and has valid LAS header
+	bool open(const std::string& theSource);
+
+	/// Unmaps the file
+	void close();
+
+	/// True if point records of the opened file can be decoded natively
+	/// (uncompressed point data format 0 - 3 and complete point block).
+	/// Otherwise liblas has to be used.
+	inline bool supported() const
+	{
+		return mSupported;
+	}
+
+	inline const las::Header& header() const
+	{
+		return mHeader;
+	}
+
+	/// Variable length records of the opened file
+	inline const std::vector<las::VariableLengthRecord>& vlrs() const
+	{
+		return mVlrs;
+	}
+
+	/// Layout of point records of the opened file
+	inline const las::RecordLayout& layout() const
+	{
+		return mLayout;
+	}
+
+	/// Mask of PointCloud attributes that records of the opened file hold
+	unsigned int attributes() const;
+
+	/// Pointer to the first byte of record
+	inline const char* record(unsigned long theIndex) const
+	{
+		return mFile.data() + mHeader.pointDataOffset
+			+ static_cast<std::size_t>(theIndex) * mHeader.pointDataRecordLength;
+	}
+
+	/// Decodes consecutive point records into preallocated points.
+	/// \param theFirst index of first record
+	/// \param theCount number of records to decode
+	/// \param[out] thePoints cloud with room for theCount points from thePosition
+	/// \param thePosition index of the first point that is overwritten
+	/// \param[out] theSummary bounds and class counts of decoded records
+	void readPoints(unsigned long theFirst,
+					unsigned long theCount,
+					PointCloud& thePoints,
+					std::size_t thePosition,
+					ChunkSummary& theSummary) const;
+
+	/// Decodes all point records. The point block is split into chunks
+	/// of CHUNK_SIZE records which are decoded by the threads of the pool
+	/// straight into their slots of thePoints.
+	/// \param thePool threads used for decoding
+	/// \param[out] thePoints resized to number of records and filled with points
+	/// \param[out] theChunks summaries of decoded chunks in file order
+	void readPoints(util::ThreadPool& thePool,
+					PointCloud& thePoints,
+					std::vector<ChunkSummary>& theChunks) const;
+
+	/// Decodes point records that lie inside of region. Chunks are
+	/// decoded by the threads of the pool into chunk local buffers, so
+	/// points outside of region are never stored in thePoints.
+	/// \param thePool threads used for decoding
+	/// \param theRegion region of interest
+	/// \param[out] thePoints points inside of region in file order
+	/// \param[out] theChunks summaries of points kept from chunks in file order
+	void readPoints(util::ThreadPool& thePool,
+					const Region& theRegion,
+					PointCloud& thePoints,
+					std::vector<ChunkSummary>& theChunks) const;
+
+	/// Decodes point records from given ranges that lie inside of region.
+	/// Ranges are split into chunks of at most CHUNK_SIZE records, so records
+	/// outside of ranges are not touched at all.
+	/// \param thePool threads used for decoding
+	/// \param theRegion region of interest
+	/// \param theRanges record ranges sorted by first record, without overlaps
+	/// \param[out] thePoints points inside of region in file order
+	/// \param[out] theChunks summaries of points kept from chunks in file order
+	void readPoints(util::ThreadPool& thePool,
+					const Region& theRegion,
+					const std::vector<RecordRange>& theRanges,
+					PointCloud& thePoints,
+					std::vector<ChunkSummary>& theChunks) const;
+
+	/// Decodes attribute columns of thePoints, point i from record i.
+	/// Columns of attributes the records do not hold are left as they are.
+	/// \param thePool threads used for decoding
+	/// \param[in,out] thePoints cloud with one point per record
+	void readAttributes(util::ThreadPool& thePool, PointCloud& thePoints) const;
+
+	/// Decodes records from a block of bytes. Besides coordinates and
+	/// class, attributes that have columns in thePoints are decoded.
+	/// \param theBytes first byte of first record
+	/// \param theLayout layout of records
+	/// \param theFirst index of first record (stored in summary)
+	/// \param theCount number of records to decode
+	/// \param[out] thePoints cloud with room for theCount points from thePosition
+	/// \param thePosition index of the first point that is overwritten
+	/// \param[out] theSummary bounds and class counts of decoded records
+	static void decodeRecords(const char* theBytes,
+							  const las::RecordLayout& theLayout,
+							  unsigned long theFirst,
+							  unsigned long theCount,
+							  PointCloud& thePoints,
+							  std::size_t thePosition,
+							  ChunkSummary& theSummary);
+
+	/// Decodes records from a block of bytes, keeping only points inside of region.
+	/// \param theBytes first byte of first record
+	/// \param theLayout layout of records
+	/// \param theRegion region of interest
+	/// \param theFirst index of first record (stored in summary)
+	/// \param theCount number of records to decode
+	/// \param[out] thePoints cloud with room for theCount points from thePosition,
+	/// kept points are written to front
+	/// \param thePosition index of the first point that may be overwritten
+	/// \param[out] theSummary bounds and class counts of kept points
+	/// \return number of kept points
+	static unsigned long decodeRecords(const char* theBytes,
+									   const las::RecordLayout& theLayout,
+									   const Region& theRegion,
+									   unsigned long theFirst,
+									   unsigned long theCount,
+									   PointCloud& thePoints,
+									   std::size_t thePosition,
+									   ChunkSummary& theSummary);
+
+	/// Number of records decoded as one task
+	static const unsigned long CHUNK_SIZE = 1 << 20;
+
+	/// Number of records a task decodes at once when it reads a region.
+	/// Only points inside of region are kept from such block, so memory
+	/// follows the points of region, not the scanned records.
+	static const unsigned long REGION_BLOCK_SIZE = 1 << 16;
+
+private:
+
+	/// Mapped LAS file
+	util::MappedFile mFile;
+	/// Decoded public header block
+	las::Header mHeader;
+	/// Layout of point records
+	las::RecordLayout mLayout;
+	/// Decoded variable length records
+	std::vector<las::VariableLengthRecord> mVlrs;
+	/// True if point records can be decoded natively
+	bool mSupported;
+
+}; // class LasReader
+
+}
+} // namespace terrace::lidar
+
+#endif // TERRACE_LASREADER_HPP_INCLUDED
@@ -0,0 +1,125 @@
+/******************************************************************************
+ * laswriter.hpp
+ *
+ * Project:  terrace - A library for processing of Lidar
+ *           data.
+ * Purpose:  Native writer of LAS files. Point records are encoded
+ *           into large aligned buffers by several threads while one
+ *           thread writes finished buffers to disk.
+ * Author:   Vladimir Pajic, pajicv@gmail.com
+ *
+ ******************************************************************************
+ * Copyright (c) 2014, Vladimir Pajic
+ *
+ *****************************************************************************/
+
+#ifndef TERRACE_LASWRITER_HPP_INCLUDED
+#define TERRACE_LASWRITER_HPP_INCLUDED
+
+///////////////////////////////////////////////////////////////////////////////
+// Included dependacies
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "lasformat.hpp"
+#include "lasreader.hpp"
+#include "lidarpoint.hpp"
+#include "lidarmetadata.hpp"
+#include "threadpool.hpp"
+
+///////////////////////////////////////////////////////////////////////////////
+// Actual class
+
+namespace terrace
+{
+namespace lidar
+{
+
+class LasWriter
+{
+public:
+
+	LasWriter() : mFile(0), mFieldSource(0)
+	{
+	}
+
+	/// Closes the file if it is still open
+	~LasWriter()
+	{
+		close();
+	}
+
+	/// Creates (or truncates) destination file.
+	/// \param theDestination path to LAS file
+	/// \return true if file is created
+	bool open(const std::string& theDestination);
+
+	/// Closes the file
+	void close();
+
+	/// Sets file whose records give the fields that points do not hold
+	/// (attributes without columns, scan angle, user data, point source
+	/// id and class flags). Point i takes them from record i, so the
+	/// points have to be in the order of records of theSource. Reader
+	/// has to stay open while points are written. 0 writes such fields
+	/// as zero.
+	void copyFieldsFrom(const LasReader* theSource);
+
+	/// Writes header and all points as format 3 records. Throws
+	/// std::runtime_error if the file cannot be written.
+	/// \param theMetadata metadata used to populate header
+	/// \param thePoints points to write
+	/// \param thePool threads used for encoding
+	void write(const LidarMetadata& theMetadata,
+			   const PointCloud& thePoints,
+			   util::ThreadPool& thePool);
+
+	/// Writes header, variable length records and points in given
+	/// order as format 3 records. Throws std::runtime_error if the file
+	/// cannot be written.
+	/// \param theMetadata metadata used to populate header
+	/// \param thePoints points to write
+	/// \param theOrder indices of points in the order they are written
+	/// \param theVlrs variable length records written after header
+	/// \param thePool threads used for encoding
+	void write(const LidarMetadata& theMetadata,
+			   const PointCloud& thePoints,
+			   const std::vector<uint32_t>& theOrder,
+			   const std::vector<las::VariableLengthRecord>& theVlrs,
+			   util::ThreadPool& thePool);
+
+	/// Size of one output buffer in bytes
+	static const std::size_t BUFFER_SIZE = 4 << 20;
+
+	/// Alignment of output buffers
+	static const std::size_t BUFFER_ALIGNMENT = 4096;
+
+private:
+
+	// Not copyable
+	LasWriter(const LasWriter&);
+	LasWriter& operator=(const LasWriter&);
+
+	/// Writes bytes to file, throws if not all bytes are written
+	void writeBytes(const char* theBytes, std::size_t theSize);
+
+	/// Writes the file. Points are written in their order if theOrder is 0.
+	void writeFile(const LidarMetadata& theMetadata,
+				   const PointCloud& thePoints,
+				   const uint32_t* theOrder,
+				   const std::vector<las::VariableLengthRecord>& theVlrs,
+				   util::ThreadPool& thePool);
+
+	std::FILE* mFile;
+
+	/// Reader of records that give fields points do not hold
+	const LasReader* mFieldSource;
+
+}; // class LasWriter
+
+}
+} // namespace terrace::lidar
+
+#endif // TERRACE_LASWRITER_HPP_INCLUDED
@@ -21,12 +21,21 @@
 ///////////////////////////////////////////////////////////////////////////////
 // Included dependacies
 
+#include <iostream>
 #include <string>
 #include <vector>
 
 #include "lidarpoint.hpp"
 #include "lidarmetadata.hpp"
+#include "pointcloud.hpp"
+#include "lasreader.hpp"
+#include "xyzreader.hpp"
 #include "gridindex.hpp"
+#include "quadtreeindex.hpp"
+#include "region.hpp"
+#include "spacefillingcurve.hpp"
+#include "threadpool.hpp"
+#include "datasetcache.hpp"
 
 ///////////////////////////////////////////////////////////////////////////////
 // Actual class
@@ -36,6 +45,92 @@ namespace terrace
 namespace lidar
 {
 
+/// Options that control how a data set is loaded
+struct LoadOptions
+{
+public:
+	/// Number of threads used for decoding point records.
+	/// 0 uses one thread per hardware thread.
+	unsigned int threads;
+
+	/// Path to binary cache of the data set. If it is not empty and the
+	/// cache is valid for the source file, data set is read from cache.
+	/// Otherwise the source is loaded and the cache is (re)written.
+	/// Not used when only a region is loaded, or when attributes of
+	/// reordered points are requested, since cache holds no attributes.
+	std::string cache;
+
+	/// Cell size of grid index. If it is not greater than 0, cell
+	/// size is set to average point spacing estimated from point density.
+	double cellSize;
+
+	/// What cells of grid index keep. Index of lowest points is enough
+	/// for ground classification and is built much faster. Cache is
+	/// not used with it.
+	GridIndex::Mode gridMode;
+
+	/// If true, reading, decoding and bucketing of points into grid
+	/// cells run concurrently as stages of a pipeline.
+	/// Not used when only a region is loaded.
+	bool pipelined;
+
+	/// Mask of PointCloud attributes decoded with coordinates. Attributes
+	/// that are not requested get no columns and are not decoded. They
+	/// can be decoded later with LidarDataset::loadAttributes unless only
+	/// a region is loaded.
+	unsigned int attributes;
+
+	/// If true, points are reordered along curve after loading,
+	/// see LidarDataset::reorder
+	bool reorder;
+
+	/// Space filling curve used for reordering
+	util::Curve curve;
+
+	/// If true, quadtree index is built besides grid index,
+	/// see LidarDataset::quadtreeIndex. It is not cached.
+	bool quadtree;
+
+	/// Leaf capacity of quadtree index
+	unsigned int leafCapacity;
+
+	LoadOptions() : threads(1), cache(), cellSize(0.0), gridMode(GridIndex::ALL_POINTS), pipelined(false), attributes(0),
+		reorder(false), curve(util::HILBERT), quadtree(false), leafCapacity(64)
+	{
+	}
+};
+
+/// Options that control how a data set is saved
+struct SaveOptions
+{
+public:
+	/// Order in which points are written
+	enum Order
+	{
+		/// Order of points in data set
+		ORIGINAL,
+		/// Morton order of points in XY plane
+		MORTON,
+		/// Hilbert order of points in XY plane
+		HILBERT
+	};
+
+	/// Number of threads used for encoding point records.
+	/// 0 uses one thread per hardware thread.
+	unsigned int threads;
+
+	/// Order of points in output. Spatially ordered output holds
+	/// chunk table with bounds of every chunkSize points.
+	Order order;
+
+	/// Number of points per chunk of spatially ordered output
+	unsigned long chunkSize;
+
+	SaveOptions() : threads(1), order(ORIGINAL), chunkSize(50000)
+	{
+	}
+};
+
 class LidarDataset
 {
 private:
@@ -44,37 +139,118 @@ private:
 
 	std::string mSource;
 	
-	std::vector<LidarPoint> mPoints;
+	/// Points refer to mMetadata
+	PointCloud mPoints;
 
 	LidarMetadata mMetadata;
 
 	GridIndex mGridIndex;
 
+	/// Empty unless LoadOptions::quadtree was set
+	QuadtreeIndex mQuadtreeIndex;
+
+	/// Estimated number of points per square unit
+	double mDensity;
+
+	/// True if point i was decoded from record i of source
+	bool mRecordOrder;
+
+	/// Curve points were reordered along, if they are not in record order
+	util::Curve mCurve;
+
+	/// Bounds and class counts of decoded chunks of point records.
+	/// Empty if points were read through liblas or from cache.
+	std::vector<ChunkSummary> mChunks;
+
+	/// Stream of progress messages
+	std::ostream* mLog;
+
+	/// Loads whole file if theRegion is 0, otherwise only
+	/// the points inside of region
+	bool load(const std::string& theSource, const Region* theRegion, const LoadOptions& theOptions);
+
+	/// Replaces bounds from header with bounds of decoded
+	/// chunks if header does not enclose all points.
+	void checkBounds();
+
+	/// Sets number of points and bounds to those of loaded subset
+	void fitToSubset(const ChunkSummary& theSubset);
+
+	/// Indices of points sorted along space filling curve
+	/// over the bounds of data set
+	void spatialOrder(util::Curve theCurve, util::ThreadPool& thePool, std::vector<uint32_t>& theOrder) const;
+
+	/// Reads points through liblas. Used for the files
+	/// that LasReader cannot decode.
+	/// \param theRegion if not 0, only points inside of region are kept
+	void loadWithLiblas(const std::string& theSource, const Region* theRegion);
+
 public:
 	
-	LidarDataset() : mLoaded(false), mSource(""), mPoints(), mMetadata()
+	LidarDataset() : mLoaded(false), mSource(""), mPoints(), mMetadata(), mDensity(0.0), mRecordOrder(false), mCurve(util::HILBERT), 
+		mLog(&std::cout)
 	{
+		mPoints.setMetadata(mMetadata);
 	}
 
-	bool load(const std::string& theSource);
+	bool load(const std::string& theSource, const LoadOptions& theOptions = LoadOptions());
+
+	/// Loads only the points inside of region. Points outside of region
+	/// are dropped while records are decoded. If there is a valid sidecar
+	/// spatial index next to the source, only the records of index cells
+	/// touched by region are read. Number of points and bounds in metadata
+	/// describe the loaded subset.
+	bool load(const std::string& theSource, 
+			  const Region& theRegion, 
+			  const LoadOptions& theOptions = LoadOptions());
+
+	bool loadFromXyz(const std::string& theSource, 
+					 const XyzFormat& theFormat = XyzFormat(),
+					 const LoadOptions& theOptions = LoadOptions());
+
+	/// Reorders points along space filling curve over the bounds of data set,
+	/// so points close in space are close in memory. Grid and quadtree
+	/// indices are remapped to the new order. Afterwards points are not in the order of source
+	/// records, so attributes without columns cannot be decoded or copied
+	/// from the source any more.
+	/// \param theCurve space filling curve
+	/// \param theThreads number of threads (0 for all hardware threads)
+	void reorder(util::Curve theCurve, unsigned int theThreads = 1);
 
-	bool loadFromXyz(const std::string& theSource);
+	/// Decodes attributes that do not have columns yet from the source.
+	/// Only possible while points are in the order of source records,
+	/// i.e. after the whole LAS file is loaded.
+	/// \param theAttributes mask of PointCloud attributes
+	/// \param theThreads number of threads used for decoding (0 for all hardware threads)
+	/// \return true if all requested attributes that the source has
+	/// have columns, attributes missing from point format are skipped
+	/// like when loading
+	bool loadAttributes(unsigned int theAttributes, unsigned int theThreads = 1);
 
-	bool saveAs(const std::string& theDestination) const;
+	/// Saves points as LAS file. While points are in the order of records
+	/// of a LAS source, fields without columns are copied from the source.
+	bool saveAs(const std::string& theDestination, const SaveOptions& theOptions = SaveOptions()) const;
 
 	double estimateDensity() const;
 
+	/// Classifies ground points by progressive TIN densification
+	/// \param theThreads number of threads checking points of pyramid 
+	/// level (0 for all hardware threads), result does not depend on it
+	/// \param theGroundPath if not empty, coordinates of ground points
+	/// are written to this file as tab separated XYZ
 	unsigned int classifyGround(double blockSize, 
 								double angleTreshold,
 								double distanceTreshold, 
-								double edgeLengthTreshold);
+								double edgeLengthTreshold,
+								unsigned int theThreads = 1,
+								const std::string& theGroundPath = std::string());
 
 	const std::string& source() const
 	{
 		return mSource;
 	}
 
-	std::vector<LidarPoint>& points()
+	PointCloud& points()
 	{
 		return mPoints;
 	}
@@ -89,6 +265,40 @@ public:
 		return mGridIndex;
 	}
 
+	/// Quadtree index of points, empty if data set was not loaded
+	/// with LoadOptions::quadtree
+	const QuadtreeIndex& quadtreeIndex() const
+	{
+		return mQuadtreeIndex;
+	}
+
+	/// Point density estimated while loading
+	double density() const
+	{
+		return mDensity;
+	}
+
+	const std::vector<ChunkSummary>& chunks() const
+	{
+		return mChunks;
+	}
+
+	/// Stream progress messages of loading and classification
+	/// are written to, std::cout by default
+	std::ostream& log() const
+	{
+		return *mLog;
+	}
+
+	/// Sets stream of progress messages, e.g. a buffer of one 
+	/// of several data sets that are processed concurrently
+	void setLog(std::ostream& theLog)
+	{
+		mLog = &theLog;
+	}
+
+	friend class DatasetCache;
+
 }; // class LidarDataset
 
 }
@@ -25,6 +25,7 @@ namespace liblas
 // Included dependacies
 
 #include "terracedefs.hpp"
+#include "lasformat.hpp"
 #include "liblas/liblas.hpp"
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -66,10 +67,28 @@ public:
 	/// \param theHdr	LAS header from which the values are taken
 	void setFromLasHeader(const liblas::Header& theHdr); 
 
+	/// Set values of attributes with data from natively decoded header
+	/// \param theHdr	LAS header from which the values are taken
+	void setFromLasHeader(const las::Header& theHdr);
+
 	/// Creates liblas::Header to be saved in file
 	/// \return LAS header to be saved in file
 	void populateLasHeader(liblas::Header& theHdr) const;
 
+	/// Populates header written by native LAS writer
+	/// \param theHdr	LAS header to be saved in file
+	void populateLasHeader(las::Header& theHdr) const;
+
+	inline void setOffsets(const wykobi::vector3d<double>& theOffsets)
+	{
+		mOffsets = theOffsets;
+	}
+
+	inline void setScales(const wykobi::vector3d<double>& theScales)
+	{
+		mScales = theScales;
+	}
+
 	inline std::string generatingSoftware() const
 	{
 		return mGeneratingSoftware;
@@ -95,12 +114,12 @@ public:
 		mBoundingBox = bb;
 	}
 
-	inline wykobi::vector3d<double> offsets() const
+	inline const wykobi::vector3d<double>& offsets() const
 	{
 		return mOffsets;
 	}
 	
-	inline wykobi::vector3d<double> scales() const
+	inline const wykobi::vector3d<double>& scales() const
 	{
 		return mScales;
 	}
@@ -1,11 +1,12 @@
 /******************************************************************************
  * lidarpoint.hpp
  *
- * Project:  terrace - A library for processing of Lidar 
+ * Project:  terrace - A library for processing of Lidar
  *           data.
  * Purpose:  Point measured by Lidar system. Currently
  *           only contains coordinates and classification
- *           attribute.
+ *           attribute. Points are stored in PointCloud and
+ *           LidarPoint refers to one of them.
  * Author:   Vladimir Pajic, pajicv@gmail.com
  *
  ******************************************************************************
@@ -22,9 +23,13 @@
 ///////////////////////////////////////////////////////////////////////////////
 // Included dependacies
 
+#include <cstddef>
+#include <iterator>
+
 #include "terracedefs.hpp"
 #include "liblas\point.hpp"
 #include "lidarmetadata.hpp"
+#include "pointcloud.hpp"
 
 ///////////////////////////////////////////////////////////////////////////////
 // Actual class
@@ -34,100 +39,197 @@ namespace terrace
 namespace lidar
 {
 
-class LidarPoint 
+class LidarPoint
 {
 public:
 
 	/////////////////////// Type definitions ///////////////////////
 
-	typedef std::vector<LidarPoint>::iterator VectorIterator;
-	typedef std::vector<LidarPoint>::const_iterator ConstVectorIterator;
+	typedef PointIterator VectorIterator;
 
 	/////////////////////////// Methods ////////////////////////////
-	
-	LidarPoint(const LidarMetadata& theMetadata, const wykobi::point3d<long> theCoords, unsigned char theCls = 0)	
-		: mMetadata(&theMetadata), mCoords(theCoords), mCls(theCls)
+
+	LidarPoint(PointCloud& theCloud, std::size_t theIndex) : mCloud(&theCloud), mIndex(theIndex)
 	{
-	} 
+	}
 
-	LidarPoint(const LidarMetadata& theMetadata, long theX, long theY, long theZ, unsigned char theCls = 0)
-		: mMetadata(&theMetadata), mCoords(wykobi::make_point(theX, theY, theZ)), mCls(theCls)
+	inline wykobi::point3d<long> coords() const
 	{
+		return mCloud->coords(mIndex);
 	}
 
-	LidarPoint(const LidarMetadata& theMetadata, const wykobi::point3d<double> theRealCoords, unsigned char theCls = 0)	
-		: mMetadata(&theMetadata), mCls(theCls)
+	inline wykobi::point3d<double> realCoords() const
 	{
-		// Initialize mCoords
-		setFromRealCoords(theRealCoords);
-	} 
+		return mCloud->realCoords(mIndex);
+	}
+
+	void setFromRealCoords(wykobi::point3d<double> realPoint);
 
-	LidarPoint(const LidarMetadata& theMetadata, double theX, double theY, double theZ, unsigned char theCls = 0)
-		: mMetadata(&theMetadata), mCls(theCls)
+	inline unsigned char classification() const
 	{
-		//Initialize mCoords
-		setFromRealCoords(wykobi::make_point(theX, theY, theZ));
+		return mCloud->classification(mIndex);
 	}
 
-	LidarPoint(const LidarMetadata& theMetadata, const liblas::Point& theLasPoint)	
-		: mMetadata(&theMetadata),
-		  mCoords(wykobi::make_point(static_cast<long>(theLasPoint.GetRawX()), 
-			static_cast<long>(theLasPoint.GetRawY()), 
-			static_cast<long>(theLasPoint.GetRawZ()))),
-		  mCls(theLasPoint.GetClassification().GetClass())
+	inline void setClassification(unsigned char theCls)
 	{
+		mCloud->setClassification(mIndex, theCls);
 	}
 
-	inline wykobi::point3d<long> coords() const
+	inline void setZ(long theZ)
 	{
-		return mCoords;
+		mCloud->setZ(mIndex, static_cast<int32_t>(theZ));
 	}
 
-	inline wykobi::point3d<double> realCoords() const
+	/// Index of point in its cloud
+	inline std::size_t index() const
 	{
-		return wykobi::make_point(mCoords.x * mMetadata->scales().x + mMetadata->offsets().x, 
-			mCoords.y * mMetadata->scales().y + mMetadata->offsets().y,
-			mCoords.z * mMetadata->scales().z + mMetadata->offsets().z);
+		return mIndex;
 	}
 
-	void setFromRealCoords(wykobi::point3d<double> realPoint);
+	void populateLasPoint(liblas::Point& lasPoint) const;
 
-	inline unsigned char classification() const
+private:
+
+	PointCloud* mCloud;
+
+	std::size_t mIndex;
+};
+
+///
+/// Random access iterator over points of PointCloud. Dereferencing
+/// gives LidarPoint referring to the point.
+///
+class PointIterator
+{
+public:
+
+	typedef std::random_access_iterator_tag iterator_category;
+	typedef LidarPoint value_type;
+	typedef std::ptrdiff_t difference_type;
+	typedef LidarPoint* pointer;
+	typedef LidarPoint reference;
+
+	PointIterator() : mCloud(0), mIndex(0)
 	{
-		return mCls;
 	}
 
-	inline void setClassification(unsigned char theCls)
+	PointIterator(PointCloud& theCloud, std::size_t theIndex) : mCloud(&theCloud), mIndex(theIndex)
 	{
-		mCls = theCls;
 	}
 
-	inline void setZ(long theZ)
+	inline LidarPoint operator*() const
 	{
-		mCoords.z = theZ;
+		return LidarPoint(*mCloud, mIndex);
 	}
 
-	void populateLasPoint(liblas::Point& lasPoint) const;
+	inline LidarPoint operator[](difference_type theOffset) const
+	{
+		return LidarPoint(*mCloud, mIndex + theOffset);
+	}
+
+	/// Index of point in its cloud
+	inline std::size_t index() const
+	{
+		return mIndex;
+	}
+
+	inline PointCloud& cloud() const
+	{
+		return *mCloud;
+	}
+
+	inline PointIterator& operator++() { ++mIndex; return *this; }
+	inline PointIterator& operator--() { --mIndex; return *this; }
+	inline PointIterator operator++(int) { PointIterator it(*this); ++mIndex; return it; }
+	inline PointIterator operator--(int) { PointIterator it(*this); --mIndex; return it; }
+	inline PointIterator& operator+=(difference_type theOffset) { mIndex += theOffset; return *this; }
+	inline PointIterator& operator-=(difference_type theOffset) { mIndex -= theOffset; return *this; }
+
+	inline PointIterator operator+(difference_type theOffset) const
+	{
+		return PointIterator(*mCloud, mIndex + theOffset);
+	}
+
+	inline PointIterator operator-(difference_type theOffset) const
+	{
+		return PointIterator(*mCloud, mIndex - theOffset);
+	}
+
+	inline difference_type operator-(const PointIterator& theOther) const
+	{
+		return static_cast<difference_type>(mIndex) - static_cast<difference_type>(theOther.mIndex);
+	}
+
+	inline bool operator==(const PointIterator& theOther) const
+	{
+		return mIndex == theOther.mIndex && mCloud == theOther.mCloud;
+	}
+
+	inline bool operator!=(const PointIterator& theOther) const
+	{
+		return !(*this == theOther);
+	}
+
+	inline bool operator<(const PointIterator& theOther) const { return mIndex < theOther.mIndex; }
+	inline bool operator>(const PointIterator& theOther) const { return mIndex > theOther.mIndex; }
+	inline bool operator<=(const PointIterator& theOther) const { return mIndex <= theOther.mIndex; }
+	inline bool operator>=(const PointIterator& theOther) const { return mIndex >= theOther.mIndex; }
 
 private:
 
-	const LidarMetadata* mMetadata;
+	PointCloud* mCloud;
 
-	wykobi::point3d<long> mCoords;
-	
-	unsigned char mCls;
+	std::size_t mIndex;
 };
 
+inline LidarPoint PointCloud::operator[](std::size_t theIndex)
+{
+	return LidarPoint(*this, theIndex);
+}
+
+inline PointCloud::iterator PointCloud::begin()
+{
+	return PointIterator(*this, 0);
+}
+
+inline PointCloud::iterator PointCloud::end()
+{
+	return PointIterator(*this, size());
+}
+
 /// Comapares Z coordinate of points. Used for sorting points by Z.
-/// \param p1 vector iterator to first point 
+/// \param p1 vector iterator to first point
 /// \param p2 vector iterator to second point
 /// \return true if p1 has smaller Z than p2
 inline bool compareZ(LidarPoint::VectorIterator p1, LidarPoint::VectorIterator p2)
 {
-	return ((*p1).coords().z < (*p2).coords().z);
+	return p1.cloud().z(p1.index()) < p2.cloud().z(p2.index());
 }
 
+///
+/// Compares Z coordinate of points given by their indices in a cloud.
+/// Used for sorting point indices by Z.
+///
+class CompareZ
+{
+public:
+
+	explicit CompareZ(const PointCloud& theCloud) : mZ(theCloud.zData())
+	{
+	}
+
+	/// \return true if point p1 has smaller Z than point p2
+	inline bool operator()(uint32_t p1, uint32_t p2) const
+	{
+		return mZ[p1] < mZ[p2];
+	}
+
+private:
+
+	const int32_t* mZ;
+};
+
 }
 } // namespace terrace::lidar
 
-#endif // TERRACE_LIDARPOINT_HPP_INCLUDED
\ No newline at end of file
+#endif // TERRACE_LIDARPOINT_HPP_INCLUDED
@@ -0,0 +1,92 @@
+/******************************************************************************
+ * mappedfile.hpp
+ *
+ * Project:  terrace - A library for processing of Lidar
+ *           data.
+ * Purpose:  Read-only memory mapping of a whole file. Used by native
+ *           readers to decode records directly from the mapped bytes.
+ * Author:   Vladimir Pajic, pajicv@gmail.com
+ *
+ ******************************************************************************
+ * Copyright (c) 2014, Vladimir Pajic
+ *
+ *****************************************************************************/
+
+#ifndef TERRACE_MAPPEDFILE_HPP_INCLUDED
+#define TERRACE_MAPPEDFILE_HPP_INCLUDED
+
+///////////////////////////////////////////////////////////////////////////////
+// Included dependacies
+
+#include <cstddef>
+#include <string>
+
+///////////////////////////////////////////////////////////////////////////////
+// Actual class
+
+namespace terrace
+{
+namespace util
+{
+
+class MappedFile
+{
+public:
+
+	MappedFile();
+
+	/// Unmaps the file if it is still mapped
+	~MappedFile();
+
+	/// Maps the whole file into memory for reading.
+	/// \param thePath path to the file
+	/// \return true if file is mapped, false otherwise
+	bool open(const std::string& thePath);
+
+	/// Unmaps the file and closes the handles
+	void close();
+
+	inline bool isOpen() const
+	{
+		return mData != 0;
+	}
+
+	/// Pointer to the first byte of the mapped file
+	inline const char* data() const
+	{
+		return mData;
+	}
+
+	/// Size of the mapped file in bytes
+	inline std::size_t size() const
+	{
+		return mSize;
+	}
+
+private:
+
+	// Not copyable
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+
+	/// Mapped bytes
+	const char* mData;
+	/// Number of mapped bytes
+	std::size_t mSize;
+
+#ifdef _WIN32
+	/// File handle (HANDLE)
+	void* mFile;
+	/// File mapping handle (HANDLE)
+	void* mMapping;
+#else
+	/// File descriptor
+	int mFd;
+#endif
+
+}; // class MappedFile
+
+}
+} // namespace terrace::util
+
+#endif // TERRACE_MAPPEDFILE_HPP_INCLUDED
@@ -0,0 +1,317 @@
+/******************************************************************************
+ * pointcloud.hpp
+ *
+ * Project:  terrace - A library for processing of Lidar
+ *           data.
+ * Purpose:  Columnar storage of lidar points. Quantized X, Y and Z
+ *           are held in contiguous int32 arrays and classification in
+ *           a byte array, all points share one metadata. Other LAS
+ *           attributes have optional columns that exist only when they
+ *           are requested. LidarPoint is a lightweight reference to one
+ *           point of the cloud.
+ * Author:   Vladimir Pajic, pajicv@gmail.com
+ *
+ ******************************************************************************
+ * Copyright (c) 2014, Vladimir Pajic
+ *
+ *****************************************************************************/
+
+#ifndef TERRACE_POINTCLOUD_HPP_INCLUDED
+#define TERRACE_POINTCLOUD_HPP_INCLUDED
+
+///////////////////////////////////////////////////////////////////////////////
+// Forward declared dependacies
+
+namespace terrace
+{
+namespace lidar
+{
+class LidarPoint;
+class PointIterator;
+}
+namespace util
+{
+class ThreadPool;
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Included dependacies
+
+#include <cstddef>
+#include <vector>
+
+#include <stdint.h>
+
+#include "terracedefs.hpp"
+#include "lidarmetadata.hpp"
+
+///////////////////////////////////////////////////////////////////////////////
+// Actual class
+
+namespace terrace
+{
+namespace lidar
+{
+
+class PointCloud
+{
+public:
+
+	typedef PointIterator iterator;
+
+	/// Optional attribute columns. Values are combined into masks.
+	enum Attribute
+	{
+		/// Pulse return magnitude (uint16)
+		INTENSITY = 1,
+		/// Byte with return number, number of returns, scan direction
+		/// and edge of flight line flags, as stored in LAS records
+		RETURNS = 2,
+		/// GPS time (double)
+		GPS_TIME = 4,
+		/// Red, green and blue (uint16 each)
+		RGB = 8
+	};
+
+	/// Mask of all optional attributes
+	static const unsigned int ALL_ATTRIBUTES = INTENSITY | RETURNS | GPS_TIME | RGB;
+
+	PointCloud() : mMetadata(0), mX(), mY(), mZ(), mClassification(), mAttributes(0), 
+		mIntensity(), mReturns(), mGpsTime(), mRgb()
+	{
+	}
+
+	/// Creates empty cloud whose points refer to given metadata
+	explicit PointCloud(const LidarMetadata& theMetadata) :
+		mMetadata(&theMetadata), mX(), mY(), mZ(), mClassification(), mAttributes(0), 
+		mIntensity(), mReturns(), mGpsTime(), mRgb()
+	{
+	}
+
+	inline const LidarMetadata& metadata() const
+	{
+		return *mMetadata;
+	}
+
+	inline void setMetadata(const LidarMetadata& theMetadata)
+	{
+		mMetadata = &theMetadata;
+	}
+
+	inline std::size_t size() const
+	{
+		return mX.size();
+	}
+
+	inline bool empty() const
+	{
+		return mX.empty();
+	}
+
+	void clear();
+
+	void reserve(std::size_t theSize);
+
+	/// Resizes all columns, new points are zero
+	void resize(std::size_t theSize);
+
+	/// Releases memory of all columns
+	void release();
+
+	/// Appends point. Its optional attributes are zero.
+	inline void add(int32_t theX, int32_t theY, int32_t theZ, unsigned char theCls = 0)
+	{
+		mX.push_back(theX);
+		mY.push_back(theY);
+		mZ.push_back(theZ);
+		mClassification.push_back(theCls);
+		if(mAttributes != 0)
+		{
+			resizeAttributes(mX.size());
+		}
+	}
+
+	/// Overwrites point
+	inline void set(std::size_t theIndex, int32_t theX, int32_t theY, int32_t theZ, unsigned char theCls = 0)
+	{
+		mX[theIndex] = theX;
+		mY[theIndex] = theY;
+		mZ[theIndex] = theZ;
+		mClassification[theIndex] = theCls;
+	}
+
+	/// Appends all points of other cloud. Attributes that
+	/// other cloud does not have are zero.
+	void append(const PointCloud& theOther);
+
+	/// Replaces points with given points of other cloud. Attributes
+	/// of this cloud that other cloud does not have are zero.
+	/// \param theOther cloud points are taken from
+	/// \param theIndices indices of points in theOther, in new order
+	void assign(const PointCloud& theOther, const std::vector<uint32_t>& theIndices);
+
+	/// Reorders points, point i becomes the point theOrder[i].
+	/// All columns are permuted, columns in parallel blocks.
+	/// \param theOrder permutation of point indices
+	/// \param thePool threads used for permuting
+	void permute(const std::vector<uint32_t>& theOrder, util::ThreadPool& thePool);
+
+	/// Mask of attributes that have columns
+	inline unsigned int attributes() const
+	{
+		return mAttributes;
+	}
+
+	/// \return true if all attributes of theMask have columns
+	inline bool hasAttributes(unsigned int theMask) const
+	{
+		return (mAttributes & theMask) == theMask;
+	}
+
+	/// Creates zero filled columns of attributes in theMask that
+	/// do not exist and releases columns of those not in theMask.
+	void setAttributes(unsigned int theMask);
+
+	inline int32_t x(std::size_t theIndex) const
+	{
+		return mX[theIndex];
+	}
+
+	inline int32_t y(std::size_t theIndex) const
+	{
+		return mY[theIndex];
+	}
+
+	inline int32_t z(std::size_t theIndex) const
+	{
+		return mZ[theIndex];
+	}
+
+	inline unsigned char classification(std::size_t theIndex) const
+	{
+		return mClassification[theIndex];
+	}
+
+	inline void setClassification(std::size_t theIndex, unsigned char theCls)
+	{
+		mClassification[theIndex] = theCls;
+	}
+
+	inline void setZ(std::size_t theIndex, int32_t theZ)
+	{
+		mZ[theIndex] = theZ;
+	}
+
+	inline wykobi::point3d<long> coords(std::size_t theIndex) const
+	{
+		return wykobi::make_point(static_cast<long>(mX[theIndex]),
+			static_cast<long>(mY[theIndex]),
+			static_cast<long>(mZ[theIndex]));
+	}
+
+	inline wykobi::point3d<double> realCoords(std::size_t theIndex) const
+	{
+		return wykobi::make_point(mX[theIndex] * mMetadata->scales().x + mMetadata->offsets().x,
+			mY[theIndex] * mMetadata->scales().y + mMetadata->offsets().y,
+			mZ[theIndex] * mMetadata->scales().z + mMetadata->offsets().z);
+	}
+
+	inline uint16_t intensity(std::size_t theIndex) const
+	{
+		return mIntensity[theIndex];
+	}
+
+	inline unsigned char returns(std::size_t theIndex) const
+	{
+		return mReturns[theIndex];
+	}
+
+	inline double gpsTime(std::size_t theIndex) const
+	{
+		return mGpsTime[theIndex];
+	}
+
+	/// Color channel (0 red, 1 green, 2 blue)
+	inline uint16_t rgb(std::size_t theIndex, unsigned int theChannel) const
+	{
+		return mRgb[3 * theIndex + theChannel];
+	}
+
+	/// Real coordinates of theCount points from theFirst.
+	/// Columns whose output is 0 are not converted.
+	void realCoords(std::size_t theFirst, std::size_t theCount,
+					double* theX, double* theY, double* theZ) const;
+
+	/// Coordinates of theCount points from theFirst relative to theOrigin.
+	/// Columns whose output is 0 are not converted.
+	void localCoords(std::size_t theFirst, std::size_t theCount, const wykobi::point3d<double>& theOrigin,
+					 float* theX, float* theY, float* theZ) const;
+
+	/// Number of points converted at once by loops over real coordinates
+	static const std::size_t COORDS_BLOCK = 4096;
+
+	/// Point index that refers to no point. Structures that keep
+	/// 32 bit point indices hold at most NO_POINT points.
+	static const uint32_t NO_POINT = 0xFFFFFFFF;
+
+	/// Columns. Valid until the cloud is resized.
+	inline const int32_t* xData() const { return mX.empty() ? 0 : &mX[0]; }
+	inline const int32_t* yData() const { return mY.empty() ? 0 : &mY[0]; }
+	inline const int32_t* zData() const { return mZ.empty() ? 0 : &mZ[0]; }
+	inline const unsigned char* classificationData() const { return mClassification.empty() ? 0 : &mClassification[0]; }
+
+	inline int32_t* xData() { return mX.empty() ? 0 : &mX[0]; }
+	inline int32_t* yData() { return mY.empty() ? 0 : &mY[0]; }
+	inline int32_t* zData() { return mZ.empty() ? 0 : &mZ[0]; }
+	inline unsigned char* classificationData() { return mClassification.empty() ? 0 : &mClassification[0]; }
+
+	/// Attribute columns, 0 if attribute has no column or cloud is empty.
+	/// Colors are stored as red, green, blue triples.
+	inline const uint16_t* intensityData() const { return mIntensity.empty() ? 0 : &mIntensity[0]; }
+	inline const unsigned char* returnsData() const { return mReturns.empty() ? 0 : &mReturns[0]; }
+	inline const double* gpsTimeData() const { return mGpsTime.empty() ? 0 : &mGpsTime[0]; }
+	inline const uint16_t* rgbData() const { return mRgb.empty() ? 0 : &mRgb[0]; }
+
+	inline uint16_t* intensityData() { return mIntensity.empty() ? 0 : &mIntensity[0]; }
+	inline unsigned char* returnsData() { return mReturns.empty() ? 0 : &mReturns[0]; }
+	inline double* gpsTimeData() { return mGpsTime.empty() ? 0 : &mGpsTime[0]; }
+	inline uint16_t* rgbData() { return mRgb.empty() ? 0 : &mRgb[0]; }
+
+	/// Reference to point
+	inline LidarPoint operator[](std::size_t theIndex);
+
+	inline iterator begin();
+
+	inline iterator end();
+
+private:
+
+	/// Metadata shared by all points
+	const LidarMetadata* mMetadata;
+
+	std::vector<int32_t> mX;
+	std::vector<int32_t> mY;
+	std::vector<int32_t> mZ;
+	std::vector<unsigned char> mClassification;
+
+	/// Attributes that have columns
+	unsigned int mAttributes;
+
+	std::vector<uint16_t> mIntensity;
+	std::vector<unsigned char> mReturns;
+	std::vector<double> mGpsTime;
+	std::vector<uint16_t> mRgb;
+
+	/// Resizes existing attribute columns, new values are zero
+	void resizeAttributes(std::size_t theSize);
+
+}; // class PointCloud
+
+}
+} // namespace terrace::lidar
+
+// LidarPoint and PointIterator complete the cloud
+#include "lidarpoint.hpp"
+
+#endif // TERRACE_POINTCLOUD_HPP_INCLUDED
@@ -0,0 +1,246 @@
+/******************************************************************************
+ * quadtreeindex.hpp
+ *
+ * Project:  terrace - A library for processing of Lidar
+ *           data.
+ * Purpose:  Adaptive quadtree index on vector of lidar points. Nodes
+ *           are split until they hold at most a given number of points,
+ *           so dense and sparse parts of data set get leaves of about
+ *           the same occupancy. Offers the same queries as GridIndex.
+ * Author:   Vladimir Pajic, pajicv@gmail.com
+ *
+ ******************************************************************************
+ * Copyright (c) 2014, Vladimir Pajic
+ *
+ *****************************************************************************/
+
+#ifndef TERRACE_QUADTREEINDEX_HPP_INCLUDED
+#define TERRACE_QUADTREEINDEX_HPP_INCLUDED
+
+///////////////////////////////////////////////////////////////////////////////
+// Included dependacies
+
+#include <cstddef>
+#include <vector>
+
+#include <stdint.h>
+
+#include "terracedefs.hpp"
+#include "gridindex.hpp"
+#include "pointcloud.hpp"
+#include "spacefillingcurve.hpp"
+
+///////////////////////////////////////////////////////////////////////////////
+// Actual class
+
+namespace terrace
+{
+namespace lidar
+{
+
+class LidarMetadata;
+
+///
+/// Root node is the square that covers bounds of points. Points are
+/// sorted by Morton code of their column and row in 2^CURVE_BITS x
+/// 2^CURVE_BITS grid over the root, so points of every node are a
+/// contiguous range of sorted point indices. Node with more than leaf
+/// capacity points is split into four children, unless it is at the
+/// deepest level. Children of a node are stored next to each other.
+///
+class QuadtreeIndex
+{
+public:
+
+	typedef wykobi::rectangle<double> BoundingRectangle;
+
+	/// Deepest level of tree, leaves there are single grid columns and rows
+	static const unsigned int MAX_DEPTH = util::CURVE_BITS;
+
+	/// Node of tree
+	struct Node
+	{
+		/// First point of node in indices()
+		uint32_t first;
+		/// Number of points in node and its descendants
+		uint32_t count;
+		/// Index of the first of four children in nodes(), 0 for leaf.
+		/// Children are ordered by Morton code (lower left, lower right,
+		/// upper left, upper right).
+		uint32_t children;
+	};
+
+	QuadtreeIndex();
+
+	/// Builds index of all points. Morton codes are computed and sorted
+	/// in parallel, nodes are split top down.
+	/// \param theMetadata metadata with bounds of points
+	/// \param thePoints points
+	/// \param thePool threads used for building
+	/// \param theLeafCapacity largest number of points in leaf that is not
+	/// at the deepest level
+	void create(const LidarMetadata& theMetadata,
+				const PointCloud& thePoints,
+				util::ThreadPool& thePool,
+				unsigned int theLeafCapacity = 64);
+
+	/// Makes nodes refer to the same points after the points were
+	/// permuted (point i became point theOrder[i] of previous order).
+	void remap(const std::vector<uint32_t>& theOrder);
+
+	inline const std::vector<Node>& nodes() const
+	{
+		return mNodes;
+	}
+
+	/// Point indices ordered by Morton code, points of every node are contiguous
+	inline const std::vector<uint32_t>& indices() const
+	{
+		return mIndices;
+	}
+
+	/// Number of leaves with points
+	std::size_t numberOfLeaves() const;
+
+	/// Number of levels below root
+	unsigned int depth() const;
+
+	//////////////////////////// Queries ///////////////////////////
+	// Same as queries of GridIndex. Queries do not change index, so
+	// they can run concurrently. Results are written to buffers of
+	// caller, which are reused without allocation once they are large
+	// enough.
+
+	/// Finds points inside of rectangle (borders included)
+	/// \param thePoints cloud the index refers to
+	/// \param theBox rectangle in real coordinates
+	/// \param[out] theResult indices of found points
+	/// \return number of found points
+	std::size_t box(const PointCloud& thePoints,
+					const BoundingRectangle& theBox,
+					std::vector<uint32_t>& theResult) const;
+
+	/// Finds points within theRadius of theCenter (border included)
+	/// \param thePoints cloud the index refers to
+	/// \param theCenter center in real coordinates
+	/// \param theRadius radius
+	/// \param theDistance PLANAR for circle, SPATIAL for sphere
+	/// \param[out] theResult indices of found points
+	/// \return number of found points
+	std::size_t radius(const PointCloud& thePoints,
+					   const wykobi::point3d<double>& theCenter,
+					   double theRadius,
+					   GridIndex::Distance theDistance,
+					   std::vector<uint32_t>& theResult) const;
+
+	/// Finds points inside of every rectangle in parallel blocks.
+	/// Points of query i are theResult[theOffsets[i]] ... theResult[theOffsets[i + 1] - 1].
+	/// \param thePoints cloud the index refers to
+	/// \param theBoxes rectangles in real coordinates
+	/// \param thePool threads used for queries
+	/// \param[out] theResult indices of found points of all queries
+	/// \param[out] theOffsets theBoxes.size() + 1 offsets into theResult
+	void box(const PointCloud& thePoints,
+			 const std::vector<BoundingRectangle>& theBoxes,
+			 util::ThreadPool& thePool,
+			 std::vector<uint32_t>& theResult,
+			 std::vector<std::size_t>& theOffsets) const;
+
+	/// Finds points within theRadius of every center in parallel blocks.
+	/// Points of query i are theResult[theOffsets[i]] ... theResult[theOffsets[i + 1] - 1].
+	/// \param thePoints cloud the index refers to
+	/// \param theCenters centers in real coordinates
+	/// \param theRadius radius
+	/// \param theDistance PLANAR for circle, SPATIAL for sphere
+	/// \param thePool threads used for queries
+	/// \param[out] theResult indices of found points of all queries
+	/// \param[out] theOffsets theCenters.size() + 1 offsets into theResult
+	void radius(const PointCloud& thePoints,
+				const std::vector< wykobi::point3d<double> >& theCenters,
+				double theRadius,
+				GridIndex::Distance theDistance,
+				util::ThreadPool& thePool,
+				std::vector<uint32_t>& theResult,
+				std::vector<std::size_t>& theOffsets) const;
+
+	/// Finds theK points nearest to theQuery. Children are visited
+	/// nearest first and nodes farther than the k-th neighbour found
+	/// so far are skipped.
+	/// \param thePoints cloud the index refers to
+	/// \param theQuery query point in real coordinates
+	/// \param theK number of neighbours
+	/// \param theDistance distance used for ranking
+	/// \param[out] theIndices indices of neighbours by ascending distance
+	/// \param[out] theSquaredDistances squared distances of neighbours
+	/// \return number of found neighbours, less than theK only if index
+	/// has fewer points
+	unsigned int nearest(const PointCloud& thePoints,
+						 const wykobi::point3d<double>& theQuery,
+						 unsigned int theK,
+						 GridIndex::Distance theDistance,
+						 std::vector<uint32_t>& theIndices,
+						 std::vector<double>& theSquaredDistances) const;
+
+	/// Finds theK nearest points of every query point in parallel blocks.
+	/// Neighbours of query i are at theIndices[i * theK] ... theIndices[i * theK + theK - 1]
+	/// by ascending distance. Missing neighbours are PointCloud::NO_POINT.
+	/// \param thePoints cloud the index refers to
+	/// \param theQueries query points in real coordinates
+	/// \param theK number of neighbours
+	/// \param theDistance distance used for ranking
+	/// \param thePool threads used for queries
+	/// \param[out] theIndices theK indices per query
+	/// \param[out] theSquaredDistances theK squared distances per query
+	void nearest(const PointCloud& thePoints,
+				 const std::vector< wykobi::point3d<double> >& theQueries,
+				 unsigned int theK,
+				 GridIndex::Distance theDistance,
+				 util::ThreadPool& thePool,
+				 std::vector<uint32_t>& theIndices,
+				 std::vector<double>& theSquaredDistances) const;
+
+private:
+
+	/// Node on stack of traversal with its position in grid of root
+	struct Visit
+	{
+		uint32_t node;
+		uint32_t column;
+		uint32_t row;
+		unsigned int depth;
+	};
+
+	/// Largest number of nodes waiting on stack of depth first traversal
+	static const unsigned int STACK_SIZE = 4 * MAX_DEPTH + 4;
+
+	/// Splits node over sorted codes [theBegin, theEnd) of its points
+	void split(uint32_t theNode, const uint64_t* theBegin, const uint64_t* theEnd,
+			   unsigned int theDepth, unsigned int theLeafCapacity);
+
+	/// k nearest search writing to arrays of theK elements
+	unsigned int nearest(const PointCloud& thePoints,
+						 const wykobi::point3d<double>& theQuery,
+						 unsigned int theK,
+						 GridIndex::Distance theDistance,
+						 uint32_t* theIndices,
+						 double* theSquaredDistances) const;
+
+	/// Squared distance from point to rectangle of node in XY plane
+	double squaredGap(double theX, double theY, const Visit& theVisit) const;
+
+	/// Lower left corner of root
+	double mMinX;
+	double mMinY;
+	/// Size of grid cell of the deepest level
+	double mCellSize;
+	/// Nodes, root is the first
+	std::vector<Node> mNodes;
+	/// Point indices ordered by Morton code
+	std::vector<uint32_t> mIndices;
+
+}; // class QuadtreeIndex
+
+}
+} // namespace terrace::lidar
+
+#endif // TERRACE_QUADTREEINDEX_HPP_INCLUDED
@@ -0,0 +1,51 @@
+/******************************************************************************
+ * radixsort.hpp
+ *
+ * Project:  terrace - A library for processing of Lidar
+ *           data.
+ * Purpose:  Parallel least significant digit radix sort of 64 bit
+ *           keys. Used to order points along space filling curves.
+ * Author:   Vladimir Pajic, pajicv@gmail.com
+ *
+ ******************************************************************************
+ * Copyright (c) 2014, Vladimir Pajic
+ *
+ *****************************************************************************/
+
+#ifndef TERRACE_RADIXSORT_HPP_INCLUDED
+#define TERRACE_RADIXSORT_HPP_INCLUDED
+
+///////////////////////////////////////////////////////////////////////////////
+// Included dependacies
+
+#include <vector>
+
+#include <stdint.h>
+
+#include "threadpool.hpp"
+
+///////////////////////////////////////////////////////////////////////////////
+// Actual functions
+
+namespace terrace
+{
+namespace util
+{
+
+/// Number of key bits sorted in one pass
+const unsigned int RADIX_BITS = 8;
+
+/// Sorts keys by bits [theFirstBit, theLastBit). Sort is stable, keys
+/// equal in those bits keep their order. Every pass counts digits of
+/// blocks of keys in parallel and scatters the blocks in parallel.
+/// Passes over digits that are equal in all keys are skipped.
+/// \param[in,out] theKeys keys to sort
+/// \param theFirstBit lowest bit of sort key
+/// \param theLastBit bit past the highest bit of sort key
+/// \param thePool threads used for sorting
+void radixSort(std::vector<uint64_t>& theKeys, unsigned int theFirstBit, unsigned int theLastBit, ThreadPool& thePool);
+
+}
+} // namespace terrace::util
+
+#endif // TERRACE_RADIXSORT_HPP_INCLUDED
@@ -0,0 +1,96 @@
+/******************************************************************************
+ * region.hpp
+ *
+ * Project:  terrace - A library for processing of Lidar
+ *           data.
+ * Purpose:  Region of interest in XY plane, either rectangle or
+ *           simple polygon. Used to load only part of lidar data set.
+ * Author:   Vladimir Pajic, pajicv@gmail.com
+ *
+ ******************************************************************************
+ * Copyright (c) 2014, Vladimir Pajic
+ *
+ *****************************************************************************/
+
+#ifndef TERRACE_REGION_HPP_INCLUDED
+#define TERRACE_REGION_HPP_INCLUDED
+
+///////////////////////////////////////////////////////////////////////////////
+// Included dependacies
+
+#include "terracedefs.hpp"
+
+///////////////////////////////////////////////////////////////////////////////
+// Actual class
+
+namespace terrace
+{
+namespace lidar
+{
+
+class Region
+{
+public:
+
+	typedef wykobi::rectangle<double> BoundingRectangle;
+
+	/// Creates rectangular region
+	Region(double theMinX, double theMinY, double theMaxX, double theMaxY);
+
+	/// Creates polygonal region.
+	/// \param thePolygon vertices of simple polygon, first vertex
+	/// is not repeated at the end
+	explicit Region(const mydefs::Points2d& thePolygon);
+
+	/// Checks if point is inside of region. Points on the lower and left
+	/// border of rectangle are inside, points on upper and right are not,
+	/// so adjacent regions do not share points.
+	inline bool contains(double theX, double theY) const
+	{
+		if(theX < mBounds[0].x || theX >= mBounds[1].x || theY < mBounds[0].y || theY >= mBounds[1].y)
+		{
+			return false;
+		}
+		return mPolygon.empty() || containedInPolygon(theX, theY);
+	}
+
+	/// Checks if region may contain points from box.
+	/// \return false only if box and bounds of region are disjoint
+	inline bool intersects(double theMinX, double theMinY, double theMaxX, double theMaxY) const
+	{
+		return theMinX < mBounds[1].x && theMaxX >= mBounds[0].x
+			&& theMinY < mBounds[1].y && theMaxY >= mBounds[0].y;
+	}
+
+	/// Checks if box lies completely inside of region
+	bool encloses(double theMinX, double theMinY, double theMaxX, double theMaxY) const;
+
+	/// Bounding rectangle of region
+	inline const BoundingRectangle& bounds() const
+	{
+		return mBounds;
+	}
+
+	/// True if region is rectangle
+	inline bool isRectangle() const
+	{
+		return mPolygon.empty();
+	}
+
+private:
+
+	/// Crossing number test against polygon vertices
+	bool containedInPolygon(double theX, double theY) const;
+
+	/// Bounds of region
+	BoundingRectangle mBounds;
+
+	/// Vertices of polygon, empty for rectangular region
+	mydefs::Points2d mPolygon;
+
+}; // class Region
+
+}
+} // namespace terrace::lidar
+
+#endif // TERRACE_REGION_HPP_INCLUDED
@@ -0,0 +1,118 @@
+/******************************************************************************
+ * spacefillingcurve.hpp
+ *
+ * Project:  terrace - A library for processing of Lidar
+ *           data.
+ * Purpose:  Morton (Z-order) and Hilbert codes of cells of a
+ *           2^16 x 2^16 grid. Used to order points and index
+ *           cells so that nearby cells get nearby codes.
+ * Author:   Vladimir Pajic, pajicv@gmail.com
+ *
+ ******************************************************************************
+ * Copyright (c) 2014, Vladimir Pajic
+ *
+ *****************************************************************************/
+
+#ifndef TERRACE_SPACEFILLINGCURVE_HPP_INCLUDED
+#define TERRACE_SPACEFILLINGCURVE_HPP_INCLUDED
+
+///////////////////////////////////////////////////////////////////////////////
+// Included dependacies
+
+#include <stdint.h>
+
+///////////////////////////////////////////////////////////////////////////////
+// Actual functions
+
+namespace terrace
+{
+namespace util
+{
+
+/// Space filling curves
+enum Curve
+{
+	MORTON,
+	HILBERT
+};
+
+/// Number of bits of column and row
+const unsigned int CURVE_BITS = 16;
+
+/// Moves lower 16 bits of theValue to even bit positions
+inline uint32_t spreadBits(uint32_t theValue)
+{
+	theValue &= 0x0000FFFF;
+	theValue = (theValue | (theValue << 8)) & 0x00FF00FF;
+	theValue = (theValue | (theValue << 4)) & 0x0F0F0F0F;
+	theValue = (theValue | (theValue << 2)) & 0x33333333;
+	theValue = (theValue | (theValue << 1)) & 0x55555555;
+	return theValue;
+}
+
+/// Inverse of spreadBits
+inline uint32_t compactBits(uint32_t theValue)
+{
+	theValue &= 0x55555555;
+	theValue = (theValue | (theValue >> 1)) & 0x33333333;
+	theValue = (theValue | (theValue >> 2)) & 0x0F0F0F0F;
+	theValue = (theValue | (theValue >> 4)) & 0x00FF00FF;
+	theValue = (theValue | (theValue >> 8)) & 0x0000FFFF;
+	return theValue;
+}
+
+/// Morton code of cell. Column bits are at even and row bits at
+/// odd positions, so the two highest bits select quadrant.
+inline uint32_t mortonCode(uint32_t theColumn, uint32_t theRow)
+{
+	return spreadBits(theColumn) | (spreadBits(theRow) << 1);
+}
+
+/// Column and row of cell with given Morton code
+inline void mortonDecode(uint32_t theCode, uint32_t& theColumn, uint32_t& theRow)
+{
+	theColumn = compactBits(theCode);
+	theRow = compactBits(theCode >> 1);
+}
+
+/// Hilbert code of cell
+inline uint32_t hilbertCode(uint32_t theColumn, uint32_t theRow)
+{
+	const uint32_t side = 1u << CURVE_BITS;
+	uint32_t x = theColumn & (side - 1);
+	uint32_t y = theRow & (side - 1);
+	uint32_t code = 0;
+
+	for(uint32_t s = side / 2; s > 0; s /= 2)
+	{
+		uint32_t rx = (x & s) ? 1 : 0;
+		uint32_t ry = (y & s) ? 1 : 0;
+		code += s * s * ((3 * rx) ^ ry);
+
+		// Rotate quadrant so the curve inside of it has base orientation
+		if(ry == 0)
+		{
+			if(rx == 1)
+			{
+				x = side - 1 - x;
+				y = side - 1 - y;
+			}
+			uint32_t t = x;
+			x = y;
+			y = t;
+		}
+	}
+
+	return code;
+}
+
+/// Code of cell on given curve
+inline uint32_t curveCode(Curve theCurve, uint32_t theColumn, uint32_t theRow)
+{
+	return theCurve == HILBERT ? hilbertCode(theColumn, theRow) : mortonCode(theColumn, theRow);
+}
+
+}
+} // namespace terrace::util
+
+#endif // TERRACE_SPACEFILLINGCURVE_HPP_INCLUDED
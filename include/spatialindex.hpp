@@ -0,0 +1,149 @@
+/******************************************************************************
+ * spatialindex.hpp
+ *
+ * Project:  terrace - A library for processing of Lidar
+ *           data.
+ * Purpose:  Sidecar spatial index of LAS file. Maps cells of a coarse
+ *           quadtree to contiguous ranges of point records that fall
+ *           in them, so only the relevant records have to be read.
+ * Author:   Vladimir Pajic, pajicv@gmail.com
+ *
+ ******************************************************************************
+ * Copyright (c) 2014, Vladimir Pajic
+ *
+ *****************************************************************************/
+
+#ifndef TERRACE_SPATIALINDEX_HPP_INCLUDED
+#define TERRACE_SPATIALINDEX_HPP_INCLUDED
+
+///////////////////////////////////////////////////////////////////////////////
+// Included dependacies
+
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+#include "terracedefs.hpp"
+#include "lasreader.hpp"
+#include "region.hpp"
+
+///////////////////////////////////////////////////////////////////////////////
+// Actual class
+
+namespace terrace
+{
+namespace lidar
+{
+
+///
+/// Leaf cells of the quadtree split the bounds from LAS header into
+/// 2^level x 2^level cells and are identified by Morton code of their
+/// column and row, so every quadtree node covers a contiguous range of
+/// codes. Only non-empty cells are stored. Cells on the border of the
+/// bounds also hold the points that lie outside of them.
+///
+/// Index file has fixed size header followed by Morton codes of cells
+/// (uint32), offsets of cell ranges (uint32, cells + 1) and record
+/// ranges (uint32 first record, uint32 number of records).
+///
+class SpatialIndex
+{
+public:
+
+	/// Version of index layout. Indexes of other versions are ignored.
+	static const uint32_t VERSION = 1;
+
+	/// Deepest level of quadtree
+	static const unsigned int MAX_LEVEL = 10;
+
+	/// Average number of points in leaf cell the level is chosen for
+	static const unsigned long CELL_POINTS = 100000;
+
+	/// Records of a cell that are separated by fewer records
+	/// than this are kept in one range
+	static const unsigned long MAX_GAP = 4096;
+
+	SpatialIndex();
+
+	/// Builds index of LAS file.
+	/// \param theSource path to LAS file
+	/// \return false if file cannot be read natively
+	bool build(const std::string& theSource);
+
+	/// Writes index to file
+	/// \return true if index is written
+	bool write(const std::string& theIndex) const;
+
+	/// Reads index from file if it is valid for source.
+	/// \param theIndex path to index file
+	/// \param theSource path to LAS file the index was built for
+	/// \return true if index is valid and read
+	bool read(const std::string& theIndex, const std::string& theSource);
+
+	/// Collects record ranges of the cells the region may contain points from.
+	/// \param theRegion region of interest
+	/// \param[out] theRanges ranges sorted by first record, without overlaps
+	void query(const Region& theRegion, std::vector<RecordRange>& theRanges) const;
+
+	/// Default path of index file, next to LAS file
+	static std::string sidecarPath(const std::string& theSource);
+
+	inline unsigned int level() const
+	{
+		return mLevel;
+	}
+
+	/// Number of non-empty leaf cells
+	inline std::size_t numberOfCells() const
+	{
+		return mCodes.size();
+	}
+
+	/// Number of record ranges of all cells
+	inline std::size_t numberOfRanges() const
+	{
+		return mRanges.size();
+	}
+
+private:
+
+	/// Adds ranges of cells with codes in [ theBegin, theEnd ) from quadtree
+	/// node theNode at depth theDepth whose rectangle intersects region
+	void collect(const Region& theRegion,
+				 uint32_t theNode,
+				 unsigned int theDepth,
+				 std::size_t theBegin,
+				 std::size_t theEnd,
+				 std::vector<RecordRange>& theRanges) const;
+
+	/// Rectangle of quadtree node. Nodes on the border of bounds extend
+	/// to infinity on that side.
+	wykobi::rectangle<double> nodeRectangle(uint32_t theNode, unsigned int theDepth) const;
+
+	/// Size and checksum of LAS file the index was built for
+	uint64_t mSourceSize;
+	uint64_t mSourceChecksum;
+	uint64_t mNumberOfPoints;
+
+	/// Bounds from LAS header split into cells
+	wykobi::rectangle<double> mBounds;
+
+	/// Depth of leaf cells
+	unsigned int mLevel;
+
+	/// Morton codes of non-empty leaf cells in ascending order
+	std::vector<uint32_t> mCodes;
+
+	/// Ranges of cell i are mRanges[mCellRanges[i]] ... mRanges[mCellRanges[i + 1] - 1]
+	std::vector<uint32_t> mCellRanges;
+
+	/// Record ranges of all cells
+	std::vector<RecordRange> mRanges;
+
+}; // class SpatialIndex
+
+}
+} // namespace terrace::lidar
+
+#endif // TERRACE_SPATIALINDEX_HPP_INCLUDED
@@ -37,6 +37,9 @@ enum locateresult {INTRIANGLE, ONEDGE, ONVERTEX, OUTSIDE};
 enum insertvertexresult {SUCCESSFULVERTEX, ENCROACHINGVERTEX, VIOLATINGVERTEX,
                          DUPLICATEVERTEX};
 
+/* Type of vertex inserted after triangulation */
+#define FREEVERTEX 2
+
 typedef REAL **triangle;
 
 struct otri {
@@ -246,6 +249,8 @@ struct triangulateio {
 //=====================================
 // Triangle functions
 
+void exactinit();
+
 void triangleinit(struct mesh *m);
 
 void parsecommandline(int argc, char **argv, struct behavior *b);
@@ -266,17 +271,28 @@ enum locateresult preciselocate(struct mesh *m, struct behavior *b,
                                 vertex searchpoint, struct otri *searchtri,
                                 int stopatsubsegment);
 
+enum locateresult locate(struct mesh *m, struct behavior *b,
+                         vertex searchpoint, struct otri *searchtri);
+
+enum locateresult hintlocate(struct mesh *m, struct behavior *b,
+                             vertex searchpoint, struct otri *searchtri);
+
 enum insertvertexresult insertvertex(struct mesh *m, struct behavior *b,
                                      vertex newvertex, struct otri *searchtri,
                                      struct osub *splitseg,
                                      int segmentflaws, int triflaws);
 
+void insertoutsidevertex(struct mesh *m, struct behavior *b,
+                         vertex newvertex, struct otri *searchtri);
+
  void deletevertex(struct mesh *m, struct behavior *b, struct otri *deltri);
 
  VOID *poolalloc(struct memorypool *pool);
 
  void pooldealloc(struct memorypool *pool, VOID *dyingitem);
 
+ void vertexdealloc(struct mesh *m, vertex dyingvertex);
+
  void boundingbox(struct mesh *m, struct behavior *b);
 
  long removebox(struct mesh *m, struct behavior *b);
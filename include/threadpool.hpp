@@ -0,0 +1,109 @@
+/******************************************************************************
+ * threadpool.hpp
+ *
+ * Project:  terrace - A library for processing of Lidar
+ *           data.
+ * Purpose:  Fixed set of worker threads that execute indexed tasks.
+ *           Calling thread takes part in the work, so a pool of one
+ *           thread runs everything inline.
+ * Author:   Vladimir Pajic, pajicv@gmail.com
+ *
+ ******************************************************************************
+ * Copyright (c) 2014, Vladimir Pajic
+ *
+ *****************************************************************************/
+
+#ifndef TERRACE_THREADPOOL_HPP_INCLUDED
+#define TERRACE_THREADPOOL_HPP_INCLUDED
+
+///////////////////////////////////////////////////////////////////////////////
+// Included dependacies
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////
+// Actual class
+
+namespace terrace
+{
+namespace util
+{
+
+class ThreadPool
+{
+public:
+
+	typedef std::function<void(unsigned int)> Task;
+
+	/// Starts worker threads.
+	/// \param theThreads total number of threads including the calling
+	/// one. 0 means one thread per hardware thread.
+	explicit ThreadPool(unsigned int theThreads = 0);
+
+	/// Stops and joins worker threads
+	~ThreadPool();
+
+	/// Number of threads that execute tasks (including the calling one)
+	inline unsigned int size() const
+	{
+		return static_cast<unsigned int>(mWorkers.size()) + 1;
+	}
+
+	/// Executes theTask(i) for every i in [0, theCount). Tasks are handed
+	/// out one at a time so uneven tasks are balanced between threads.
+	/// Returns when all tasks are finished. If any task throws, the first
+	/// exception is rethrown after all threads stopped working.
+	/// \param theCount number of tasks
+	/// \param theTask function that executes task with given index
+	void run(unsigned int theCount, const Task& theTask);
+
+	/// Number of hardware threads (at least 1)
+	static unsigned int hardwareThreads();
+
+private:
+
+	// Not copyable
+	ThreadPool(const ThreadPool&);
+	ThreadPool& operator=(const ThreadPool&);
+
+	/// Loop executed by worker threads
+	void workerLoop();
+
+	/// Takes tasks of current job until there are none left
+	void work();
+
+	std::vector<std::thread> mWorkers;
+
+	std::mutex mMutex;
+	/// Signals workers that new job is available or that pool stops
+	std::condition_variable mJobReady;
+	/// Signals calling thread that workers left the job
+	std::condition_variable mJobDone;
+
+	/// Task of current job
+	const Task* mTask;
+	/// Number of tasks in current job
+	unsigned int mCount;
+	/// Index of the next task to be taken
+	std::atomic<unsigned int> mNext;
+	/// Incremented for every job, so workers recognize new one
+	unsigned long mGeneration;
+	/// Number of workers still working on current job
+	unsigned int mActive;
+	/// First exception thrown by a task
+	std::exception_ptr mError;
+	/// Set when pool is destroyed
+	bool mStop;
+
+}; // class ThreadPool
+
+}
+} // namespace terrace::util
+
+#endif // TERRACE_THREADPOOL_HPP_INCLUDED
@@ -0,0 +1,154 @@
+/******************************************************************************
+ * tiledgroundclassifier.hpp
+ *
+ * Project:  terrace - A library for processing of Lidar
+ *           data.
+ * Purpose:  Ground classification of LAS file in square tiles, so
+ *           only one tile with its overlap buffer is in memory at a
+ *           time. Tiles are independent and every tile is written
+ *           to its own LAS file.
+ * Author:   Vladimir Pajic, pajicv@gmail.com
+ *
+ ******************************************************************************
+ * Copyright (c) 2014, Vladimir Pajic
+ *
+ *****************************************************************************/
+
+#ifndef TERRACE_TILEDGROUNDCLASSIFIER_HPP_INCLUDED
+#define TERRACE_TILEDGROUNDCLASSIFIER_HPP_INCLUDED
+
+///////////////////////////////////////////////////////////////////////////////
+// Included dependacies
+
+#include <string>
+
+#include "region.hpp"
+
+///////////////////////////////////////////////////////////////////////////////
+// Actual class
+
+namespace terrace
+{
+namespace lidar
+{
+namespace classification
+{
+
+///
+/// Tiles cover bounds of source from its lower left corner. Every tile
+/// is classified together with the points of a buffer around it, so
+/// the TIN near the tile border is supported by ground outside of the
+/// tile. Only points inside of the tile are written, so classification
+/// of a point in overlap zone is always taken from the tile that owns
+/// it. Tiles are half-open like Region, so every point belongs to
+/// exactly one tile.
+///
+/// Tiles read only their part of source if the source has a sidecar
+/// spatial index or a chunk table (see SpatialIndex and SaveOptions),
+/// otherwise every tile scans all point records.
+///
+class TiledGroundClassifier
+{
+public:
+
+	/// Constructor, thresholds are those of LidarDataset::classifyGround
+	/// \param theTileSize side of square tile
+	/// \param theBuffer width of overlap buffer around tile
+	TiledGroundClassifier(double theTileSize, double theBuffer,
+						  double theBlockSize, double theAngleTreshold,
+						  double theDistanceTreshold, double theEdgeLengthTreshold);
+
+	/// Reads header of source and lays out tiles over its bounds
+	/// \return true if source is LAS file with points
+	bool open(const std::string& theSource);
+
+	inline unsigned int columns() const
+	{
+		return mColumns;
+	}
+
+	inline unsigned int rows() const
+	{
+		return mRows;
+	}
+
+	/// Tile in column c and row r has index r * columns() + c
+	inline unsigned int numberOfTiles() const
+	{
+		return mColumns * mRows;
+	}
+
+	/// Grid index cell size shared by all tiles, so levels of
+	/// pyramid do not depend on the points of tile
+	inline double cellSize() const
+	{
+		return mCellSize;
+	}
+
+	/// Rectangle of tile without buffer. Tiles in the first and last
+	/// rows and columns extend to infinity on their outer side, so
+	/// points outside of bounds in header belong to a tile too.
+	Region tileBounds(unsigned int theTile) const;
+
+	/// Path of output file of tile, theDestination_column_row.las
+	std::string tilePath(const std::string& theDestination, unsigned int theTile) const;
+
+	/// Classifies one tile and writes its points to tilePath. Tiles
+	/// can be classified concurrently, or by separate processes that
+	/// open the same source. Nothing is written for tile without points.
+	/// Progress messages of tile are written to std::cout when it is
+	/// done, every line prefixed with column and row of tile.
+	/// \param theTile index of tile
+	/// \param theDestination prefix of output files
+	/// \param theThreads threads used for loading, classification and
+	/// writing (0 for all hardware threads)
+	/// \param[out] theGroundPoints number of ground points in tile
+	/// \return true if tile is classified and written
+	bool classifyTile(unsigned int theTile,
+					  const std::string& theDestination,
+					  unsigned int theThreads,
+					  unsigned long& theGroundPoints) const;
+
+	/// Classifies all tiles, theTiles of them at a time. Peak memory
+	/// grows with theTiles, not with the size of source.
+	/// \param theDestination prefix of output files
+	/// \param theTiles number of tiles classified concurrently
+	/// (0 for all hardware threads)
+	/// \return number of ground points in all tiles
+	unsigned long classify(const std::string& theDestination, unsigned int theTiles = 1) const;
+
+private:
+
+	std::string mSource;
+
+	double mTileSize;
+
+	double mBuffer;
+
+	/// Lower left corner of the first tile
+	double mMinX;
+	double mMinY;
+
+	unsigned int mColumns;
+
+	unsigned int mRows;
+
+	double mCellSize;
+
+	//============= Algorithm parameters ===========
+
+	double mBlockSize;
+
+	double mAngleTreshold;
+
+	double mDistanceTreshold;
+
+	double mEdgeLengthTreshold;
+
+}; // class TiledGroundClassifier
+
+}
+}
+} // namespace terrace::lidar::classification
+
+#endif // TERRACE_TILEDGROUNDCLASSIFIER_HPP_INCLUDED
@@ -59,14 +59,43 @@ public:
 	/// \return true if triangle is found, false otherwise
 	bool findTriangle(double theX, double theY, mydefs::Triangle3d& theTriangle3d) const;
 
-	/// NOT IMPLEMENTED BECAUSE TRIANGLE HAS 
-	/// UNDEFINED BEHAVIOR WHEN INSERTING VERTICES 
-	/// AFTER MESH CREATION
-	/// Inserts new vertex in TIN.
+	/// Searches for the triangle that contains specified coordinates,
+	/// walking from the hint instead of the most recently accessed
+	/// triangle. Search does not change TIN, so threads that keep their
+	/// own hints can search concurrently while no vertex is inserted.
+	/// \param theX x coordinate
+	/// \param theY y coordinate
+	/// \param[out] theTriangle coordinates of triangle vertices if 
+	/// triangle is found
+	/// \param[in,out] theHint triangle where search starts, set to the
+	/// found triangle, so searches of nearby points are short
+	/// \return true if triangle is found, false otherwise
+	bool findTriangle(double theX, double theY, mydefs::Triangle3d& theTriangle3d, 
+		TOrientedTriangle& theHint) const;
+
+	/// Coordinates of vertices of oriented triangle in the order origin,
+	/// destination, apex
+	/// \param theTriangle triangle of TIN, e.g. hint of findTriangle,
+	/// which is left at the hull triangle where search left TIN
+	/// \param[out] theTriangle3d coordinates of triangle vertices
+	void triangleVertices(const TOrientedTriangle& theTriangle, mydefs::Triangle3d& theTriangle3d) const;
+
+	/// Initial hint for findTriangle
+	/// \return the most recently accessed triangle
+	TOrientedTriangle hint() const
+	{
+		return *mRecentTri;
+	}
+
+	/// Inserts new vertex in TIN. Triangle containing the vertex is
+	/// split, or vertex outside of mesh is connected to visible hull 
+	/// edges, and edges are flipped until mesh is Delaunay again. So
+	/// TIN is the same as if it was created with the vertex.
 	/// \param theX x coordinate
 	/// \param theY y coordinate
 	/// \param theZ z coordinate (elevation)
-	/// \return returns true if vertex is succesfuly inserted, otherwise returns false
+	/// \return returns true if vertex is succesfuly inserted, false if
+	/// there is already vertex at its position
 	bool insertVertex(double theX, double theY, double theZ);
 
 	/// NOT IMPLEMENTED BECAUSE TRIANGLE CANNOT DELETE VERTICES 
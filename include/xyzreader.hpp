@@ -0,0 +1,120 @@
+/******************************************************************************
+ * xyzreader.hpp
+ *
+ * Project:  terrace - A library for processing of Lidar
+ *           data.
+ * Purpose:  Reader of delimited text files with one point per line.
+ *           The file is memory mapped, split at line boundaries and
+ *           parsed by several threads without allocations per line.
+ * Author:   Vladimir Pajic, pajicv@gmail.com
+ *
+ ******************************************************************************
+ * Copyright (c) 2014, Vladimir Pajic
+ *
+ *****************************************************************************/
+
+#ifndef TERRACE_XYZREADER_HPP_INCLUDED
+#define TERRACE_XYZREADER_HPP_INCLUDED
+
+///////////////////////////////////////////////////////////////////////////////
+// Included dependacies
+
+#include <string>
+#include <vector>
+
+#include "lidarpoint.hpp"
+#include "lidarmetadata.hpp"
+#include "mappedfile.hpp"
+#include "threadpool.hpp"
+
+///////////////////////////////////////////////////////////////////////////////
+// Actual class
+
+namespace terrace
+{
+namespace lidar
+{
+
+/// Layout of lines in text file. Columns are zero based,
+/// NO_COLUMN marks attribute that is not present in file.
+struct XyzFormat
+{
+public:
+
+	static const int NO_COLUMN = -1;
+
+	/// Characters that separate fields
+	std::string delimiters;
+	/// If true, run of delimiters is treated as one delimiter
+	/// (e.g. columns aligned with spaces)
+	bool mergeDelimiters;
+
+	int x;
+	int y;
+	int z;
+	int classification;
+	int intensity;
+
+	XyzFormat() : delimiters("\t"),
+				  mergeDelimiters(false),
+				  x(0),
+				  y(1),
+				  z(2),
+				  classification(NO_COLUMN),
+				  intensity(NO_COLUMN)
+	{
+	}
+};
+
+class XyzReader
+{
+public:
+
+	XyzReader() : mFile(), mMalformedLines(0)
+	{
+	}
+
+	/// Maps the file.
+	/// \param theSource path to text file
+	/// \return true if file is mapped
+	bool open(const std::string& theSource);
+
+	/// Parses all lines. File is split into blocks of BLOCK_SIZE bytes
+	/// at line boundaries and blocks are parsed by threads of the pool.
+	/// Points keep the order of lines in file.
+	/// \param theMetadata metadata used to quantize coordinates
+	/// \param theFormat layout of lines
+	/// \param thePool threads used for parsing
+	/// \param[out] thePoints parsed points are appended to this cloud,
+	/// intensity is stored if the cloud has intensity column
+	/// \param[out] theBoundingBox bounds of parsed points
+	/// \return number of parsed points
+	unsigned long readPoints(const LidarMetadata& theMetadata,
+							 const XyzFormat& theFormat,
+							 util::ThreadPool& thePool,
+							 PointCloud& thePoints,
+							 mydefs::BoundingBox& theBoundingBox);
+
+	/// Number of non empty lines that could not be parsed
+	/// by the last call of readPoints
+	inline unsigned long malformedLines() const
+	{
+		return mMalformedLines;
+	}
+
+	/// Approximate number of bytes parsed as one task
+	static const std::size_t BLOCK_SIZE = 16 << 20;
+
+private:
+
+	/// Mapped text file
+	util::MappedFile mFile;
+	/// Number of lines that could not be parsed
+	unsigned long mMalformedLines;
+
+}; // class XyzReader
+
+}
+} // namespace terrace::lidar
+
+#endif // TERRACE_XYZREADER_HPP_INCLUDED
@@ -0,0 +1,118 @@
+/******************************************************************************
+ * chunktable.cpp
+ *
+ *
+ ******************************************************************************
+ * Copyright (c) 2014, Vladimir Pajic
+ *
+ *****************************************************************************/
+
+///////////////////////////////////////////////////////////////////////////////
+// Included dependacies
+
+#include "chunktable.hpp"
+
+#include <algorithm>
+
+namespace terrace
+{
+namespace lidar
+{
+
+const char* const ChunkTable::USER_ID = "terrace";
+const uint16_t ChunkTable::RECORD_ID;
+const std::size_t ChunkTable::ENTRY_SIZE;
+
+void ChunkTable::encode(const std::vector<ChunkSummary>& theChunks, std::vector<las::VariableLengthRecord>& theVlrs)
+{
+	const std::size_t entriesPerVlr = las::MAX_VLR_DATA / ENTRY_SIZE;
+
+	for(std::size_t first = 0; first < theChunks.size(); first += entriesPerVlr)
+	{
+		std::size_t count = std::min(entriesPerVlr, theChunks.size() - first);
+
+		las::VariableLengthRecord vlr(USER_ID, RECORD_ID, "Chunk bounds");
+		vlr.data.resize(count * ENTRY_SIZE);
+
+		char* bytes = &vlr.data[0];
+		for(std::size_t i = first; i < first + count; ++i, bytes += ENTRY_SIZE)
+		{
+			const ChunkSummary& chunk = theChunks[i];
+			las::writeLE<uint32_t>(bytes, static_cast<uint32_t>(chunk.first));
+			las::writeLE<uint32_t>(bytes + 4, static_cast<uint32_t>(chunk.count));
+			for(unsigned int j = 0; j < 3; ++j)
+			{
+				las::writeLE<int32_t>(bytes + 8 + 4 * j, static_cast<int32_t>(chunk.min[j]));
+				las::writeLE<int32_t>(bytes + 20 + 4 * j, static_cast<int32_t>(chunk.max[j]));
+			}
+		}
+
+		theVlrs.push_back(vlr);
+	}
+}
+
+bool ChunkTable::decode(const std::vector<las::VariableLengthRecord>& theVlrs, std::vector<ChunkSummary>& theChunks)
+{
+	theChunks.clear();
+
+	bool found = false;
+	for(std::vector<las::VariableLengthRecord>::const_iterator it = theVlrs.begin(); it != theVlrs.end(); ++it)
+	{
+		if(!(*it).is(USER_ID, RECORD_ID))
+		{
+			continue;
+		}
+
+		found = true;
+
+		const char* bytes = (*it).data.empty() ? 0 : &(*it).data[0];
+		const char* end = bytes + (*it).data.size() / ENTRY_SIZE * ENTRY_SIZE;
+		for( ; bytes != end; bytes += ENTRY_SIZE)
+		{
+			ChunkSummary chunk;
+			chunk.first = las::readLE<uint32_t>(bytes);
+			chunk.count = las::readLE<uint32_t>(bytes + 4);
+			for(unsigned int j = 0; j < 3; ++j)
+			{
+				chunk.min[j] = las::readLE<int32_t>(bytes + 8 + 4 * j);
+				chunk.max[j] = las::readLE<int32_t>(bytes + 20 + 4 * j);
+			}
+			theChunks.push_back(chunk);
+		}
+	}
+
+	return found;
+}
+
+void ChunkTable::query(const std::vector<ChunkSummary>& theChunks,
+					   const las::Header& theHeader,
+					   const Region& theRegion,
+					   std::vector<RecordRange>& theRanges)
+{
+	theRanges.clear();
+
+	for(std::vector<ChunkSummary>::const_iterator it = theChunks.begin(); it != theChunks.end(); ++it)
+	{
+		if((*it).count == 0
+			|| !theRegion.intersects(
+				(*it).min[0] * theHeader.scale[0] + theHeader.offset[0],
+				(*it).min[1] * theHeader.scale[1] + theHeader.offset[1],
+				(*it).max[0] * theHeader.scale[0] + theHeader.offset[0],
+				(*it).max[1] * theHeader.scale[1] + theHeader.offset[1]))
+		{
+			continue;
+		}
+
+		if(!theRanges.empty() && theRanges.back().first + theRanges.back().count == (*it).first)
+		{
+			theRanges.back().count += (*it).count;
+		}
+		else
+		{
+			theRanges.push_back(RecordRange((*it).first, (*it).count));
+		}
+	}
+}
+
+}
+} // namespace terrace::lidar
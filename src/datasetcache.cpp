@@ -0,0 +1,370 @@
+/******************************************************************************
+ * datasetcache.cpp
+ *
+ *
+ ******************************************************************************
+ * Copyright (c) 2014, Vladimir Pajic
+ *
+ *****************************************************************************/
+
+///////////////////////////////////////////////////////////////////////////////
+// Included dependacies
+
+#include "datasetcache.hpp"
+#include "lidardataset.hpp"
+#include "lasformat.hpp"
+#include "mappedfile.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+namespace terrace
+{
+namespace lidar
+{
+
+const uint32_t DatasetCache::VERSION;
+const uint64_t DatasetCache::SECTION_ALIGNMENT;
+const unsigned int DatasetCache::CHECKSUM_SAMPLES;
+const unsigned int DatasetCache::CHECKSUM_BLOCK;
+
+namespace
+{
+
+const char MAGIC[8] = { 'T', 'R', 'C', 'A', 'C', 'H', 'E', '\0' };
+
+/// Sections of cache file in the order they are written
+enum Section
+{
+	SECTION_X = 0,
+	SECTION_Y,
+	SECTION_Z,
+	SECTION_CLASSIFICATION,
+	SECTION_CELL_OFFSETS,
+	SECTION_CELL_INDICES,
+	NUMBER_OF_SECTIONS
+};
+
+/// Fixed size header of cache file. Fields are ordered so
+/// the structure has no padding.
+struct CacheHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t headerSize;
+	uint64_t sourceSize;
+	uint64_t sourceChecksum;
+	uint64_t numberOfPoints;
+	double offsets[3];
+	double scales[3];
+	double bounds[6];
+	double density;
+	double cellSize;
+	double extent[4];
+	uint32_t rows;
+	uint32_t columns;
+	/// 1 if points are in the order of source records
+	uint32_t recordOrder;
+	/// util::Curve points are reordered along if recordOrder is 0
+	uint32_t curve;
+	/// 1 if cell size was estimated from point density
+	uint32_t estimatedCellSize;
+	uint32_t reserved;
+	uint64_t sections[NUMBER_OF_SECTIONS];
+};
+
+/// FNV-1a hash of a block of bytes
+uint64_t hashBytes(uint64_t theHash, const char* theBytes, std::size_t theSize)
+{
+	for(const char* end = theBytes + theSize; theBytes != end; ++theBytes)
+	{
+		theHash ^= static_cast<unsigned char>(*theBytes);
+		theHash *= 1099511628211ULL;
+	}
+	return theHash;
+}
+
+inline uint64_t alignOffset(uint64_t theOffset)
+{
+	return (theOffset + DatasetCache::SECTION_ALIGNMENT - 1) / DatasetCache::SECTION_ALIGNMENT
+		* DatasetCache::SECTION_ALIGNMENT;
+}
+
+/// Sequential writer of cache sections
+class SectionWriter
+{
+public:
+
+	SectionWriter(std::FILE* theFile) : mFile(theFile), mOffset(0), mGood(true)
+	{
+	}
+
+	void write(const void* theData, std::size_t theSize)
+	{
+		if(mGood && theSize > 0)
+		{
+			mGood = std::fwrite(theData, 1, theSize, mFile) == theSize;
+			mOffset += theSize;
+		}
+	}
+
+	/// Pads file to the next section boundary.
+	/// \return file offset of the next section
+	uint64_t align()
+	{
+		static const char zeros[DatasetCache::SECTION_ALIGNMENT] = { 0 };
+		write(zeros, static_cast<std::size_t>(alignOffset(mOffset) - mOffset));
+		return mOffset;
+	}
+
+	inline bool good() const
+	{
+		return mGood;
+	}
+
+private:
+	std::FILE* mFile;
+	uint64_t mOffset;
+	bool mGood;
+};
+
+} // anonymous namespace
+
+bool DatasetCache::checksum(const std::string& theSource, uint64_t& theSize, uint64_t& theChecksum)
+{
+	util::MappedFile source;
+	if(!source.open(theSource))
+	{
+		return false;
+	}
+
+	theSize = source.size();
+
+	// Header and variable length records are hashed completely
+	std::size_t headerBytes = std::min<std::size_t>(source.size(), 1 << 16);
+	las::Header lasHeader;
+	if(las::decodeHeader(source.data(), source.size(), lasHeader))
+	{
+		headerBytes = std::min<std::size_t>(source.size(), lasHeader.pointDataOffset);
+	}
+
+	uint64_t hash = 14695981039346656037ULL;
+	hash = hashBytes(hash, reinterpret_cast<const char*>(&theSize), sizeof(theSize));
+	hash = hashBytes(hash, source.data(), headerBytes);
+
+	// Sample of point data, including its last block
+	std::size_t dataBytes = source.size() - headerBytes;
+	if(dataBytes > 0)
+	{
+		for(unsigned int i = 0; i < CHECKSUM_SAMPLES; ++i)
+		{
+			std::size_t blockSize = std::min<std::size_t>(CHECKSUM_BLOCK, dataBytes);
+			std::size_t position = headerBytes
+				+ static_cast<std::size_t>((dataBytes - blockSize) * (static_cast<double>(i) / (CHECKSUM_SAMPLES - 1)));
+			hash = hashBytes(hash, source.data() + position, blockSize);
+		}
+	}
+
+	theChecksum = hash;
+
+	return true;
+}
+
+bool DatasetCache::write(const std::string& theCache, const LoadOptions& theOptions, 
+						 const LidarDataset& theDataset)
+{
+	const PointCloud& points = theDataset.mPoints;
+	const LidarMetadata& metadata = theDataset.mMetadata;
+	const GridIndex& gridIndex = theDataset.mGridIndex;
+
+	// Cache holds index with all points
+	if(gridIndex.mode() != GridIndex::ALL_POINTS)
+	{
+		return false;
+	}
+
+	CacheHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.headerSize = sizeof(CacheHeader);
+
+	if(!checksum(theDataset.mSource, header.sourceSize, header.sourceChecksum))
+	{
+		return false;
+	}
+
+	header.numberOfPoints = points.size();
+	header.offsets[0] = metadata.offsets().x;
+	header.offsets[1] = metadata.offsets().y;
+	header.offsets[2] = metadata.offsets().z;
+	header.scales[0] = metadata.scales().x;
+	header.scales[1] = metadata.scales().y;
+	header.scales[2] = metadata.scales().z;
+	for(unsigned int i = 0; i < 3; ++i)
+	{
+		header.bounds[i] = metadata.boundingBox()[0][i];
+		header.bounds[i + 3] = metadata.boundingBox()[1][i];
+	}
+	header.density = theDataset.mDensity;
+	header.cellSize = gridIndex.cellSize();
+	header.extent[0] = gridIndex.extent()[0].x;
+	header.extent[1] = gridIndex.extent()[0].y;
+	header.extent[2] = gridIndex.extent()[1].x;
+	header.extent[3] = gridIndex.extent()[1].y;
+	header.rows = gridIndex.rows();
+	header.columns = gridIndex.columns();
+	header.recordOrder = theDataset.mRecordOrder ? 1 : 0;
+	header.curve = static_cast<uint32_t>(theDataset.mCurve);
+	header.estimatedCellSize = theOptions.cellSize > 0 ? 0 : 1;
+
+	// Grid index is already in compressed row form
+	const std::vector<uint32_t>& cellOffsets = gridIndex.offsets();
+	const std::vector<uint32_t>& cellIndices = gridIndex.indices();
+
+	std::FILE* file = std::fopen(theCache.c_str(), "wb");
+	if(file == 0)
+	{
+		return false;
+	}
+
+	// Header is written twice, the second time with section offsets
+	SectionWriter writer(file);
+	writer.write(&header, sizeof(header));
+
+	// Sections have the layout of the columns of the cloud
+	header.sections[SECTION_X] = writer.align();
+	writer.write(points.xData(), points.size() * sizeof(int32_t));
+	header.sections[SECTION_Y] = writer.align();
+	writer.write(points.yData(), points.size() * sizeof(int32_t));
+	header.sections[SECTION_Z] = writer.align();
+	writer.write(points.zData(), points.size() * sizeof(int32_t));
+	header.sections[SECTION_CLASSIFICATION] = writer.align();
+	writer.write(points.classificationData(), points.size());
+
+	header.sections[SECTION_CELL_OFFSETS] = writer.align();
+	writer.write(&cellOffsets[0], cellOffsets.size() * sizeof(uint32_t));
+	header.sections[SECTION_CELL_INDICES] = writer.align();
+	writer.write(cellIndices.empty() ? 0 : &cellIndices[0], cellIndices.size() * sizeof(uint32_t));
+
+	bool result = writer.good()
+		&& std::fseek(file, 0, SEEK_SET) == 0
+		&& std::fwrite(&header, 1, sizeof(header), file) == sizeof(header);
+
+	result = (std::fclose(file) == 0) && result;
+
+	if(!result)
+	{
+		std::remove(theCache.c_str());
+	}
+
+	return result;
+}
+
+bool DatasetCache::read(const std::string& theCache, const std::string& theSource, 
+						const LoadOptions& theOptions, LidarDataset& theDataset)
+{
+	util::MappedFile cache;
+	if(!cache.open(theCache) || cache.size() < sizeof(CacheHeader))
+	{
+		return false;
+	}
+
+	CacheHeader header;
+	std::memcpy(&header, cache.data(), sizeof(header));
+
+	if(std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0
+		|| header.version != VERSION
+		|| header.headerSize != sizeof(CacheHeader))
+	{
+		return false;
+	}
+
+	uint64_t sourceSize;
+	uint64_t sourceChecksum;
+	if(!checksum(theSource, sourceSize, sourceChecksum)
+		|| sourceSize != header.sourceSize
+		|| sourceChecksum != header.sourceChecksum)
+	{
+		theDataset.log() << "Cache " << theCache << " is stale.\n";
+		return false;
+	}
+
+	// Cache written with other options is rewritten
+	const bool orderMatches = theOptions.reorder
+		? header.recordOrder == 0 && header.curve == static_cast<uint32_t>(theOptions.curve)
+		: header.recordOrder != 0;
+	const bool cellSizeMatches = theOptions.cellSize > 0
+		? header.estimatedCellSize == 0 && header.cellSize == theOptions.cellSize
+		: header.estimatedCellSize != 0;
+	if(!orderMatches || !cellSizeMatches)
+	{
+		theDataset.log() << "Cache " << theCache << " was written with other load options.\n";
+		return false;
+	}
+
+	uint64_t numberOfCells = static_cast<uint64_t>(header.rows) * header.columns;
+	uint64_t sizes[NUMBER_OF_SECTIONS] = {
+		header.numberOfPoints * sizeof(int32_t),
+		header.numberOfPoints * sizeof(int32_t),
+		header.numberOfPoints * sizeof(int32_t),
+		header.numberOfPoints,
+		(numberOfCells + 1) * sizeof(uint32_t),
+		header.numberOfPoints * sizeof(uint32_t) };
+	for(unsigned int i = 0; i < NUMBER_OF_SECTIONS; ++i)
+	{
+		if(header.sections[i] + sizes[i] > cache.size())
+		{
+			return false;
+		}
+	}
+
+	const int32_t* x = reinterpret_cast<const int32_t*>(cache.data() + header.sections[SECTION_X]);
+	const int32_t* y = reinterpret_cast<const int32_t*>(cache.data() + header.sections[SECTION_Y]);
+	const int32_t* z = reinterpret_cast<const int32_t*>(cache.data() + header.sections[SECTION_Z]);
+	const unsigned char* cls = reinterpret_cast<const unsigned char*>(cache.data() + header.sections[SECTION_CLASSIFICATION]);
+	const uint32_t* cellOffsets = reinterpret_cast<const uint32_t*>(cache.data() + header.sections[SECTION_CELL_OFFSETS]);
+	const uint32_t* cellIndices = reinterpret_cast<const uint32_t*>(cache.data() + header.sections[SECTION_CELL_INDICES]);
+
+	if(cellOffsets[numberOfCells] != header.numberOfPoints)
+	{
+		return false;
+	}
+
+	LidarMetadata& metadata = theDataset.mMetadata;
+	metadata.setNumberOfPoints(static_cast<unsigned long>(header.numberOfPoints));
+	metadata.setOffsets(wykobi::make_vector(header.offsets[0], header.offsets[1], header.offsets[2]));
+	metadata.setScales(wykobi::make_vector(header.scales[0], header.scales[1], header.scales[2]));
+	metadata.setBoundingBox(wykobi::make_box(header.bounds[0], header.bounds[1], header.bounds[2],
+		header.bounds[3], header.bounds[4], header.bounds[5]));
+
+	PointCloud& points = theDataset.mPoints;
+	std::size_t numberOfPoints = static_cast<std::size_t>(header.numberOfPoints);
+	points.clear();
+	points.setMetadata(metadata);
+	points.resize(numberOfPoints);
+	if(numberOfPoints > 0)
+	{
+		std::memcpy(points.xData(), x, numberOfPoints * sizeof(int32_t));
+		std::memcpy(points.yData(), y, numberOfPoints * sizeof(int32_t));
+		std::memcpy(points.zData(), z, numberOfPoints * sizeof(int32_t));
+		std::memcpy(points.classificationData(), cls, numberOfPoints);
+	}
+
+	theDataset.mGridIndex.assign(
+		wykobi::make_rectangle(header.extent[0], header.extent[1], header.extent[2], header.extent[3]),
+		header.cellSize, header.rows, header.columns, cellOffsets, cellIndices);
+
+	theDataset.mDensity = header.density;
+	theDataset.mSource = theSource;
+	theDataset.mRecordOrder = header.recordOrder != 0;
+	theDataset.mCurve = static_cast<util::Curve>(header.curve);
+
+	return true;
+}
+
+}
+} // namespace terrace::lidar
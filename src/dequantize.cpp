@@ -0,0 +1,90 @@
+/******************************************************************************
+ * dequantize.cpp
+ *
+ *
+ ******************************************************************************
+ * Copyright (c) 2014, Vladimir Pajic
+ *
+ *****************************************************************************/
+
+///////////////////////////////////////////////////////////////////////////////
+// Included dependacies
+
+#include "dequantize.hpp"
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace terrace
+{
+namespace util
+{
+
+void dequantize(const int32_t* theValues, std::size_t theCount,
+				double theScale, double theOffset, double* theResult)
+{
+	std::size_t i = 0;
+
+#if defined(__AVX512F__)
+	const __m512d scale = _mm512_set1_pd(theScale);
+	const __m512d offset = _mm512_set1_pd(theOffset);
+	for( ; i + 8 <= theCount; i += 8)
+	{
+		__m256i values = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(theValues + i));
+		__m512d result = _mm512_add_pd(_mm512_mul_pd(_mm512_cvtepi32_pd(values), scale), offset);
+		_mm512_storeu_pd(theResult + i, result);
+	}
+#elif defined(__AVX2__)
+	const __m256d scale = _mm256_set1_pd(theScale);
+	const __m256d offset = _mm256_set1_pd(theOffset);
+	for( ; i + 4 <= theCount; i += 4)
+	{
+		__m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(theValues + i));
+		__m256d result = _mm256_add_pd(_mm256_mul_pd(_mm256_cvtepi32_pd(values), scale), offset);
+		_mm256_storeu_pd(theResult + i, result);
+	}
+#endif
+
+	for( ; i < theCount; ++i)
+	{
+		double value = theValues[i] * theScale;
+		theResult[i] = value + theOffset;
+	}
+}
+
+void dequantize(const int32_t* theValues, std::size_t theCount,
+				double theScale, double theOffset, float* theResult)
+{
+	std::size_t i = 0;
+
+	// Computed in double and rounded to float once
+#if defined(__AVX512F__)
+	const __m512d scale = _mm512_set1_pd(theScale);
+	const __m512d offset = _mm512_set1_pd(theOffset);
+	for( ; i + 8 <= theCount; i += 8)
+	{
+		__m256i values = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(theValues + i));
+		__m512d result = _mm512_add_pd(_mm512_mul_pd(_mm512_cvtepi32_pd(values), scale), offset);
+		_mm256_storeu_ps(theResult + i, _mm512_cvtpd_ps(result));
+	}
+#elif defined(__AVX2__)
+	const __m256d scale = _mm256_set1_pd(theScale);
+	const __m256d offset = _mm256_set1_pd(theOffset);
+	for( ; i + 4 <= theCount; i += 4)
+	{
+		__m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(theValues + i));
+		__m256d result = _mm256_add_pd(_mm256_mul_pd(_mm256_cvtepi32_pd(values), scale), offset);
+		_mm_storeu_ps(theResult + i, _mm256_cvtpd_ps(result));
+	}
+#endif
+
+	for( ; i < theCount; ++i)
+	{
+		double value = theValues[i] * theScale;
+		theResult[i] = static_cast<float>(value + theOffset);
+	}
+}
+
+}
+} // namespace terrace::util
@@ -9,17 +9,118 @@
 
 #include "gridindex.hpp"
 #include "lidarmetadata.hpp"
+#include "radixsort.hpp"
+#include "threadpool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
 #include <iostream>
+#include <limits>
 
 namespace terrace
 {
 namespace lidar
 {
 
-void GridIndex::create(const LidarMetadata& theMetadata, std::vector<LidarPoint>& thePoints, double theCellSize)
+namespace
 {
-	clear();
 
+/// Number of parallel blocks for theCount items. There are a few
+/// blocks per thread, but not blocks smaller than 1 << 16 items.
+unsigned int blocks(std::size_t theCount, const util::ThreadPool& thePool)
+{
+	const std::size_t minimalBlock = 1 << 16;
+	return static_cast<unsigned int>(std::max<std::size_t>(1,
+		std::min<std::size_t>(4 * thePool.size(), theCount / minimalBlock)));
+}
+
+/// Key ordered by elevation and then by index of point. Key of
+/// empty cell is larger than all keys and its index is NO_POINT.
+inline uint64_t lowestKey(int32_t theZ, uint32_t thePoint)
+{
+	return (uint64_t(uint32_t(theZ) ^ 0x80000000u) << 32) | thePoint;
+}
+
+const uint64_t EMPTY_KEY = ~uint64_t(0);
+
+/// Cell of coordinate offset from grid origin, clamped to [0, theCount - 1]
+inline unsigned int clampedCell(double theOffset, double theCellSize, unsigned int theCount)
+{
+	double cell = std::floor(theOffset / theCellSize);
+	if(cell < 0)
+	{
+		return 0;
+	}
+	if(cell >= theCount)
+	{
+		return theCount - 1;
+	}
+	return unsigned int(cell);
+}
+
+/// Squared distance from value to interval [theMin, theMax]
+inline double squaredGap(double theValue, double theMin, double theMax)
+{
+	double gap = theValue < theMin ? theMin - theValue : (theValue > theMax ? theValue - theMax : 0.0);
+	return gap * gap;
+}
+
+/// Runs theQuery(i, found) for every query in parallel blocks and
+/// concatenates found points by query. Blocks collect their points
+/// first, so result is filled once counts of all queries are known.
+void collectBatch(std::size_t theCount, 
+				  util::ThreadPool& thePool, 
+				  const std::function<void(std::size_t, std::vector<uint32_t>&)>& theQuery, 
+				  std::vector<uint32_t>& theResult, 
+				  std::vector<std::size_t>& theOffsets)
+{
+	theOffsets.assign(theCount + 1, 0);
+	theResult.clear();
+	if(theCount == 0)
+	{
+		return;
+	}
+
+	// Small blocks are handed out one at a time, so threads stay balanced
+	const std::size_t blockSize = 1024;
+	const unsigned int numberOfBlocks = static_cast<unsigned int>((theCount + blockSize - 1) / blockSize);
+	std::vector< std::vector<uint32_t> > blockResults(numberOfBlocks);
+
+	thePool.run(numberOfBlocks, [&](unsigned int block)
+	{
+		std::vector<uint32_t> found;
+		std::vector<uint32_t>& blockResult = blockResults[block];
+		std::size_t end = std::min(theCount, (block + 1) * blockSize);
+		for(std::size_t i = block * blockSize; i < end; ++i)
+		{
+			theQuery(i, found);
+			blockResult.insert(blockResult.end(), found.begin(), found.end());
+			theOffsets[i + 1] = found.size();
+		}
+	});
+
+	// Counts become offsets
+	for(std::size_t i = 0; i < theCount; ++i)
+	{
+		theOffsets[i + 1] += theOffsets[i];
+	}
+
+	theResult.resize(theOffsets[theCount]);
+	thePool.run(numberOfBlocks, [&](unsigned int block)
+	{
+		const std::vector<uint32_t>& blockResult = blockResults[block];
+		std::copy(blockResult.begin(), blockResult.end(), theResult.begin() + theOffsets[block * blockSize]);
+	});
+}
+
+} // anonymous namespace
+
+const uint32_t GridIndex::NO_CELL;
+
+void GridIndex::setGeometry(const LidarMetadata& theMetadata, double theCellSize)
+{
 	if(theCellSize > 0)
 	{
 		mCellSize = theCellSize;
@@ -38,16 +139,78 @@ void GridIndex::create(const LidarMetadata& theMetadata, std::vector<LidarPoint>
 
 	mRows =  unsigned int((mExtent[1].y - mExtent[0].y) / mCellSize) + 1;
 	mCols =  unsigned int((mExtent[1].x - mExtent[0].x) / mCellSize) + 1;
+}
+
+DensityEstimator::DensityEstimator(const LidarMetadata& theMetadata, double theCellSize) :
+	mMinX(theMetadata.boundingBox()[0].x),
+	mMaxY(theMetadata.boundingBox()[1].y),
+	mCellSize(theCellSize > 0 ? theCellSize : 1.0),
+	mRows(unsigned int((theMetadata.boundingBox()[1].y - theMetadata.boundingBox()[0].y) / mCellSize) + 1),
+	mCols(unsigned int((theMetadata.boundingBox()[1].x - theMetadata.boundingBox()[0].x) / mCellSize) + 1),
+	mPoints(0),
+	mCounts(mRows * mCols, 0)
+{
+}
+
+double DensityEstimator::density() const
+{
+	unsigned long occupiedCells = 0;
+	for(std::vector<unsigned int>::const_iterator it = mCounts.begin(); it != mCounts.end(); ++it)
+	{
+		if(*it != 0)
+		{
+			++occupiedCells;
+		}
+	}
+
+	if(occupiedCells == 0)
+	{
+		return 0.0;
+	}
+
+	return double(mPoints) / (occupiedCells * mCellSize * mCellSize);
+}
 
-	mCells = new std::vector<Cell>(mRows * mCols);
-	
-	for(LidarPoint::VectorIterator pointsIt = thePoints.begin(); 
-		pointsIt != thePoints.end(); ++pointsIt)
+void GridIndex::create(const LidarMetadata& theMetadata, PointCloud& thePoints, 
+						util::ThreadPool& thePool, double theCellSize, Mode theMode)
+{
+	if(theMode == LOWEST_POINT)
 	{
-		unsigned int c = x2col((*pointsIt).realCoords().x);
-		unsigned int r = y2row((*pointsIt).realCoords().y);
-		mCells->operator[](index(r, c)).push_back(pointsIt);
+		// Keys of insert are not needed, createLowest merges its own
+		clear();
+		setGeometry(theMetadata, theCellSize);
+		mMode = theMode;
+		mOffsets.clear();
+		createLowest(thePoints, thePool);
+		return;
 	}
+
+	reset(theMetadata, theCellSize, theMode);
+
+	const std::size_t numberOfPoints = thePoints.size();
+	const unsigned int numberOfBlocks = blocks(numberOfPoints, thePool);
+	const std::size_t blockSize = (numberOfPoints + numberOfBlocks - 1) / numberOfBlocks;
+
+	mPointCells.resize(numberOfPoints);
+
+	thePool.run(numberOfBlocks, [&](unsigned int block)
+	{
+		// Coordinates are converted a part of block at a time
+		std::vector<double> xs(PointCloud::COORDS_BLOCK);
+		std::vector<double> ys(PointCloud::COORDS_BLOCK);
+		std::size_t end = std::min(numberOfPoints, (block + 1) * blockSize);
+		for(std::size_t first = block * blockSize; first < end; first += PointCloud::COORDS_BLOCK)
+		{
+			std::size_t count = std::min(PointCloud::COORDS_BLOCK, end - first);
+			thePoints.realCoords(first, count, &xs[0], &ys[0], 0);
+			for(std::size_t i = 0; i < count; ++i)
+			{
+				unsigned int c = x2col(xs[i]);
+				unsigned int r = y2row(ys[i]);
+				mPointCells[first + i] = index(r, c);
+			}
+		}
+	});
 	//LidarPoint::VectorIterator pointsIt = thePoints.begin();
 	//for(unsigned int i = 0; i < thePoints.size(); ++i)
 	//{
@@ -55,15 +218,551 @@ void GridIndex::create(const LidarMetadata& theMetadata, std::vector<LidarPoint>
 	//	unsigned int r = y2row(thePoints[i].realCoords().y);
 	//	mCells->operator[](index(r, c)).push_back(pointsIt + i);
 	//}
-	
-	for(std::vector< Cell >::iterator cellsIt = mCells->begin(); cellsIt != mCells->end(); ++cellsIt)
+
+	finish(thePoints, thePool);
+}
+
+void GridIndex::reset(const LidarMetadata& theMetadata, double theCellSize, Mode theMode)
+{
+	clear();
+
+	setGeometry(theMetadata, theCellSize);
+
+	mMode = theMode;
+	if(mMode == LOWEST_POINT)
+	{
+		mOffsets.clear();
+		mLowestKeys.assign(mRows * mCols, EMPTY_KEY);
+	}
+	else
+	{
+		mOffsets.assign(mRows * mCols + 1, 0);
+	}
+}
+
+void GridIndex::createLowest(const PointCloud& thePoints, util::ThreadPool& thePool)
+{
+	const std::size_t numberOfPoints = thePoints.size();
+	const unsigned int numberOfBlocks = blocks(numberOfPoints, thePool);
+	const std::size_t blockSize = (numberOfPoints + numberOfBlocks - 1) / numberOfBlocks;
+	const int32_t* z = thePoints.zData();
+
+	// Keys of blocks are merged with compare and swap, the smallest
+	// key wins regardless of order in which blocks are processed
+	std::vector< std::atomic<uint64_t> > keys(mRows * mCols);
+	for(std::size_t i = 0; i < keys.size(); ++i)
+	{
+		keys[i].store(EMPTY_KEY, std::memory_order_relaxed);
+	}
+
+	thePool.run(numberOfBlocks, [&](unsigned int block)
+	{
+		std::vector<double> xs(PointCloud::COORDS_BLOCK);
+		std::vector<double> ys(PointCloud::COORDS_BLOCK);
+		std::size_t end = std::min(numberOfPoints, (block + 1) * blockSize);
+		for(std::size_t first = block * blockSize; first < end; first += PointCloud::COORDS_BLOCK)
+		{
+			std::size_t count = std::min(PointCloud::COORDS_BLOCK, end - first);
+			thePoints.realCoords(first, count, &xs[0], &ys[0], 0);
+			for(std::size_t i = 0; i < count; ++i)
+			{
+				std::atomic<uint64_t>& lowest = keys[index(y2row(ys[i]), x2col(xs[i]))];
+				uint64_t key = lowestKey(z[first + i], static_cast<uint32_t>(first + i));
+				uint64_t current = lowest.load(std::memory_order_relaxed);
+				while(key < current && !lowest.compare_exchange_weak(current, key, std::memory_order_relaxed))
+				{
+				}
+			}
+		}
+	});
+
+	mLowest.resize(keys.size());
+	for(std::size_t i = 0; i < keys.size(); ++i)
+	{
+		mLowest[i] = static_cast<uint32_t>(keys[i].load(std::memory_order_relaxed));
+	}
+	mNumberOfPoints = numberOfPoints;
+}
+
+bool GridIndex::insert(PointCloud& thePoints, std::size_t theFirst, std::size_t theCount)
+{
+	std::vector<double> xs(PointCloud::COORDS_BLOCK);
+	std::vector<double> ys(PointCloud::COORDS_BLOCK);
+	if(mMode == ALL_POINTS && theFirst + theCount > mPointCells.size())
+	{
+		mPointCells.resize(theFirst + theCount, NO_CELL);
+	}
+
+	for(std::size_t first = theFirst; first < theFirst + theCount; first += PointCloud::COORDS_BLOCK)
+	{
+		std::size_t count = std::min(PointCloud::COORDS_BLOCK, theFirst + theCount - first);
+		thePoints.realCoords(first, count, &xs[0], &ys[0], 0);
+		for(std::size_t i = 0; i < count; ++i)
+		{
+			unsigned int cell;
+			if(!findCell(xs[i], ys[i], cell))
+			{
+				return false;
+			}
+
+			if(mMode == LOWEST_POINT)
+			{
+				uint64_t key = lowestKey(thePoints.z(first + i), static_cast<uint32_t>(first + i));
+				mLowestKeys[cell] = std::min(mLowestKeys[cell], key);
+				++mNumberOfPoints;
+			}
+			else
+			{
+				mPointCells[first + i] = cell;
+			}
+		}
+	}
+
+	return true;
+}
+
+void GridIndex::finish(const PointCloud& thePoints, util::ThreadPool& thePool)
+{
+	const unsigned int numberOfCells = mRows * mCols;
+
+	if(mMode == LOWEST_POINT)
+	{
+		mLowest.resize(mLowestKeys.size());
+		for(std::size_t i = 0; i < mLowestKeys.size(); ++i)
+		{
+			mLowest[i] = static_cast<uint32_t>(mLowestKeys[i]);
+		}
+		std::vector<uint64_t>().swap(mLowestKeys);
+		return;
+	}
+
+	const std::size_t numberOfKeys = mPointCells.size();
+
+	// Key holds cell in high and point index in low 32 bits. Points
+	// that are not inserted get cell past the last one and sort last.
+	std::vector<uint64_t> keys(numberOfKeys);
+	unsigned int numberOfBlocks = blocks(numberOfKeys, thePool);
+	std::size_t blockSize = (numberOfKeys + numberOfBlocks - 1) / numberOfBlocks;
+	thePool.run(numberOfBlocks, [&](unsigned int block)
+	{
+		std::size_t end = std::min(numberOfKeys, (block + 1) * blockSize);
+		for(std::size_t i = block * blockSize; i < end; ++i)
+		{
+			uint64_t cell = mPointCells[i] != NO_CELL ? mPointCells[i] : numberOfCells;
+			keys[i] = (cell << 32) | i;
+		}
+	});
+
+	std::vector<uint32_t>().swap(mPointCells);
+
+	unsigned int cellBits = 0;
+	while((uint64_t(1) << cellBits) <= numberOfCells)
+	{
+		++cellBits;
+	}
+
+	// Sort is stable, so indices inside of a cell ascend
+	util::radixSort(keys, 32, 32 + cellBits, thePool);
+
+	// Cell c starts at the first key whose cell is not smaller than c.
+	// Every offset is written by exactly one thread.
+	mOffsets.assign(numberOfCells + 1, 0);
+	thePool.run(numberOfBlocks, [&](unsigned int block)
 	{
-		if( !(*cellsIt).empty() )
+		std::size_t end = std::min(numberOfKeys, (block + 1) * blockSize);
+		for(std::size_t i = block * blockSize; i < end; ++i)
 		{
-			std::sort((*cellsIt).begin(), (*cellsIt).end(), compareZ);
+			uint64_t cell = keys[i] >> 32;
+			uint64_t previous = i == 0 ? 0 : (keys[i - 1] >> 32) + 1;
+			for(uint64_t c = previous; c <= cell && c <= numberOfCells; ++c)
+			{
+				mOffsets[c] = static_cast<uint32_t>(i);
+			}
 		}
-	}	
+	});
+
+	uint64_t last = numberOfKeys == 0 ? 0 : (keys.back() >> 32) + 1;
+	for(uint64_t c = last; c <= numberOfCells; ++c)
+	{
+		mOffsets[c] = static_cast<uint32_t>(numberOfKeys);
+	}
+
+	mIndices.resize(mOffsets[numberOfCells]);
+	numberOfBlocks = blocks(mIndices.size(), thePool);
+	blockSize = (mIndices.size() + numberOfBlocks - 1) / numberOfBlocks;
+	thePool.run(numberOfBlocks, [&](unsigned int block)
+	{
+		std::size_t end = std::min(mIndices.size(), (block + 1) * blockSize);
+		for(std::size_t i = block * blockSize; i < end; ++i)
+		{
+			mIndices[i] = static_cast<uint32_t>(keys[i]);
+		}
+	});
+
+	std::vector<uint64_t>().swap(keys);
+
+	// Cells are ordered by elevation in parallel blocks of cells
+	CompareZ compareZ(thePoints);
+	numberOfBlocks = blocks(mIndices.size(), thePool);
+	const unsigned int cellsPerBlock = (numberOfCells + numberOfBlocks - 1) / numberOfBlocks;
+	thePool.run(numberOfBlocks, [&](unsigned int block)
+	{
+		unsigned int end = std::min(numberOfCells, (block + 1) * cellsPerBlock);
+		for(unsigned int i = block * cellsPerBlock; i < end; ++i)
+		{
+			if(mOffsets[i + 1] - mOffsets[i] > 1)
+			{
+				std::sort(mIndices.begin() + mOffsets[i], mIndices.begin() + mOffsets[i + 1], compareZ);
+			}
+		}
+	});
+}
+
+double GridIndex::estimateDensity(const LidarMetadata& theMetadata, 
+								  const PointCloud& thePoints, 
+								  double theCellSize)
+{
+	DensityEstimator estimator(theMetadata, theCellSize);
+	std::vector<double> xs(PointCloud::COORDS_BLOCK);
+	std::vector<double> ys(PointCloud::COORDS_BLOCK);
+	for(std::size_t first = 0; first < thePoints.size(); first += PointCloud::COORDS_BLOCK)
+	{
+		std::size_t count = std::min(PointCloud::COORDS_BLOCK, thePoints.size() - first);
+		thePoints.realCoords(first, count, &xs[0], &ys[0], 0);
+		for(std::size_t i = 0; i < count; ++i)
+		{
+			estimator.add(xs[i], ys[i]);
+		}
+	}
+	return estimator.density();
+}
+
+void GridIndex::assign(const BoundingRectangle& theExtent, 
+					   double theCellSize, 
+					   unsigned int theRows, 
+					   unsigned int theCols,
+					   const uint32_t* theOffsets, 
+					   const uint32_t* theIndices)
+{
+	clear();
+
+	mExtent = theExtent;
+	mCellSize = theCellSize;
+	mRows = theRows;
+	mCols = theCols;
+
+	mOffsets.assign(theOffsets, theOffsets + mRows * mCols + 1);
+	mIndices.assign(theIndices, theIndices + theOffsets[mRows * mCols]);
+}
+
+void GridIndex::remap(const std::vector<uint32_t>& theOrder)
+{
+	// New position of every point of previous order
+	std::vector<uint32_t> positions(theOrder.size());
+	for(std::size_t i = 0; i < theOrder.size(); ++i)
+	{
+		positions[theOrder[i]] = static_cast<uint32_t>(i);
+	}
+
+	for(std::vector<uint32_t>::iterator it = mIndices.begin(); it != mIndices.end(); ++it)
+	{
+		*it = positions[*it];
+	}
+
+	for(std::vector<uint32_t>::iterator it = mLowest.begin(); it != mLowest.end(); ++it)
+	{
+		if(*it != PointCloud::NO_POINT)
+		{
+			*it = positions[*it];
+		}
+	}
+}
+
+std::size_t GridIndex::box(const PointCloud& thePoints, 
+						   const BoundingRectangle& theBox, 
+						   std::vector<uint32_t>& theResult) const
+{
+	theResult.clear();
+	if(mRows == 0 || mCols == 0)
+	{
+		return 0;
+	}
+
+	const wykobi::vector3d<double>& scales = thePoints.metadata().scales();
+	const wykobi::vector3d<double>& offsets = thePoints.metadata().offsets();
+
+	const unsigned int c0 = clampedCell(theBox[0].x - mExtent[0].x, mCellSize, mCols);
+	const unsigned int c1 = clampedCell(theBox[1].x - mExtent[0].x, mCellSize, mCols);
+	const unsigned int r0 = clampedCell(mExtent[1].y - theBox[1].y, mCellSize, mRows);
+	const unsigned int r1 = clampedCell(mExtent[1].y - theBox[0].y, mCellSize, mRows);
+
+	for(unsigned int r = r0; r <= r1; ++r)
+	{
+		for(unsigned int c = c0; c <= c1; ++c)
+		{
+			Cell cell = operator[](index(r, c));
+
+			// Cells between border cells lie inside of box
+			if(r > r0 && r < r1 && c > c0 && c < c1)
+			{
+				theResult.insert(theResult.end(), cell.begin(), cell.end());
+				continue;
+			}
+
+			for(Cell::const_iterator it = cell.begin(); it != cell.end(); ++it)
+			{
+				double x = thePoints.x(*it) * scales.x + offsets.x;
+				double y = thePoints.y(*it) * scales.y + offsets.y;
+				if(x >= theBox[0].x && x <= theBox[1].x && y >= theBox[0].y && y <= theBox[1].y)
+				{
+					theResult.push_back(*it);
+				}
+			}
+		}
+	}
+
+	return theResult.size();
+}
+
+std::size_t GridIndex::radius(const PointCloud& thePoints, 
+							  const wykobi::point3d<double>& theCenter, 
+							  double theRadius, 
+							  Distance theDistance, 
+							  std::vector<uint32_t>& theResult) const
+{
+	theResult.clear();
+	if(mRows == 0 || mCols == 0 || theRadius < 0)
+	{
+		return 0;
+	}
+
+	const wykobi::vector3d<double>& scales = thePoints.metadata().scales();
+	const wykobi::vector3d<double>& offsets = thePoints.metadata().offsets();
+	const bool spatial = theDistance == SPATIAL;
+	const double squaredRadius = theRadius * theRadius;
+
+	const unsigned int c0 = clampedCell(theCenter.x - theRadius - mExtent[0].x, mCellSize, mCols);
+	const unsigned int c1 = clampedCell(theCenter.x + theRadius - mExtent[0].x, mCellSize, mCols);
+	const unsigned int r0 = clampedCell(mExtent[1].y - theCenter.y - theRadius, mCellSize, mRows);
+	const unsigned int r1 = clampedCell(mExtent[1].y - theCenter.y + theRadius, mCellSize, mRows);
+
+	for(unsigned int r = r0; r <= r1; ++r)
+	{
+		double rowGap = squaredGap(theCenter.y, mExtent[1].y - (r + 1) * mCellSize, mExtent[1].y - r * mCellSize);
+		for(unsigned int c = c0; c <= c1; ++c)
+		{
+			// Corners of bounding square may be out of reach
+			double cellGap = rowGap + squaredGap(theCenter.x, mExtent[0].x + c * mCellSize, mExtent[0].x + (c + 1) * mCellSize);
+			if(cellGap > squaredRadius)
+			{
+				continue;
+			}
+
+			Cell cell = operator[](index(r, c));
+			for(Cell::const_iterator it = cell.begin(); it != cell.end(); ++it)
+			{
+				double dx = thePoints.x(*it) * scales.x + offsets.x - theCenter.x;
+				double dy = thePoints.y(*it) * scales.y + offsets.y - theCenter.y;
+				double squaredDistance = dx * dx + dy * dy;
+				if(spatial)
+				{
+					double dz = thePoints.z(*it) * scales.z + offsets.z - theCenter.z;
+					squaredDistance += dz * dz;
+				}
+				if(squaredDistance <= squaredRadius)
+				{
+					theResult.push_back(*it);
+				}
+			}
+		}
+	}
+
+	return theResult.size();
+}
+
+void GridIndex::box(const PointCloud& thePoints, 
+					const std::vector<BoundingRectangle>& theBoxes, 
+					util::ThreadPool& thePool, 
+					std::vector<uint32_t>& theResult, 
+					std::vector<std::size_t>& theOffsets) const
+{
+	collectBatch(theBoxes.size(), thePool, [&](std::size_t i, std::vector<uint32_t>& found)
+	{
+		box(thePoints, theBoxes[i], found);
+	}, theResult, theOffsets);
+}
+
+void GridIndex::radius(const PointCloud& thePoints, 
+					   const std::vector< wykobi::point3d<double> >& theCenters, 
+					   double theRadius, 
+					   Distance theDistance, 
+					   util::ThreadPool& thePool, 
+					   std::vector<uint32_t>& theResult, 
+					   std::vector<std::size_t>& theOffsets) const
+{
+	collectBatch(theCenters.size(), thePool, [&](std::size_t i, std::vector<uint32_t>& found)
+	{
+		radius(thePoints, theCenters[i], theRadius, theDistance, found);
+	}, theResult, theOffsets);
+}
+
+unsigned int GridIndex::nearest(const PointCloud& thePoints, 
+								const wykobi::point3d<double>& theQuery, 
+								unsigned int theK, 
+								Distance theDistance, 
+								std::vector<uint32_t>& theIndices, 
+								std::vector<double>& theSquaredDistances) const
+{
+	theIndices.resize(theK);
+	theSquaredDistances.resize(theK);
+	unsigned int found = theK == 0 ? 0 : nearest(thePoints, theQuery, theK, theDistance, 
+		&theIndices[0], &theSquaredDistances[0]);
+	theIndices.resize(found);
+	theSquaredDistances.resize(found);
+	return found;
+}
+
+void GridIndex::nearest(const PointCloud& thePoints, 
+						const std::vector< wykobi::point3d<double> >& theQueries, 
+						unsigned int theK, 
+						Distance theDistance, 
+						util::ThreadPool& thePool, 
+						std::vector<uint32_t>& theIndices, 
+						std::vector<double>& theSquaredDistances) const
+{
+	const std::size_t numberOfQueries = theQueries.size();
+	theIndices.resize(numberOfQueries * theK);
+	theSquaredDistances.resize(numberOfQueries * theK);
+	if(numberOfQueries == 0 || theK == 0)
+	{
+		return;
+	}
+
+	// Small blocks are handed out one at a time, so threads stay balanced
+	const std::size_t blockSize = 1024;
+	const unsigned int numberOfBlocks = static_cast<unsigned int>((numberOfQueries + blockSize - 1) / blockSize);
+
+	thePool.run(numberOfBlocks, [&](unsigned int block)
+	{
+		std::size_t end = std::min(numberOfQueries, (block + 1) * blockSize);
+		for(std::size_t i = block * blockSize; i < end; ++i)
+		{
+			uint32_t* indices = &theIndices[i * theK];
+			double* squaredDistances = &theSquaredDistances[i * theK];
+			unsigned int found = nearest(thePoints, theQueries[i], theK, theDistance, indices, squaredDistances);
+			std::fill(indices + found, indices + theK, PointCloud::NO_POINT);
+			std::fill(squaredDistances + found, squaredDistances + theK, std::numeric_limits<double>::infinity());
+		}
+	});
+}
+
+unsigned int GridIndex::nearest(const PointCloud& thePoints, 
+								const wykobi::point3d<double>& theQuery, 
+								unsigned int theK, 
+								Distance theDistance, 
+								uint32_t* theIndices, 
+								double* theSquaredDistances) const
+{
+	if(mRows == 0 || mCols == 0)
+	{
+		return 0;
+	}
+
+	const wykobi::vector3d<double>& scales = thePoints.metadata().scales();
+	const wykobi::vector3d<double>& offsets = thePoints.metadata().offsets();
+	const bool spatial = theDistance == SPATIAL;
+
+	// Cell of query, it may be outside of grid
+	const long c0 = long(std::floor((theQuery.x - mExtent[0].x) / mCellSize));
+	const long r0 = long(std::floor((mExtent[1].y - theQuery.y) / mCellSize));
+
+	// Ring that reaches the farthest cell of grid
+	const long lastRing = std::max(std::max(std::abs(c0), std::abs(long(mCols) - 1 - c0)),
+								   std::max(std::abs(r0), std::abs(long(mRows) - 1 - r0)));
+
+	// Neighbours are kept ordered by distance, k is expected to be small
+	unsigned int found = 0;
+
+	for(long ring = 0; ring <= lastRing; ++ring)
+	{
+		for(long r = r0 - ring; r <= r0 + ring; ++r)
+		{
+			if(r < 0 || r >= long(mRows))
+			{
+				continue;
+			}
+
+			// Inner rows of ring have only two cells
+			const bool edgeRow = r == r0 - ring || r == r0 + ring;
+			const long step = edgeRow || ring == 0 ? 1 : 2 * ring;
+			const double rowGap = squaredGap(theQuery.y, mExtent[1].y - (r + 1) * mCellSize, mExtent[1].y - r * mCellSize);
+
+			for(long c = c0 - ring; c <= c0 + ring; c += step)
+			{
+				if(c < 0 || c >= long(mCols))
+				{
+					continue;
+				}
+
+				double cellGap = rowGap + squaredGap(theQuery.x, mExtent[0].x + c * mCellSize, mExtent[0].x + (c + 1) * mCellSize);
+				if(found == theK && cellGap >= theSquaredDistances[theK - 1])
+				{
+					continue;
+				}
+
+				Cell cell = operator[](index(unsigned int(r), unsigned int(c)));
+				for(Cell::const_iterator it = cell.begin(); it != cell.end(); ++it)
+				{
+					double dx = thePoints.x(*it) * scales.x + offsets.x - theQuery.x;
+					double dy = thePoints.y(*it) * scales.y + offsets.y - theQuery.y;
+					double squaredDistance = dx * dx + dy * dy;
+					if(spatial)
+					{
+						double dz = thePoints.z(*it) * scales.z + offsets.z - theQuery.z;
+						squaredDistance += dz * dz;
+					}
+
+					if(found == theK)
+					{
+						if(squaredDistance >= theSquaredDistances[theK - 1])
+						{
+							continue;
+						}
+					}
+					else
+					{
+						++found;
+					}
+
+					// Insert into ordered neighbours, the farthest one drops out
+					unsigned int j = found - 1;
+					for( ; j > 0 && theSquaredDistances[j - 1] > squaredDistance; --j)
+					{
+						theSquaredDistances[j] = theSquaredDistances[j - 1];
+						theIndices[j] = theIndices[j - 1];
+					}
+					theSquaredDistances[j] = squaredDistance;
+					theIndices[j] = *it;
+				}
+			}
+		}
+
+		// Points outside of searched square are at least as far as its border
+		if(found == theK)
+		{
+			double gap = std::min(
+				std::min(theQuery.x - (mExtent[0].x + (c0 - ring) * mCellSize),
+						 mExtent[0].x + (c0 + ring + 1) * mCellSize - theQuery.x),
+				std::min(mExtent[1].y - (r0 - ring) * mCellSize - theQuery.y,
+						 theQuery.y - (mExtent[1].y - (r0 + ring + 1) * mCellSize)));
+			if(gap * gap >= theSquaredDistances[theK - 1])
+			{
+				break;
+			}
+		}
+	}
 
+	return found;
 }
 
 void GridIndex::elevationToRaster(const std::string& filename) const
@@ -11,10 +11,13 @@
 // Included dependacies
 #include <iostream>
 #include <algorithm>
+#include <cmath>
 #include <cstdlib>
 #include "wykobi.hpp"
 #include "groundclassifier1.hpp"
 #include "gridindex.hpp"
+#include "dequantize.hpp"
+#include "threadpool.hpp"
 
 using terrace::lidar::GridIndex;
 
@@ -28,13 +31,17 @@ namespace classification
 GroundClassifier::GroundClassifier(LidarDataset& lidarDs, 
 								   double angleTreshold,
 								   double distanceTreshold, 
-								   double edgeLengthTreshold) : 
+								   double edgeLengthTreshold,
+								   unsigned int threads,
+								   const std::string& groundPath) : 
 mLidarDs(lidarDs), 
 mTIN(0),
 mPyramid(lidarDs), 
 mAngleTreshold(angleTreshold * wykobi::PI / 180), // Convert to radians 
 mDistanceTreshold(distanceTreshold),
-mEdgeLengthTreshold(edgeLengthTreshold * edgeLengthTreshold) // Square edge length threshold. It will save few sqrt operations.
+mEdgeLengthTreshold(edgeLengthTreshold * edgeLengthTreshold), // Square edge length threshold. It will save few sqrt operations.
+mThreads(threads),
+mGroundPath(groundPath)
 {
 	mEdgeDistance = 10 * lidarDs.gridIndex().cellSize();
 }
@@ -44,17 +51,17 @@ unsigned int GroundClassifier::classify()
 	unsigned int iteration = 0;
 	unsigned int index = 1;
 
-	std::cout << "Performing ground classifiaction.\n";
+	mLidarDs.log() << "Performing ground classifiaction.\n";
 
 	// Discard previous classification
-	for(std::vector<LidarPoint>::iterator pointsIt = mLidarDs.points().begin();
+	for(LidarPoint::VectorIterator pointsIt = mLidarDs.points().begin();
 		pointsIt != mLidarDs.points().end();
 		++pointsIt)
 	{
 		(*pointsIt).setClassification(1);
 	}
 
-	std::cout << "Taking points from pyramid level " <<  mPyramid.levels.size() 
+	mLidarDs.log() << "Taking points from pyramid level " <<  mPyramid.levels.size() 
 			  << " as initial ground points.\n";
 
 	findInitialGroundPoints();
@@ -66,43 +73,87 @@ unsigned int GroundClassifier::classify()
 	// Last level (lowest resolution) is already processed go to previous
 	++levelsIt;
 
+	if(mClassifiedPoints.size() < 3)
+	{
+		// Triangle exits if it gets less than three vertices, which
+		// happens for small tiles
+		std::cerr << "Info: Too few initial ground points to create TIN." << std::endl;
+		levelsIt = mPyramid.levels.rend();
+	}
+
+	// Points accepted at previous level, they are not yet in TIN
+	std::size_t firstNewPoint = 0;
+
+	util::ThreadPool pool(mThreads);
+	const PointCloud& cloud = mLidarDs.points();
+
 	for( ; levelsIt != mPyramid.levels.rend(); ++levelsIt)
 	{
 		mPyramid.currentLevel = *levelsIt;
-		std::cout << "Densifying TIN. Taking points from pyramid level " 
+		mLidarDs.log() << "Densifying TIN. Taking points from pyramid level " 
 				  << mPyramid.currentLevel->number << std::endl;
 
-		createTIN(); 
+		if(mTIN == 0)
+		{
+			createTIN();
+		}
+		else
+		{
+			densifyTIN(firstNewPoint);
+		}
+
+		firstNewPoint = mClassifiedPoints.size();
+
+		// TIN is not changed during level, so bands of rows are checked 
+		// in parallel. Every band walks TIN from its own hint, and 
+		// accepted points are merged in the order of cells.
+		const Pyramid::Level& level = **levelsIt;
+		const unsigned int bands = (level.rows + BAND_ROWS - 1) / BAND_ROWS;
+		const TOrientedTriangle start = mTIN->hint();
+		std::vector< std::vector<uint32_t> > accepted(bands);
 
-		std::vector<LidarPoint::VectorIterator>::iterator cellsIt;
-		for(cellsIt = (*levelsIt)->cells.begin(); cellsIt != (*levelsIt)->cells.end(); ++cellsIt)
+		pool.run(bands, [&](unsigned int band)
 		{
-			if((*cellsIt) != mPyramid.empty)
-			{
-				wykobi::point3d<double> point = (*(*cellsIt)).realCoords();
+			TOrientedTriangle hint = start;
+			std::vector<TrianglePlane> cache(PLANE_CACHE_SIZE);
+			const std::size_t first = std::size_t(band) * BAND_ROWS * level.columns;
+			const std::size_t last = std::min<std::size_t>(level.cells.size(), first + BAND_ROWS * level.columns);
 
-				if(checkPoint(point))
+			for(std::size_t i = first; i < last; ++i)
+			{
+				if(level.cells[i] != PointCloud::NO_POINT)
 				{
-					mClassifiedPoints.push_back(*cellsIt);
+					wykobi::point3d<double> point = cloud.realCoords(level.cells[i]);
+
+					if(checkPoint(point, hint, cache))
+					{
+						accepted[band].push_back(level.cells[i]);
+					}
 				}
 			}
+		});
+
+		for(unsigned int band = 0; band < bands; ++band)
+		{
+			mClassifiedPoints.insert(mClassifiedPoints.end(), accepted[band].begin(), accepted[band].end());
 		}
 	}
 
-	std::cout << "Classified " << mClassifiedPoints.size() << " ground points.\n";
+	mLidarDs.log() << "Classified " << mClassifiedPoints.size() << " ground points.\n";
 
 	applyClassification();
 
-	std::cout << "Finished ground classification.\n";
+	mLidarDs.log() << "Finished ground classification.\n";
 
 	return mClassifiedPoints.size();
 }
 
 GroundClassifier::Pyramid::Pyramid(LidarDataset& lidarDs)
 {
-	std::cout << "Creating pyramid levels.\n";
+	lidarDs.log() << "Creating pyramid levels.\n";
 
-	empty = const_cast<std::vector<LidarPoint>&>(lidarDs.points()).end();
+	const uint32_t empty = PointCloud::NO_POINT;
+	CompareZ compareZ(lidarDs.points());
 
 	// Level 0
 	Pyramid::Level* firstLevel = new Pyramid::Level;
@@ -117,21 +168,13 @@ GroundClassifier::Pyramid::Pyramid(LidarDataset& lidarDs)
 		for(unsigned int j = 0; j < firstLevel->columns; ++j)
 		{
 			unsigned int gridCellIndex = lidarDs.gridIndex().index(i ,j);
-			GridIndex::Cell gridCell = lidarDs.gridIndex()[gridCellIndex];
-			if(!gridCell.empty())
-			{
-				firstLevel->cells.push_back(gridCell.front());
-			}
-			else
-			{
-				firstLevel->cells.push_back(empty);
-			}
+			firstLevel->cells.push_back(lidarDs.gridIndex().lowest(gridCellIndex));
 		}
 	}
 
 	levels.push_back(firstLevel);
 
-	std::cout << "Created level 1.\n";
+	lidarDs.log() << "Created level 1.\n";
 
 	do
 	{
@@ -150,7 +193,7 @@ GroundClassifier::Pyramid::Pyramid(LidarDataset& lidarDs)
 			for(j = 0; j < previousLevel->columns; j += 2)
 			{
 				// 4(or 2 on border; or 1 in corner) previous level cells are inspected
-				std::vector<LidarPoint::VectorIterator> cell;
+				std::vector<uint32_t> cell;
 				cell.push_back(previousLevel->cells[i * previousLevel->columns + j]);
 				if(j + 1 < previousLevel->columns)
 				{
@@ -178,24 +221,24 @@ GroundClassifier::Pyramid::Pyramid(LidarDataset& lidarDs)
 				}
 				
 				// Find the point with lowest elevation among them
-				LidarPoint::VectorIterator lowestPointIt = empty;
+				uint32_t lowestPoint = empty;
 				unsigned int minp = 0;
 				unsigned int maxq = 0;
 				for(unsigned int p = 0; p < 2; ++p)
 				{
 					for(unsigned int q = 0; q < 2; ++q)
 					{
-						if(lowestPointIt == empty)
+						if(lowestPoint == empty)
 						{
-							lowestPointIt = cell[p * 2 + q];
+							lowestPoint = cell[p * 2 + q];
 						}
 						else
 						{
 							if(cell[p * 2 + q] != empty)
 							{
-								if((*cell[p * 2 + q]).realCoords().z < (*lowestPointIt).realCoords().z)
+								if(compareZ(cell[p * 2 + q], lowestPoint))
 								{
-									lowestPointIt = cell[p * 2 + q];
+									lowestPoint = cell[p * 2 + q];
 									minp = p;
 									maxq = q;
 								}
@@ -205,7 +248,7 @@ GroundClassifier::Pyramid::Pyramid(LidarDataset& lidarDs)
 				}
 
 				// Promote cell to this level
-				currentLevel->cells.push_back(lowestPointIt);
+				currentLevel->cells.push_back(lowestPoint);
 
 				// Assign empty value to cell in previous level
 				previousLevel->cells[(i + minp) * previousLevel->columns + (j + maxq)] = empty;
@@ -219,14 +262,14 @@ GroundClassifier::Pyramid::Pyramid(LidarDataset& lidarDs)
 
 		levels.push_back(currentLevel);
 
-		std::cout << "Created level " << currentLevel->number << ".\n";
+		lidarDs.log() << "Created level " << currentLevel->number << ".\n";
 
 	}
 	while(levels.back()->rows * levels.back()->columns > 100);
 
 	currentLevel = levels.back();
 
-	std::cout << "\n\n";
+	lidarDs.log() << "\n\n";
 }
 
 GroundClassifier::Pyramid::~Pyramid()
@@ -241,11 +284,11 @@ GroundClassifier::Pyramid::~Pyramid()
 
 unsigned int GroundClassifier::findInitialGroundPoints()
 {
-	for(std::vector<LidarPoint::VectorIterator>::iterator cellsIt = mPyramid.levels.back()->cells.begin(); 
+	for(std::vector<uint32_t>::iterator cellsIt = mPyramid.levels.back()->cells.begin(); 
 		cellsIt != mPyramid.levels.back()->cells.end(); 
 		++cellsIt)
 	{
-		if((*cellsIt) != mPyramid.empty)
+		if((*cellsIt) != PointCloud::NO_POINT)
 		{
 			mClassifiedPoints.push_back(*cellsIt);
 		}
@@ -256,14 +299,36 @@ unsigned int GroundClassifier::findInitialGroundPoints()
 
 void GroundClassifier::createTIN()
 {
-	std::vector<wykobi::point3d<double>> points;
+	const PointCloud& cloud = mLidarDs.points();
+	const std::size_t numberOfPoints = mClassifiedPoints.size();
 
-	std::vector<LidarPoint::VectorIterator>::iterator classPointsIt;
-	for(classPointsIt = mClassifiedPoints.begin(); 
-		classPointsIt != mClassifiedPoints.end();
-		++classPointsIt)
+	// Quantized coordinates are gathered into columns and converted at once
+	std::vector<int32_t> quantized(3 * numberOfPoints);
+	for(std::size_t i = 0; i < numberOfPoints; ++i)
 	{
-		points.push_back((*(*classPointsIt)).realCoords());
+		uint32_t index = mClassifiedPoints[i];
+		quantized[i] = cloud.x(index);
+		quantized[numberOfPoints + i] = cloud.y(index);
+		quantized[2 * numberOfPoints + i] = cloud.z(index);
+	}
+
+	std::vector<double> real(3 * numberOfPoints);
+	if(numberOfPoints > 0)
+	{
+		const LidarMetadata& metadata = cloud.metadata();
+		util::dequantize(&quantized[0], numberOfPoints, 
+			metadata.scales().x, metadata.offsets().x, &real[0]);
+		util::dequantize(&quantized[numberOfPoints], numberOfPoints, 
+			metadata.scales().y, metadata.offsets().y, &real[numberOfPoints]);
+		util::dequantize(&quantized[2 * numberOfPoints], numberOfPoints, 
+			metadata.scales().z, metadata.offsets().z, &real[2 * numberOfPoints]);
+	}
+
+	std::vector<wykobi::point3d<double>> points;
+	points.reserve(numberOfPoints);
+	for(std::size_t i = 0; i < numberOfPoints; ++i)
+	{
+		points.push_back(wykobi::make_point(real[i], real[numberOfPoints + i], real[2 * numberOfPoints + i]));
 	}
 
 	delete mTIN;
@@ -271,78 +336,91 @@ void GroundClassifier::createTIN()
 	mTIN->create(points);
 }
 
-double vectorToPlaneAngle(const wykobi::vector3d<double>& v, const wykobi::plane<double, 3>& p)
+void GroundClassifier::densifyTIN(std::size_t theFirstPoint)
 {
-	double nom = p.normal.x * v.x + p.normal.y * v.y + p.normal.z * v.z;
-	double denom1 = p.normal.x * p.normal.x + p.normal.y * p.normal.y + p.normal.z * p.normal.z;
-	double denom2 = v.x * v.x + v.y * v.y + v.z * v.z;
-	return std::asin(nom / std::sqrt(denom1 * denom2)); 
-}
+	const PointCloud& cloud = mLidarDs.points();
 
-double distanceToPlane(const wykobi::point3d<double>& point, const wykobi::plane<double, 3>& plane)
-{
-	double d = (plane.normal.x * point.x + plane.normal.y * point.y + plane.normal.z * point.z + plane.constant) 
-		/ std::sqrt(plane.normal.x * plane.normal.x + plane.normal.y * plane.normal.y + plane.normal.z * plane.normal.z);
-	return d;
+	// Point at the same position as existing vertex is not inserted, 
+	// creating TIN would drop it as well
+	for(std::size_t i = theFirstPoint; i < mClassifiedPoints.size(); ++i)
+	{
+		wykobi::point3d<double> point = cloud.realCoords(mClassifiedPoints[i]);
+		mTIN->insertVertex(point.x, point.y, point.z);
+	}
 }
 
-bool GroundClassifier::checkAngle(const wykobi::point3d<double>& point, const wykobi::triangle3d& triangle) const
+const GroundClassifier::TrianglePlane& GroundClassifier::trianglePlane(const wykobi::triangle3d& triangle, 
+																	   const TOrientedTriangle& hint, 
+																	   std::vector<TrianglePlane>& theCache) const
 {
-	bool result = false; 
+	// Triangles are records of memory pool, so consecutive records
+	// fall into different slots
+	const std::size_t address = reinterpret_cast<std::size_t>(hint.tri) / sizeof(TTriangle);
+	TrianglePlane& plane = theCache[(3 * address + hint.orient) % PLANE_CACHE_SIZE];
 
-	wykobi::vector3d<double> vect = point - triangle[0];
-	wykobi::plane<double, 3> triPlane = wykobi::make_plane(triangle);
-	
-	double reducedAngle = reduceAngle(triangle);
+	if(plane.key != hint.tri || plane.orient != hint.orient)
+	{
+		// Plane is computed from vertices in the order they were found in
+		wykobi::plane<double, 3> triPlane = wykobi::make_plane(triangle);
+		double length = std::sqrt(triPlane.normal.x * triPlane.normal.x 
+			+ triPlane.normal.y * triPlane.normal.y 
+			+ triPlane.normal.z * triPlane.normal.z);
+
+		plane.key = hint.tri;
+		plane.orient = hint.orient;
+		plane.normal = triPlane.normal * (1 / length);
+		plane.constant = triPlane.constant / length;
+
+		// Angle to plane is below threshold if sine of it is, and sine 
+		// is compared squared to avoid square root of vector length
+		double sine = std::sin(std::min(reduceAngle(triangle), wykobi::PI / 2));
+		plane.squaredSine = sine * sine;
+	}
 
-	if(vectorToPlaneAngle(vect, triPlane) < reducedAngle)
+	return plane;
+}
+
+bool GroundClassifier::checkAngle(const wykobi::point3d<double>& point, const wykobi::triangle3d& triangle,
+								  const TrianglePlane& plane) const
+{
+	for(unsigned int i = 0; i < 3; ++i)
 	{
-		vect = point - triangle[1];
-		if(vectorToPlaneAngle(vect, triPlane) < reducedAngle)
+		wykobi::vector3d<double> vect = point - triangle[i];
+		double nom = plane.normal.x * vect.x + plane.normal.y * vect.y + plane.normal.z * vect.z;
+		double squaredLength = vect.x * vect.x + vect.y * vect.y + vect.z * vect.z;
+
+		// Vectors below plane are always within angle
+		if(!(nom < 0 || nom * nom < plane.squaredSine * squaredLength))
 		{
-			vect = point - triangle[2];
-			if(vectorToPlaneAngle(vect, triPlane) < reducedAngle)
-			{
-				result = true;
-			}
+			return false;
 		}
 	}
 
-	return result;
-	
+	return true;
 }
 
-bool GroundClassifier::checkMirrorAngle(const wykobi::point3d<double>& point, const wykobi::triangle3d& triangle) const
+bool GroundClassifier::checkMirrorAngle(const wykobi::point3d<double>& point, const wykobi::triangle3d& triangle,
+										const TrianglePlane& plane) const
 {
-	bool result = false; 
-
-	wykobi::vector3d<double> vect = point - triangle[0];
-	wykobi::plane<double, 3> triPlane = wykobi::make_plane(triangle);
-	
-	double reducedAngle = reduceAngle(triangle);
-
-	if(std::abs(vectorToPlaneAngle(vect, triPlane)) < reducedAngle)
+	for(unsigned int i = 0; i < 3; ++i)
 	{
-		vect = point - triangle[1];
-		if(std::abs(vectorToPlaneAngle(vect, triPlane)) < reducedAngle)
+		wykobi::vector3d<double> vect = point - triangle[i];
+		double nom = plane.normal.x * vect.x + plane.normal.y * vect.y + plane.normal.z * vect.z;
+		double squaredLength = vect.x * vect.x + vect.y * vect.y + vect.z * vect.z;
+
+		if(!(nom * nom < plane.squaredSine * squaredLength))
 		{
-			vect = point - triangle[2];
-			if(std::abs(vectorToPlaneAngle(vect, triPlane)) < reducedAngle)
-			{
-				result = true;
-			}
+			return false;
 		}
 	}
 
-	return result;
-	
+	return true;
 }
 
-
-bool GroundClassifier::checkDistance(const wykobi::point3d<double>& point, const wykobi::triangle3d& triangle) const
+bool GroundClassifier::checkDistance(const wykobi::point3d<double>& point, const TrianglePlane& plane) const
 {
-	wykobi::plane<double, 3> triPlane = wykobi::make_plane(triangle);
-	return distanceToPlane(point, triPlane) < mDistanceTreshold;
+	return plane.normal.x * point.x + plane.normal.y * point.y + plane.normal.z * point.z + plane.constant 
+		< mDistanceTreshold;
 }
 
 double  GroundClassifier::reduceAngle(const wykobi::triangle3d& triangle) const
@@ -395,7 +473,7 @@ double  GroundClassifier::reduceAngle(const wykobi::triangle3d& triangle) const
 }
 
 wykobi::point3d<double>* GroundClassifier::findMirrorPoint(const wykobi::point3d<double>& point, 
-														   const wykobi::triangle<double, 3>& triangle)
+														   const wykobi::triangle<double, 3>& triangle) const
 {
 	wykobi::vector3d<double> mirrorAxis;
 
@@ -431,23 +509,37 @@ wykobi::point3d<double>* GroundClassifier::findMirrorPoint(const wykobi::point3d
 	return mirror;
 }
 
-bool GroundClassifier::checkPoint(const wykobi::point3d<double>& point)
+bool GroundClassifier::checkPoint(const wykobi::point3d<double>& point, TOrientedTriangle& hint,
+								  std::vector<TrianglePlane>& cache) const
 {
 	bool result = false;
 
 	wykobi::triangle<double, 3> triangle;
 
-	mTIN->findTriangle(point.x, point.y, triangle);
+	bool found = mTIN->findTriangle(point.x, point.y, triangle, hint);
+	if(!found)
+	{
+		if(hint.tri == NULL)
+		{
+			// TIN has no triangles
+			return result;
+		}
+
+		// Hint is left at the hull triangle where search left TIN
+		mTIN->triangleVertices(hint, triangle);
+	}
 
 	// Have to check this because Triangle in some cases returns wrong triangle 
-	bool realyInTriangle = wykobi::point_in_triangle(point.x, point.y,
+	bool realyInTriangle = found && wykobi::point_in_triangle(point.x, point.y,
 													 triangle[0].x, triangle[0].y,
 													 triangle[1].x, triangle[1].y,
 													 triangle[2].x, triangle[2].y);
 	
 	if(realyInTriangle)
 	{
-		if(checkAngle(point, triangle) && checkDistance(point, triangle))
+		// Plane is taken from cache only for the triangle hint points to
+		const TrianglePlane& plane = trianglePlane(triangle, hint, cache);
+		if(checkAngle(point, triangle, plane) && checkDistance(point, plane))
 		{
 			result = true;
 		}
@@ -459,16 +551,17 @@ bool GroundClassifier::checkPoint(const wykobi::point3d<double>& point)
 		
 		if(mirrorPoint != 0)
 		{
-			mTIN->findTriangle(mirrorPoint->x, mirrorPoint->y, triangle);
+			found = mTIN->findTriangle(mirrorPoint->x, mirrorPoint->y, triangle, hint);
 
 			// Have to check this because Triangle in some cases returns wrong triangle
-			bool realyInTriangle = wykobi::point_in_triangle(mirrorPoint->x, mirrorPoint->y,
+			bool realyInTriangle = found && wykobi::point_in_triangle(mirrorPoint->x, mirrorPoint->y,
 													 triangle[0].x, triangle[0].y,
 													 triangle[1].x, triangle[1].y,
 													 triangle[2].x, triangle[2].y);
 			if(realyInTriangle)
 			{
-				if(checkMirrorAngle(*mirrorPoint, triangle) && checkDistance(*mirrorPoint, triangle))
+				const TrianglePlane& plane = trianglePlane(triangle, hint, cache);
+				if(checkMirrorAngle(*mirrorPoint, triangle, plane) && checkDistance(*mirrorPoint, plane))
 				{
 					result = true;
 				}
@@ -484,16 +577,33 @@ bool GroundClassifier::checkPoint(const wykobi::point3d<double>& point)
 
 void GroundClassifier::applyClassification()
 {
+	PointCloud& points = mLidarDs.points();
+	std::vector<uint32_t>::iterator classPointsIt;
+	for(classPointsIt = mClassifiedPoints.begin(); classPointsIt != mClassifiedPoints.end(); ++classPointsIt)
+	{
+		points.setClassification(*classPointsIt, 2);
+	}
+
+	if(mGroundPath.empty())
+	{
+		return;
+	}
+
 	std::fstream out;
-	out.open("C:\\Temp\\terrace_gnd.xyz", std::fstream::out);
+	out.open(mGroundPath.c_str(), std::fstream::out);
+	if(!out)
+	{
+		std::cerr << "Error: Cannot create file " << mGroundPath << std::endl;
+		return;
+	}
+
 	out << std::setprecision(10);
-	std::vector<LidarPoint::VectorIterator>::iterator classPointsIt;
 	for(classPointsIt = mClassifiedPoints.begin(); classPointsIt != mClassifiedPoints.end(); ++classPointsIt)
 	{
-		out << (*(*classPointsIt)).realCoords().x << "\t" 
-			<< (*(*classPointsIt)).realCoords().y << "\t"
-			<< (*(*classPointsIt)).realCoords().z << "\n";
-		(*(*classPointsIt)).setClassification(2);
+		wykobi::point3d<double> point = points.realCoords(*classPointsIt);
+		out << point.x << "\t" 
+			<< point.y << "\t"
+			<< point.z << "\n";
 	}
 	out.close();
 }
@@ -0,0 +1,210 @@
+/******************************************************************************
+ * lasformat.cpp
+ *
+ *
+ ******************************************************************************
+ * Copyright (c) 2014, Vladimir Pajic
+ *
+ *****************************************************************************/
+
+///////////////////////////////////////////////////////////////////////////////
+// Included dependacies
+
+#include "lasformat.hpp"
+
+#include <algorithm>
+#include <ctime>
+
+namespace terrace
+{
+namespace lidar
+{
+namespace las
+{
+
+Header::Header()
+{
+	std::memset(this, 0, sizeof(Header));
+
+	std::memcpy(signature, "LASF", 4);
+	versionMajor = 1;
+	versionMinor = 2;
+	std::strncpy(systemIdentifier, SYSTEM_IDENTIFIER, sizeof(systemIdentifier));
+	std::strncpy(generatingSoftware, GENERATING_SOFTWARE, sizeof(generatingSoftware));
+	headerSize = HEADER_SIZE;
+	pointDataOffset = HEADER_SIZE;
+	scale[0] = scale[1] = scale[2] = 0.01;
+
+	std::time_t now = std::time(0);
+	std::tm* date = std::gmtime(&now);
+	if(date != 0)
+	{
+		creationDay = static_cast<uint16_t>(date->tm_yday + 1);
+		creationYear = static_cast<uint16_t>(date->tm_year + 1900);
+	}
+}
+
+void encodeHeader(const Header& theHeader, char* theBytes)
+{
+	std::memset(theBytes, 0, HEADER_SIZE);
+
+	std::memcpy(theBytes, theHeader.signature, 4);
+	writeLE<uint16_t>(theBytes + 4, theHeader.fileSourceId);
+	writeLE<uint16_t>(theBytes + 6, theHeader.globalEncoding);
+	std::memcpy(theBytes + 8, theHeader.projectGuid, 16);
+	theBytes[24] = static_cast<char>(theHeader.versionMajor);
+	theBytes[25] = static_cast<char>(theHeader.versionMinor);
+	std::memcpy(theBytes + 26, theHeader.systemIdentifier, 32);
+	std::memcpy(theBytes + 58, theHeader.generatingSoftware, 32);
+	writeLE<uint16_t>(theBytes + 90, theHeader.creationDay);
+	writeLE<uint16_t>(theBytes + 92, theHeader.creationYear);
+	writeLE<uint16_t>(theBytes + 94, theHeader.headerSize);
+	writeLE<uint32_t>(theBytes + 96, theHeader.pointDataOffset);
+	writeLE<uint32_t>(theBytes + 100, theHeader.numberOfVlrs);
+	theBytes[104] = static_cast<char>(theHeader.pointDataFormat);
+	writeLE<uint16_t>(theBytes + 105, theHeader.pointDataRecordLength);
+	writeLE<uint32_t>(theBytes + 107, theHeader.numberOfPoints);
+	for(unsigned int i = 0; i < 5; ++i)
+	{
+		writeLE<uint32_t>(theBytes + 111 + 4 * i, theHeader.numberOfPointsByReturn[i]);
+	}
+	for(unsigned int i = 0; i < 3; ++i)
+	{
+		writeLE<double>(theBytes + 131 + 8 * i, theHeader.scale[i]);
+		writeLE<double>(theBytes + 155 + 8 * i, theHeader.offset[i]);
+		writeLE<double>(theBytes + 179 + 16 * i, theHeader.max[i]);
+		writeLE<double>(theBytes + 187 + 16 * i, theHeader.min[i]);
+	}
+}
+
+bool decodeHeader(const char* theBytes, std::size_t theSize, Header& theHeader)
+{
+	if(theSize < HEADER_SIZE || std::memcmp(theBytes, "LASF", 4) != 0)
+	{
+		return false;
+	}
+
+	std::memcpy(theHeader.signature, theBytes, 4);
+	theHeader.fileSourceId = readLE<uint16_t>(theBytes + 4);
+	theHeader.globalEncoding = readLE<uint16_t>(theBytes + 6);
+	std::memcpy(theHeader.projectGuid, theBytes + 8, 16);
+	theHeader.versionMajor = static_cast<unsigned char>(theBytes[24]);
+	theHeader.versionMinor = static_cast<unsigned char>(theBytes[25]);
+	std::memcpy(theHeader.systemIdentifier, theBytes + 26, 32);
+	std::memcpy(theHeader.generatingSoftware, theBytes + 58, 32);
+	theHeader.creationDay = readLE<uint16_t>(theBytes + 90);
+	theHeader.creationYear = readLE<uint16_t>(theBytes + 92);
+	theHeader.headerSize = readLE<uint16_t>(theBytes + 94);
+	theHeader.pointDataOffset = readLE<uint32_t>(theBytes + 96);
+	theHeader.numberOfVlrs = readLE<uint32_t>(theBytes + 100);
+	theHeader.pointDataFormat = static_cast<unsigned char>(theBytes[104]);
+	theHeader.pointDataRecordLength = readLE<uint16_t>(theBytes + 105);
+	theHeader.numberOfPoints = readLE<uint32_t>(theBytes + 107);
+	for(unsigned int i = 0; i < 5; ++i)
+	{
+		theHeader.numberOfPointsByReturn[i] = readLE<uint32_t>(theBytes + 111 + 4 * i);
+	}
+	for(unsigned int i = 0; i < 3; ++i)
+	{
+		theHeader.scale[i] = readLE<double>(theBytes + 131 + 8 * i);
+		theHeader.offset[i] = readLE<double>(theBytes + 155 + 8 * i);
+		// Max and min are interleaved: max x, min x, max y, min y ...
+		theHeader.max[i] = readLE<double>(theBytes + 179 + 16 * i);
+		theHeader.min[i] = readLE<double>(theBytes + 187 + 16 * i);
+	}
+
+	return theHeader.headerSize >= HEADER_SIZE
+		&& theHeader.pointDataOffset >= theHeader.headerSize;
+}
+
+VariableLengthRecord::VariableLengthRecord() : recordId(0), data()
+{
+	std::memset(userId, 0, sizeof(userId));
+	std::memset(description, 0, sizeof(description));
+}
+
+VariableLengthRecord::VariableLengthRecord(const char* theUserId, uint16_t theRecordId, const char* theDescription) :
+	recordId(theRecordId),
+	data()
+{
+	std::memset(userId, 0, sizeof(userId));
+	std::memset(description, 0, sizeof(description));
+	std::strncpy(userId, theUserId, sizeof(userId));
+	std::strncpy(description, theDescription, sizeof(description));
+}
+
+bool VariableLengthRecord::is(const char* theUserId, uint16_t theRecordId) const
+{
+	return recordId == theRecordId && std::strncmp(userId, theUserId, sizeof(userId)) == 0;
+}
+
+void copyRecordFields(const char* theSource, const RecordLayout& theSourceLayout,
+					  char* theDestination, const RecordLayout& theDestinationLayout)
+{
+	std::memcpy(theDestination + RECORD_INTENSITY, theSource + RECORD_INTENSITY, RECORD_EXTRA - RECORD_INTENSITY);
+	if(theSourceLayout.gpsTime >= 0 && theDestinationLayout.gpsTime >= 0)
+	{
+		std::memcpy(theDestination + theDestinationLayout.gpsTime, theSource + theSourceLayout.gpsTime, 8);
+	}
+	if(theSourceLayout.rgb >= 0 && theDestinationLayout.rgb >= 0)
+	{
+		std::memcpy(theDestination + theDestinationLayout.rgb, theSource + theSourceLayout.rgb, 6);
+	}
+}
+
+void encodeVlr(const VariableLengthRecord& theVlr, std::vector<char>& theBytes)
+{
+	std::size_t length = std::min(theVlr.data.size(), MAX_VLR_DATA);
+	std::size_t start = theBytes.size();
+	theBytes.resize(start + VLR_HEADER_SIZE + length, 0);
+
+	char* bytes = &theBytes[start];
+	writeLE<uint16_t>(bytes, 0);
+	std::memcpy(bytes + 2, theVlr.userId, 16);
+	writeLE<uint16_t>(bytes + 18, theVlr.recordId);
+	writeLE<uint16_t>(bytes + 20, static_cast<uint16_t>(length));
+	std::memcpy(bytes + 22, theVlr.description, 32);
+	if(length > 0)
+	{
+		std::memcpy(bytes + VLR_HEADER_SIZE, &theVlr.data[0], length);
+	}
+}
+
+bool decodeVlrs(const char* theBytes, std::size_t theSize, const Header& theHeader, 
+				std::vector<VariableLengthRecord>& theVlrs)
+{
+	theVlrs.clear();
+
+	std::size_t end = std::min<std::size_t>(theSize, theHeader.pointDataOffset);
+	std::size_t position = theHeader.headerSize;
+
+	for(uint32_t i = 0; i < theHeader.numberOfVlrs; ++i)
+	{
+		if(position + VLR_HEADER_SIZE > end)
+		{
+			return false;
+		}
+
+		const char* bytes = theBytes + position;
+		std::size_t length = readLE<uint16_t>(bytes + 20);
+		if(position + VLR_HEADER_SIZE + length > end)
+		{
+			return false;
+		}
+
+		VariableLengthRecord vlr;
+		std::memcpy(vlr.userId, bytes + 2, 16);
+		vlr.recordId = readLE<uint16_t>(bytes + 18);
+		std::memcpy(vlr.description, bytes + 22, 32);
+		vlr.data.assign(bytes + VLR_HEADER_SIZE, bytes + VLR_HEADER_SIZE + length);
+		theVlrs.push_back(vlr);
+
+		position += VLR_HEADER_SIZE + length;
+	}
+
+	return true;
+}
+
+}
+}
+} // namespace terrace::lidar::las
@@ -0,0 +1,257 @@
+/******************************************************************************
+ * laspipeline.cpp
+ *
+ *
+ ******************************************************************************
+ * Copyright (c) 2014, Vladimir Pajic
+ *
+ *****************************************************************************/
+
+///////////////////////////////////////////////////////////////////////////////
+// Included dependacies
+
+#include "laspipeline.hpp"
+#include "boundedqueue.hpp"
+#include "threadpool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+namespace terrace
+{
+namespace lidar
+{
+
+const unsigned long LasPipeline::BLOCK_SIZE;
+
+namespace
+{
+
+/// Block index that marks the end of stream
+const int END_OF_STREAM = -1;
+
+/// Raw records of a block waiting to be decoded
+struct RawBlock
+{
+	int block;
+	int buffer;
+};
+
+bool seekTo(std::FILE* theFile, uint64_t theOffset)
+{
+#ifdef _WIN32
+	return _fseeki64(theFile, static_cast<__int64>(theOffset), SEEK_SET) == 0;
+#else
+	return fseeko(theFile, static_cast<off_t>(theOffset), SEEK_SET) == 0;
+#endif
+}
+
+} // anonymous namespace
+
+LasPipeline::LasPipeline(const std::string& theSource, const las::Header& theHeader, unsigned int theThreads) :
+	mSource(theSource),
+	mHeader(theHeader),
+	mDecoders(1)
+{
+	unsigned int threads = theThreads > 0 ? theThreads : util::ThreadPool::hardwareThreads();
+	// One thread reads, the rest decode. Bucketing runs in calling thread.
+	if(threads > 2)
+	{
+		mDecoders = threads - 1;
+	}
+}
+
+LasPipeline::Result LasPipeline::run(const LidarMetadata& theMetadata,
+									 double theCellSize,
+									 GridIndex::Mode theGridMode,
+									 PointCloud& thePoints,
+									 std::vector<ChunkSummary>& theChunks,
+									 GridIndex& theGridIndex,
+									 double& theDensity)
+{
+	const unsigned long numberOfPoints = mHeader.numberOfPoints;
+	const std::size_t recordLength = mHeader.pointDataRecordLength;
+	const las::RecordLayout layout = las::recordLayout(mHeader.format(), recordLength);
+	const unsigned long numberOfBlocks = (numberOfPoints + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	const std::size_t blockBytes = BLOCK_SIZE * recordLength;
+
+	// Every block is decoded into its own slots
+	thePoints.clear();
+	thePoints.resize(numberOfPoints);
+	theChunks.assign(numberOfBlocks, ChunkSummary());
+
+	const bool bucketing = theCellSize > 0;
+	std::unique_ptr<DensityEstimator> estimator;
+	if(bucketing)
+	{
+		theGridIndex.reset(theMetadata, theCellSize, theGridMode);
+	}
+	else
+	{
+		estimator.reset(new DensityEstimator(theMetadata));
+	}
+
+	// Buffers are recycled between reader and decoders
+	const unsigned int numberOfBuffers = 2 * mDecoders + 2;
+	std::vector<char> buffers(numberOfBuffers * blockBytes);
+	util::BoundedQueue<int> freeBuffers(numberOfBuffers);
+	util::BoundedQueue<RawBlock> rawBlocks(numberOfBuffers + mDecoders);
+	util::BoundedQueue<int> decodedBlocks(numberOfBuffers + mDecoders);
+	for(unsigned int i = 0; i < numberOfBuffers; ++i)
+	{
+		freeBuffers.push(i);
+	}
+
+	std::atomic<bool> readFailed(false);
+
+	std::thread reader([&]()
+	{
+		std::FILE* file = std::fopen(mSource.c_str(), "rb");
+		if(file == 0 || !seekTo(file, mHeader.pointDataOffset))
+		{
+			readFailed = true;
+		}
+
+		for(unsigned long block = 0; block < numberOfBlocks && !readFailed; ++block)
+		{
+			int buffer = freeBuffers.pop();
+			std::size_t count = std::min(BLOCK_SIZE, numberOfPoints - block * BLOCK_SIZE);
+			std::size_t bytes = count * recordLength;
+			if(std::fread(&buffers[buffer * blockBytes], 1, bytes, file) != bytes)
+			{
+				readFailed = true;
+				freeBuffers.push(buffer);
+				break;
+			}
+			RawBlock raw = { static_cast<int>(block), buffer };
+			rawBlocks.push(raw);
+		}
+
+		if(file != 0)
+		{
+			std::fclose(file);
+		}
+
+		for(unsigned int i = 0; i < mDecoders; ++i)
+		{
+			RawBlock end = { END_OF_STREAM, -1 };
+			rawBlocks.push(end);
+		}
+	});
+
+	std::vector<std::thread> decoders;
+	for(unsigned int i = 0; i < mDecoders; ++i)
+	{
+		decoders.push_back(std::thread([&]()
+		{
+			for(;;)
+			{
+				RawBlock raw = rawBlocks.pop();
+				if(raw.block == END_OF_STREAM)
+				{
+					decodedBlocks.push(END_OF_STREAM);
+					return;
+				}
+
+				unsigned long first = raw.block * BLOCK_SIZE;
+				unsigned long count = std::min(BLOCK_SIZE, numberOfPoints - first);
+				LasReader::decodeRecords(&buffers[raw.buffer * blockBytes], layout,
+					first, count, thePoints, first, theChunks[raw.block]);
+
+				freeBuffers.push(raw.buffer);
+				decodedBlocks.push(raw.block);
+			}
+		}));
+	}
+
+	// Bucketing stage. Blocks are bucketed in file order, so cells
+	// get the same order of points as with GridIndex::create.
+	std::vector<char> decoded(numberOfBlocks, 0);
+	std::vector<double> xs(bucketing ? 0 : BLOCK_SIZE);
+	std::vector<double> ys(bucketing ? 0 : BLOCK_SIZE);
+	unsigned long next = 0;
+	unsigned int finishedDecoders = 0;
+	bool inside = true;
+	std::exception_ptr error;
+
+	while(finishedDecoders < mDecoders)
+	{
+		int block = decodedBlocks.pop();
+		if(block == END_OF_STREAM)
+		{
+			++finishedDecoders;
+			continue;
+		}
+
+		decoded[block] = 1;
+		for( ; next < numberOfBlocks && decoded[next]; ++next)
+		{
+			if(!inside || error)
+			{
+				// Keep draining the queue so other stages can finish
+				continue;
+			}
+
+			try
+			{
+				std::size_t first = next * BLOCK_SIZE;
+				std::size_t count = std::min(BLOCK_SIZE, numberOfPoints - first);
+				if(bucketing)
+				{
+					inside = theGridIndex.insert(thePoints, first, count);
+				}
+				else
+				{
+					thePoints.realCoords(first, count, &xs[0], &ys[0], 0);
+					for(std::size_t i = 0; i < count && inside; ++i)
+					{
+						inside = estimator->add(xs[i], ys[i]);
+					}
+				}
+			}
+			catch (...)
+			{
+				error = std::current_exception();
+			}
+		}
+	}
+
+	reader.join();
+	for(std::vector<std::thread>::iterator it = decoders.begin(); it != decoders.end(); ++it)
+	{
+		(*it).join();
+	}
+
+	if(error)
+	{
+		std::rethrow_exception(error);
+	}
+
+	if(readFailed || next != numberOfBlocks)
+	{
+		throw std::runtime_error("Reading point records of " + mSource + " failed.");
+	}
+
+	if(!inside)
+	{
+		return OUT_OF_BOUNDS;
+	}
+
+	if(bucketing)
+	{
+		util::ThreadPool pool(mDecoders + 1);
+		theGridIndex.finish(thePoints, pool);
+		return INDEXED;
+	}
+
+	theDensity = estimator->density();
+	return COUNTED;
+}
+
+}
+} // namespace terrace::lidar
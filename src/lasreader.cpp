@@ -0,0 +1,400 @@
+/******************************************************************************
+ * lasreader.cpp
+ *
+ *
+ ******************************************************************************
+ * Copyright (c) 2014, Vladimir Pajic
+ *
+ *****************************************************************************/
+
+///////////////////////////////////////////////////////////////////////////////
+// Included dependacies
+
+#include "lasreader.hpp"
+
+namespace terrace
+{
+namespace lidar
+{
+
+const unsigned long LasReader::CHUNK_SIZE;
+const unsigned long LasReader::REGION_BLOCK_SIZE;
+
+namespace
+{
+
+/// Attribute columns of a cloud that records are decoded into. Pointers
+/// are 0 for attributes that either the cloud or the records do not have.
+struct AttributeColumns
+{
+public:
+	uint16_t* intensity;
+	unsigned char* returns;
+	double* gpsTime;
+	uint16_t* rgb;
+
+	AttributeColumns(PointCloud& thePoints, const las::RecordLayout& theLayout) :
+		intensity(thePoints.intensityData()),
+		returns(thePoints.returnsData()),
+		gpsTime(theLayout.gpsTime >= 0 ? thePoints.gpsTimeData() : 0),
+		rgb(theLayout.rgb >= 0 ? thePoints.rgbData() : 0)
+	{
+	}
+
+	inline bool empty() const
+	{
+		return intensity == 0 && returns == 0 && gpsTime == 0 && rgb == 0;
+	}
+
+	/// Decodes attributes of one record into point theIndex
+	inline void decode(const char* theRecord, const las::RecordLayout& theLayout, std::size_t theIndex) const
+	{
+		if(intensity != 0)
+		{
+			intensity[theIndex] = las::readLE<uint16_t>(theRecord + las::RECORD_INTENSITY);
+		}
+		if(returns != 0)
+		{
+			returns[theIndex] = static_cast<unsigned char>(theRecord[las::RECORD_RETURNS]);
+		}
+		if(gpsTime != 0)
+		{
+			gpsTime[theIndex] = las::readLE<double>(theRecord + theLayout.gpsTime);
+		}
+		if(rgb != 0)
+		{
+			for(unsigned int i = 0; i < 3; ++i)
+			{
+				rgb[3 * theIndex + i] = las::readLE<uint16_t>(theRecord + theLayout.rgb + 2 * i);
+			}
+		}
+	}
+};
+
+} // anonymous namespace
+
+bool LasReader::open(const std::string& theSource)
+{
+	close();
+
+	if(!mFile.open(theSource))
+	{
+		return false;
+	}
+
+	if(!las::decodeHeader(mFile.data(), mFile.size(), mHeader))
+	{
+		close();
+		return false;
+	}
+
+	if(!las::decodeVlrs(mFile.data(), mFile.size(), mHeader, mVlrs))
+	{
+		// Point data can still be read
+		mVlrs.clear();
+	}
+
+	unsigned long long pointBlockEnd = mHeader.pointDataOffset
+		+ static_cast<unsigned long long>(mHeader.numberOfPoints) * mHeader.pointDataRecordLength;
+
+	mSupported = !mHeader.compressed()
+		&& mHeader.format() <= las::MAX_NATIVE_FORMAT
+		&& mHeader.pointDataRecordLength >= las::recordLength(mHeader.format())
+		&& pointBlockEnd <= mFile.size();
+
+	mLayout = las::recordLayout(mHeader.format(), mHeader.pointDataRecordLength);
+
+	return true;
+}
+
+void LasReader::close()
+{
+	mFile.close();
+	mHeader = las::Header();
+	mLayout = las::RecordLayout();
+	mVlrs.clear();
+	mSupported = false;
+}
+
+void ChunkSummary::merge(const ChunkSummary& theOther)
+{
+	for(unsigned int i = 0; i < 3; ++i)
+	{
+		min[i] = std::min(min[i], theOther.min[i]);
+		max[i] = std::max(max[i], theOther.max[i]);
+	}
+	for(unsigned int i = 0; i < 32; ++i)
+	{
+		classCounts[i] += theOther.classCounts[i];
+	}
+	count += theOther.count;
+}
+
+unsigned int LasReader::attributes() const
+{
+	unsigned int attributes = PointCloud::INTENSITY | PointCloud::RETURNS;
+	if(mLayout.gpsTime >= 0)
+	{
+		attributes |= PointCloud::GPS_TIME;
+	}
+	if(mLayout.rgb >= 0)
+	{
+		attributes |= PointCloud::RGB;
+	}
+	return attributes;
+}
+
+void LasReader::readPoints(unsigned long theFirst,
+						   unsigned long theCount,
+						   PointCloud& thePoints,
+						   std::size_t thePosition,
+						   ChunkSummary& theSummary) const
+{
+	decodeRecords(record(theFirst), mLayout, 
+		theFirst, theCount, thePoints, thePosition, theSummary);
+}
+
+void LasReader::decodeRecords(const char* theBytes,
+							  const las::RecordLayout& theLayout,
+							  unsigned long theFirst,
+							  unsigned long theCount,
+							  PointCloud& thePoints,
+							  std::size_t thePosition,
+							  ChunkSummary& theSummary)
+{
+	theSummary = ChunkSummary();
+	theSummary.first = theFirst;
+	theSummary.count = theCount;
+
+	int32_t* xs = thePoints.xData() + thePosition;
+	int32_t* ys = thePoints.yData() + thePosition;
+	int32_t* zs = thePoints.zData() + thePosition;
+	unsigned char* classes = thePoints.classificationData() + thePosition;
+
+	const char* rec = theBytes;
+
+	for(unsigned long i = 0; i < theCount; ++i, rec += theLayout.length)
+	{
+		int32_t x = las::readLE<int32_t>(rec + las::RECORD_X);
+		int32_t y = las::readLE<int32_t>(rec + las::RECORD_Y);
+		int32_t z = las::readLE<int32_t>(rec + las::RECORD_Z);
+		unsigned char cls = static_cast<unsigned char>(rec[las::RECORD_CLASSIFICATION] & las::CLASS_MASK);
+
+		xs[i] = x;
+		ys[i] = y;
+		zs[i] = z;
+		classes[i] = cls;
+
+		theSummary.min[0] = std::min<long>(theSummary.min[0], x);
+		theSummary.min[1] = std::min<long>(theSummary.min[1], y);
+		theSummary.min[2] = std::min<long>(theSummary.min[2], z);
+		theSummary.max[0] = std::max<long>(theSummary.max[0], x);
+		theSummary.max[1] = std::max<long>(theSummary.max[1], y);
+		theSummary.max[2] = std::max<long>(theSummary.max[2], z);
+		++theSummary.classCounts[cls];
+	}
+
+	// Attributes are decoded in a separate pass, so loads
+	// without attribute columns do not pay for them
+	AttributeColumns columns(thePoints, theLayout);
+	if(!columns.empty())
+	{
+		rec = theBytes;
+		for(unsigned long i = 0; i < theCount; ++i, rec += theLayout.length)
+		{
+			columns.decode(rec, theLayout, thePosition + i);
+		}
+	}
+}
+
+unsigned long LasReader::decodeRecords(const char* theBytes,
+									   const las::RecordLayout& theLayout,
+									   const Region& theRegion,
+									   unsigned long theFirst,
+									   unsigned long theCount,
+									   PointCloud& thePoints,
+									   std::size_t thePosition,
+									   ChunkSummary& theSummary)
+{
+	theSummary = ChunkSummary();
+	theSummary.first = theFirst;
+
+	const LidarMetadata& metadata = thePoints.metadata();
+	const double scaleX = metadata.scales().x;
+	const double scaleY = metadata.scales().y;
+	const double offsetX = metadata.offsets().x;
+	const double offsetY = metadata.offsets().y;
+
+	AttributeColumns columns(thePoints, theLayout);
+	const bool attributes = !columns.empty();
+
+	const char* rec = theBytes;
+	const char* end = rec + static_cast<std::size_t>(theCount) * theLayout.length;
+
+	for( ; rec != end; rec += theLayout.length)
+	{
+		int32_t x = las::readLE<int32_t>(rec + las::RECORD_X);
+		int32_t y = las::readLE<int32_t>(rec + las::RECORD_Y);
+
+		if(!theRegion.contains(x * scaleX + offsetX, y * scaleY + offsetY))
+		{
+			continue;
+		}
+
+		int32_t z = las::readLE<int32_t>(rec + las::RECORD_Z);
+		unsigned char cls = static_cast<unsigned char>(rec[las::RECORD_CLASSIFICATION] & las::CLASS_MASK);
+
+		if(attributes)
+		{
+			columns.decode(rec, theLayout, thePosition + theSummary.count);
+		}
+		thePoints.set(thePosition + theSummary.count++, x, y, z, cls);
+
+		theSummary.min[0] = std::min<long>(theSummary.min[0], x);
+		theSummary.min[1] = std::min<long>(theSummary.min[1], y);
+		theSummary.min[2] = std::min<long>(theSummary.min[2], z);
+		theSummary.max[0] = std::max<long>(theSummary.max[0], x);
+		theSummary.max[1] = std::max<long>(theSummary.max[1], y);
+		theSummary.max[2] = std::max<long>(theSummary.max[2], z);
+		++theSummary.classCounts[cls];
+	}
+
+	return theSummary.count;
+}
+
+void LasReader::readPoints(util::ThreadPool& thePool,
+						   PointCloud& thePoints,
+						   std::vector<ChunkSummary>& theChunks) const
+{
+	unsigned long numberOfPoints = mHeader.numberOfPoints;
+	unsigned long numberOfChunks = (numberOfPoints + CHUNK_SIZE - 1) / CHUNK_SIZE;
+
+	// Every chunk writes to its own slots, so no synchronization is needed
+	thePoints.clear();
+	thePoints.resize(numberOfPoints);
+	theChunks.assign(numberOfChunks, ChunkSummary());
+
+	if(numberOfPoints == 0)
+	{
+		return;
+	}
+
+	ChunkSummary* chunks = &theChunks[0];
+
+	thePool.run(numberOfChunks, [&](unsigned int i)
+	{
+		unsigned long first = i * CHUNK_SIZE;
+		unsigned long count = std::min(CHUNK_SIZE, numberOfPoints - first);
+		readPoints(first, count, thePoints, first, chunks[i]);
+	});
+}
+
+void LasReader::readAttributes(util::ThreadPool& thePool, PointCloud& thePoints) const
+{
+	unsigned long numberOfPoints = std::min<unsigned long>(mHeader.numberOfPoints, thePoints.size());
+	unsigned long numberOfChunks = (numberOfPoints + CHUNK_SIZE - 1) / CHUNK_SIZE;
+
+	AttributeColumns columns(thePoints, mLayout);
+	if(columns.empty())
+	{
+		return;
+	}
+
+	thePool.run(numberOfChunks, [&](unsigned int i)
+	{
+		unsigned long first = i * CHUNK_SIZE;
+		unsigned long end = std::min(first + CHUNK_SIZE, numberOfPoints);
+		const char* rec = record(first);
+		for(unsigned long j = first; j < end; ++j, rec += mLayout.length)
+		{
+			columns.decode(rec, mLayout, j);
+		}
+	});
+}
+
+void LasReader::readPoints(util::ThreadPool& thePool,
+						   const Region& theRegion,
+						   PointCloud& thePoints,
+						   std::vector<ChunkSummary>& theChunks) const
+{
+	std::vector<RecordRange> ranges;
+	if(mHeader.numberOfPoints > 0)
+	{
+		ranges.push_back(RecordRange(0, mHeader.numberOfPoints));
+	}
+	readPoints(thePool, theRegion, ranges, thePoints, theChunks);
+}
+
+void LasReader::readPoints(util::ThreadPool& thePool,
+						   const Region& theRegion,
+						   const std::vector<RecordRange>& theRanges,
+						   PointCloud& thePoints,
+						   std::vector<ChunkSummary>& theChunks) const
+{
+	// Split ranges into chunks
+	std::vector<RecordRange> chunkRanges;
+	for(std::vector<RecordRange>::const_iterator it = theRanges.begin(); it != theRanges.end(); ++it)
+	{
+		unsigned long end = std::min<unsigned long>((*it).first + (*it).count, mHeader.numberOfPoints);
+		for(unsigned long first = (*it).first; first < end; first += CHUNK_SIZE)
+		{
+			chunkRanges.push_back(RecordRange(first, std::min(CHUNK_SIZE, end - first)));
+		}
+	}
+
+	unsigned long numberOfChunks = chunkRanges.size();
+
+	thePoints.clear();
+	theChunks.assign(numberOfChunks, ChunkSummary());
+
+	// Every chunk keeps its points in own buffer, buffers are
+	// appended in file order afterwards
+	std::vector<PointCloud> kept(numberOfChunks, PointCloud(thePoints.metadata()));
+	ChunkSummary* chunks = numberOfChunks > 0 ? &theChunks[0] : 0;
+
+	thePool.run(numberOfChunks, [&](unsigned int i)
+	{
+		const unsigned long end = chunkRanges[i].first + chunkRanges[i].count;
+		const unsigned long blockSize = std::min(REGION_BLOCK_SIZE, chunkRanges[i].count);
+
+		// Blocks of records are decoded into scratch buffer and
+		// only the points inside of region are copied out
+		PointCloud scratch(thePoints.metadata());
+		scratch.setAttributes(thePoints.attributes());
+
+		PointCloud& buffer = kept[i];
+		buffer.setAttributes(thePoints.attributes());
+
+		chunks[i].first = chunkRanges[i].first;
+		for(unsigned long first = chunkRanges[i].first; first < end; first += blockSize)
+		{
+			ChunkSummary block;
+			scratch.resize(blockSize);
+			unsigned long inside = decodeRecords(record(first), mLayout,
+				theRegion, first, std::min(blockSize, end - first), scratch, 0, block);
+			chunks[i].merge(block);
+
+			if(inside > 0)
+			{
+				scratch.resize(inside);
+				buffer.append(scratch);
+			}
+		}
+	});
+
+	std::size_t total = 0;
+	for(unsigned long i = 0; i < numberOfChunks; ++i)
+	{
+		total += kept[i].size();
+	}
+
+	thePoints.reserve(total);
+	for(unsigned long i = 0; i < numberOfChunks; ++i)
+	{
+		thePoints.append(kept[i]);
+		kept[i].release();
+	}
+}
+
+}
+} // namespace terrace::lidar
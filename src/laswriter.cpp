@@ -0,0 +1,305 @@
+/******************************************************************************
+ * laswriter.cpp
+ *
+ *
+ ******************************************************************************
+ * Copyright (c) 2014, Vladimir Pajic
+ *
+ *****************************************************************************/
+
+///////////////////////////////////////////////////////////////////////////////
+// Included dependacies
+
+#include "laswriter.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <new>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+namespace terrace
+{
+namespace lidar
+{
+
+const std::size_t LasWriter::BUFFER_SIZE;
+const std::size_t LasWriter::BUFFER_ALIGNMENT;
+
+namespace
+{
+
+/// Block of memory aligned to given boundary
+class AlignedBuffer
+{
+public:
+
+	AlignedBuffer(std::size_t theSize, std::size_t theAlignment) : mData(0)
+	{
+#ifdef _WIN32
+		mData = static_cast<char*>(_aligned_malloc(theSize, theAlignment));
+#else
+		void* data = 0;
+		if(posix_memalign(&data, theAlignment, theSize) == 0)
+		{
+			mData = static_cast<char*>(data);
+		}
+#endif
+		if(mData == 0)
+		{
+			throw std::bad_alloc();
+		}
+	}
+
+	~AlignedBuffer()
+	{
+#ifdef _WIN32
+		_aligned_free(mData);
+#else
+		std::free(mData);
+#endif
+	}
+
+	inline char* data()
+	{
+		return mData;
+	}
+
+private:
+
+	// Not copyable
+	AlignedBuffer(const AlignedBuffer&);
+	AlignedBuffer& operator=(const AlignedBuffer&);
+
+	char* mData;
+};
+
+/// Encodes points as format 3 records. Fields are taken from the
+/// record of field source first (if any), then overwritten with
+/// coordinates, class and attribute columns of the cloud. Other
+/// fields are zero, same as in liblas::Point populated by LidarPoint.
+class RecordEncoder
+{
+public:
+
+	RecordEncoder(const PointCloud& thePoints, const LasReader* theFieldSource) :
+		mPoints(thePoints),
+		mFieldSource(theFieldSource),
+		mLayout(las::recordLayout(las::OUTPUT_FORMAT, las::recordLength(las::OUTPUT_FORMAT))),
+		mIntensity(thePoints.intensityData()),
+		mReturns(thePoints.returnsData()),
+		mGpsTime(thePoints.gpsTimeData()),
+		mRgb(thePoints.rgbData())
+	{
+	}
+
+	inline void encode(std::size_t theIndex, char* theBytes) const
+	{
+		if(mFieldSource != 0)
+		{
+			las::copyRecordFields(mFieldSource->record(theIndex), mFieldSource->layout(), theBytes, mLayout);
+		}
+
+		las::writeLE<int32_t>(theBytes + las::RECORD_X, mPoints.x(theIndex));
+		las::writeLE<int32_t>(theBytes + las::RECORD_Y, mPoints.y(theIndex));
+		las::writeLE<int32_t>(theBytes + las::RECORD_Z, mPoints.z(theIndex));
+
+		// Flags copied from source are kept
+		theBytes[las::RECORD_CLASSIFICATION] = static_cast<char>(
+			(theBytes[las::RECORD_CLASSIFICATION] & ~las::CLASS_MASK) | mPoints.classification(theIndex));
+
+		if(mIntensity != 0)
+		{
+			las::writeLE<uint16_t>(theBytes + las::RECORD_INTENSITY, mIntensity[theIndex]);
+		}
+		if(mReturns != 0)
+		{
+			theBytes[las::RECORD_RETURNS] = static_cast<char>(mReturns[theIndex]);
+		}
+		if(mGpsTime != 0)
+		{
+			las::writeLE<double>(theBytes + mLayout.gpsTime, mGpsTime[theIndex]);
+		}
+		if(mRgb != 0)
+		{
+			for(unsigned int i = 0; i < 3; ++i)
+			{
+				las::writeLE<uint16_t>(theBytes + mLayout.rgb + 2 * i, mRgb[3 * theIndex + i]);
+			}
+		}
+	}
+
+	/// Encodes theCount points starting from theFirst.
+	/// If theOrder is not 0, i-th record holds point theOrder[i].
+	void encode(const uint32_t* theOrder, std::size_t theFirst, std::size_t theCount, char* theBytes) const
+	{
+		std::memset(theBytes, 0, theCount * mLayout.length);
+
+		for(std::size_t i = theFirst; i < theFirst + theCount; ++i, theBytes += mLayout.length)
+		{
+			encode(theOrder != 0 ? theOrder[i] : i, theBytes);
+		}
+	}
+
+private:
+	const PointCloud& mPoints;
+	const LasReader* mFieldSource;
+	las::RecordLayout mLayout;
+	const uint16_t* mIntensity;
+	const unsigned char* mReturns;
+	const double* mGpsTime;
+	const uint16_t* mRgb;
+};
+
+} // anonymous namespace
+
+bool LasWriter::open(const std::string& theDestination)
+{
+	close();
+
+	mFile = std::fopen(theDestination.c_str(), "wb");
+	if(mFile != 0)
+	{
+		// Data is always written in large blocks
+		std::setvbuf(mFile, 0, _IONBF, 0);
+	}
+
+	return mFile != 0;
+}
+
+void LasWriter::close()
+{
+	if(mFile != 0)
+	{
+		std::fclose(mFile);
+		mFile = 0;
+	}
+}
+
+void LasWriter::writeBytes(const char* theBytes, std::size_t theSize)
+{
+	if(std::fwrite(theBytes, 1, theSize, mFile) != theSize)
+	{
+		throw std::runtime_error("Writing to LAS file failed.");
+	}
+}
+
+void LasWriter::copyFieldsFrom(const LasReader* theSource)
+{
+	mFieldSource = theSource != 0 && theSource->supported() ? theSource : 0;
+}
+
+void LasWriter::write(const LidarMetadata& theMetadata,
+					  const PointCloud& thePoints,
+					  util::ThreadPool& thePool)
+{
+	writeFile(theMetadata, thePoints, 0, std::vector<las::VariableLengthRecord>(), thePool);
+}
+
+void LasWriter::write(const LidarMetadata& theMetadata,
+					  const PointCloud& thePoints,
+					  const std::vector<uint32_t>& theOrder,
+					  const std::vector<las::VariableLengthRecord>& theVlrs,
+					  util::ThreadPool& thePool)
+{
+	if(theOrder.size() != thePoints.size())
+	{
+		throw std::invalid_argument("Order does not cover all points.");
+	}
+
+	writeFile(theMetadata, thePoints, theOrder.empty() ? 0 : &theOrder[0], theVlrs, thePool);
+}
+
+void LasWriter::writeFile(const LidarMetadata& theMetadata,
+						  const PointCloud& thePoints,
+						  const uint32_t* theOrder,
+						  const std::vector<las::VariableLengthRecord>& theVlrs,
+						  util::ThreadPool& thePool)
+{
+	if(mFile == 0)
+	{
+		throw std::runtime_error("LAS file is not open.");
+	}
+
+	std::vector<char> vlrBytes;
+	for(std::vector<las::VariableLengthRecord>::const_iterator it = theVlrs.begin(); it != theVlrs.end(); ++it)
+	{
+		las::encodeVlr(*it, vlrBytes);
+	}
+
+	las::Header header;
+	theMetadata.populateLasHeader(header);
+	header.numberOfPoints = static_cast<uint32_t>(thePoints.size());
+	header.numberOfVlrs = static_cast<uint32_t>(theVlrs.size());
+	header.pointDataOffset = static_cast<uint32_t>(header.headerSize + vlrBytes.size());
+
+	char headerBytes[las::HEADER_SIZE];
+	las::encodeHeader(header, headerBytes);
+	writeBytes(headerBytes, las::HEADER_SIZE);
+	if(!vlrBytes.empty())
+	{
+		writeBytes(&vlrBytes[0], vlrBytes.size());
+	}
+
+	const std::size_t recordLength = header.pointDataRecordLength;
+	const std::size_t recordsPerBuffer = BUFFER_SIZE / recordLength;
+	const std::size_t numberOfBuffers = (thePoints.size() + recordsPerBuffer - 1) / recordsPerBuffer;
+
+	if(numberOfBuffers == 0)
+	{
+		return;
+	}
+
+	// Two groups of buffers: one is encoded while the other is written
+	const std::size_t groupSize = thePool.size();
+	AlignedBuffer buffers(2 * groupSize * BUFFER_SIZE, BUFFER_ALIGNMENT);
+	std::vector<std::size_t> used(2 * groupSize, 0);
+
+	RecordEncoder encoder(thePoints, mFieldSource);
+	std::future<void> flushing;
+
+	for(std::size_t first = 0; first < numberOfBuffers; first += groupSize)
+	{
+		const std::size_t slot = ((first / groupSize) % 2) * groupSize;
+		const std::size_t count = std::min(groupSize, numberOfBuffers - first);
+
+		thePool.run(static_cast<unsigned int>(count), [&](unsigned int i)
+		{
+			std::size_t firstPoint = (first + i) * recordsPerBuffer;
+			std::size_t numberOfPoints = std::min(recordsPerBuffer, thePoints.size() - firstPoint);
+			encoder.encode(theOrder, firstPoint, numberOfPoints, buffers.data() + (slot + i) * BUFFER_SIZE);
+			used[slot + i] = numberOfPoints * recordLength;
+		});
+
+		// Previous group has to be on disk before its buffers are reused
+		if(flushing.valid())
+		{
+			flushing.get();
+		}
+
+		char* data = buffers.data();
+		std::size_t* sizes = &used[0];
+		flushing = std::async(std::launch::async, [this, data, sizes, slot, count]()
+		{
+			for(std::size_t i = slot; i < slot + count; ++i)
+			{
+				writeBytes(data + i * BUFFER_SIZE, sizes[i]);
+			}
+		});
+	}
+
+	flushing.get();
+
+	if(std::fflush(mFile) != 0)
+	{
+		throw std::runtime_error("Writing to LAS file failed.");
+	}
+}
+
+}
+} // namespace terrace::lidar
@@ -14,62 +14,212 @@
 #include "lidarpoint.hpp"
 #include "lidarmetadata.hpp"
 #include "groundclassifier1.hpp"
+#include "lasreader.hpp"
+#include "laspipeline.hpp"
+#include "laswriter.hpp"
+#include "chunktable.hpp"
+#include "spatialindex.hpp"
+#include "xyzreader.hpp"
+#include "radixsort.hpp"
 
 #include "liblas\liblas.hpp"
 
+#include <algorithm>
 #include <fstream>  
 #include <iostream>
 #include <ios>
 #include <map>
 #include <string>
-#include <sstream>
 
 namespace terrace
 {
 namespace lidar
 {
 
-bool LidarDataset::load(const std::string& theSource)
+bool LidarDataset::load(const std::string& theSource, const LoadOptions& theOptions)
+{
+	return load(theSource, 0, theOptions);
+}
+
+bool LidarDataset::load(const std::string& theSource, const Region& theRegion, const LoadOptions& theOptions)
+{
+	return load(theSource, &theRegion, theOptions);
+}
+
+bool LidarDataset::load(const std::string& theSource, const Region* theRegion, const LoadOptions& theOptions)
 {
 	if( !mLoaded )
 	{
-		std::ifstream ifs;
-		ifs.open(theSource.c_str(), std::ios::in | std::ios::binary);
-
 		try 
 		{
-			liblas::ReaderFactory f;
-			liblas::Reader reader = f.CreateWithStream(ifs);
-				
+			// Cache holds the whole data set without attributes, which are
+			// decoded from source after a hit, so only in the order of records
+			const bool useCache = !theOptions.cache.empty() && theRegion == 0
+				&& theOptions.gridMode == GridIndex::ALL_POINTS
+				&& !(theOptions.reorder && theOptions.attributes != 0);
+
+			// Cached points are already in requested order
+			if(useCache && DatasetCache::read(theOptions.cache, theSource, theOptions, *this))
+			{
+				log() << "Loaded data set from cache " << theOptions.cache << ".\n";
+				if(theOptions.attributes != 0 && !loadAttributes(theOptions.attributes, theOptions.threads))
+				{
+					std::cerr << "Error: Cannot load attributes of " << theSource << std::endl;
+					mPoints.release();
+					mChunks.clear();
+					return mLoaded;
+				}
+				mLoaded = true;
+				if(theOptions.quadtree)
+				{
+					util::ThreadPool pool(theOptions.threads);
+					mQuadtreeIndex.create(mMetadata, mPoints, pool, theOptions.leafCapacity);
+				}
+				return mLoaded;
+			}
+
+			// Pipelined loading can build the index (or estimate density)
+			// while points are being read
+			bool indexed = false;
+			bool counted = false;
+
+			LasReader lasReader;
+			if(lasReader.open(theSource) && lasReader.supported())
+			{
+				mMetadata.setFromLasHeader(lasReader.header());
+				mPoints.setAttributes(theOptions.attributes & lasReader.attributes());
+
+				if(theRegion != 0)
+				{
+					// Sidecar index restricts reading to records of the cells region touches
+					std::vector<RecordRange> ranges;
+					SpatialIndex spatialIndex;
+					if(spatialIndex.read(SpatialIndex::sidecarPath(theSource), theSource))
+					{
+						spatialIndex.query(*theRegion, ranges);
+						log() << "Using spatial index " << SpatialIndex::sidecarPath(theSource) << ".\n";
+					}
+					else
+					{
+						// Spatially ordered files carry bounds of their chunks
+						std::vector<ChunkSummary> chunkTable;
+						if(ChunkTable::decode(lasReader.vlrs(), chunkTable))
+						{
+							ChunkTable::query(chunkTable, lasReader.header(), *theRegion, ranges);
+							log() << "Using chunk table of " << theSource << ".\n";
+						}
+						else
+						{
+							ranges.push_back(RecordRange(0, lasReader.header().numberOfPoints));
+						}
+					}
+
+					util::ThreadPool pool(theOptions.threads);
+					lasReader.readPoints(pool, *theRegion, ranges, mPoints, mChunks);
+
+					ChunkSummary subset;
+					for(std::vector<ChunkSummary>::const_iterator it = mChunks.begin(); it != mChunks.end(); ++it)
+					{
+						subset.merge(*it);
+					}
+					fitToSubset(subset);
+				}
+				else if(theOptions.pipelined)
+				{
+					LasPipeline pipeline(theSource, lasReader.header(), theOptions.threads);
+					LasPipeline::Result result = pipeline.run(mMetadata, theOptions.cellSize, 
+						theOptions.gridMode, mPoints, mChunks, mGridIndex, mDensity);
+					indexed = result == LasPipeline::INDEXED;
+					counted = result == LasPipeline::COUNTED;
+				}
+				else
+				{
+					util::ThreadPool pool(theOptions.threads);
+					lasReader.readPoints(pool, mPoints, mChunks);
+				}
+
+				checkBounds();
+			}
+			else
+			{
+				// Compressed or newer point formats are read through liblas
+				lasReader.close();
+				loadWithLiblas(theSource, theRegion);
+				if(theOptions.attributes != 0)
+				{
+					std::cerr << "Info: Attributes are not read from " << theSource << std::endl;
+				}
+			}
+
+			if(mPoints.empty())
+			{
+				std::cerr << "Info: No points to load from " << theSource << std::endl;
+				mChunks.clear();
+				return mLoaded;
+			}
+
+			if(mPoints.size() >= PointCloud::NO_POINT)
+			{
+				// Grid index refers to points by 32 bit indices
+				std::cerr << "Error: " << theSource << " has too many points to be indexed." << std::endl;
+				mPoints.release();
+				mChunks.clear();
+				return mLoaded;
+			}
+
 			mSource = theSource;
-			mMetadata.setFromLasHeader(reader.GetHeader());
-			mPoints.reserve(mMetadata.numberOfPoints());
-				
-			for(unsigned long i = 0; i < mMetadata.numberOfPoints(); ++i)
+			mRecordOrder = theRegion == 0;
+
+			if(theOptions.reorder)
 			{
-				reader.ReadNextPoint();
-				mPoints.push_back( LidarPoint(mMetadata, reader.GetPoint()) );
+				// Grid index built by pipeline is remapped
+				reorder(theOptions.curve, theOptions.threads);
 			}
 
-			std::cout << "Creating grid index.\n";
+			if(!indexed)
+			{
+				double pointSpacing = theOptions.cellSize;
+				if(pointSpacing <= 0)
+				{
+					if(!counted)
+					{
+						log() << "Estimating point density.\n";
+						mDensity = GridIndex::estimateDensity(mMetadata, mPoints);
+					}
+					pointSpacing = std::sqrt(1 / mDensity);
+
+					log() << "Point density is " << mDensity 
+						<< "\nPoint spacing is " << pointSpacing
+						<< "\n";
+				}
 
-			mGridIndex.create(mMetadata, mPoints, 1);
+				log() << "Creating grid index with cell size of " << pointSpacing << "\n";
 
-			std::cout << "Estimating point density.\n";
+				util::ThreadPool pool(theOptions.threads);
+				mGridIndex.create(mMetadata, mPoints, pool, pointSpacing, theOptions.gridMode);
+			}
 
-			double pointDensity = estimateDensity();
-			double pointSpacing = std::sqrt(1 / pointDensity);
+			if(theOptions.quadtree)
+			{
+				log() << "Creating quadtree index with leaf capacity of " << theOptions.leafCapacity << "\n";
 
-			std::cout << "Point density is " << pointDensity 
-				<< "\nPoint spacing is " << pointSpacing
-				<< "\nRegenerating grid index with cell size of " << pointSpacing
-				<< "\n";
+				util::ThreadPool pool(theOptions.threads);
+				mQuadtreeIndex.create(mMetadata, mPoints, pool, theOptions.leafCapacity);
+			}
 
-			mGridIndex.create(mMetadata, mPoints, pointSpacing);
+			if(theOptions.cellSize > 0)
+			{
+				mDensity = estimateDensity();
+			}
 
-			std::cout << "Done.\n";
+			log() << "Done.\n";
 
 			mLoaded = true;
+
+			if(useCache && !DatasetCache::write(theOptions.cache, theOptions, *this))
+			{
+				std::cerr << "Info: Cannot write cache " << theOptions.cache << std::endl;
+			}
 		}
 		catch (const std::exception& e)
 		{
@@ -83,133 +233,181 @@ bool LidarDataset::load(const std::string& theSource)
 	return mLoaded;
 }
 
-//true if everything ok, false otherwise
-bool extractCoordsFromString(const std::string& line, wykobi::point3d<double>& coords)
+void LidarDataset::checkBounds()
 {
-	bool result = false;
-	// Extract x, y, and z strings
-	std::istringstream lineStream(line);
-	std::vector<std::string*> fields;
-	int i = 0;
-	while(!lineStream.eof())
+	if(mChunks.empty() || mPoints.empty())
 	{
-		std::string* field = new std::string;
-		std::getline(lineStream, *field, '\t');
-		fields.push_back(field);
+		return;
 	}
 
-	// Convert from strings to values
-	std::istringstream fieldStream;
-	if(fields.size() == 3)
+	ChunkSummary total = mChunks.front();
+	for(std::vector<ChunkSummary>::const_iterator it = mChunks.begin() + 1; it != mChunks.end(); ++it)
 	{
-		fieldStream.str(*fields[0]);
-		if(fieldStream >> coords.x)
-		{	
-			fieldStream.str(*fields[1]);
-			fieldStream.seekg(0, fieldStream.beg);
-			if(fieldStream >> coords.y)
-			{
-				fieldStream.str(*fields[2]);
-				fieldStream.seekg(0, fieldStream.beg);
-				if(fieldStream >> coords.z)
-				{
-						result = true;
-				}
-			}
-		}
+		total.merge(*it);
 	}
 
-	if(!result)
+	mydefs::BoundingBox bb = mMetadata.boundingBox();
+	mydefs::BoundingBox dataBB = wykobi::make_box(
+		total.min[0] * mMetadata.scales().x + mMetadata.offsets().x,
+		total.min[1] * mMetadata.scales().y + mMetadata.offsets().y,
+		total.min[2] * mMetadata.scales().z + mMetadata.offsets().z,
+		total.max[0] * mMetadata.scales().x + mMetadata.offsets().x,
+		total.max[1] * mMetadata.scales().y + mMetadata.offsets().y,
+		total.max[2] * mMetadata.scales().z + mMetadata.offsets().z);
+
+	// Grid index relies on all points being inside the bounds from header
+	if(dataBB[0].x < bb[0].x || dataBB[0].y < bb[0].y || dataBB[0].z < bb[0].z
+		|| dataBB[1].x > bb[1].x || dataBB[1].y > bb[1].y || dataBB[1].z > bb[1].z)
 	{
-		std::cout << "ERROR: Parsing line \"" << line << "\"\n";
+		log() << "WARNING: Points lie outside of bounds stored in header. "
+			<< "Using bounds of points instead.\n";
+		mMetadata.setBoundingBox(dataBB);
 	}
-	for(std::vector<std::string*>::iterator it = fields.begin();
-		it != fields.end();
-		++it)
+}
+
+void LidarDataset::fitToSubset(const ChunkSummary& theSubset)
+{
+	mMetadata.setNumberOfPoints(theSubset.count);
+
+	if(theSubset.count > 0)
 	{
-		delete *it;
+		mMetadata.setBoundingBox(wykobi::make_box(
+			theSubset.min[0] * mMetadata.scales().x + mMetadata.offsets().x,
+			theSubset.min[1] * mMetadata.scales().y + mMetadata.offsets().y,
+			theSubset.min[2] * mMetadata.scales().z + mMetadata.offsets().z,
+			theSubset.max[0] * mMetadata.scales().x + mMetadata.offsets().x,
+			theSubset.max[1] * mMetadata.scales().y + mMetadata.offsets().y,
+			theSubset.max[2] * mMetadata.scales().z + mMetadata.offsets().z));
 	}
-
-	return result;
 }
 
-bool LidarDataset::loadFromXyz(const std::string& theSource)
+void LidarDataset::loadWithLiblas(const std::string& theSource, const Region* theRegion)
 {
-	double minx = std::numeric_limits<double>::max();
-	double maxx = -1 * std::numeric_limits<double>::max();
-	double miny = std::numeric_limits<double>::max();
-	double maxy = -1 * std::numeric_limits<double>::max();
-	double minz = std::numeric_limits<double>::max();
-	double maxz = -1 * std::numeric_limits<double>::max();;
-
-	std::ifstream fileStream;
-	fileStream.open(theSource.c_str(), std::ifstream::in);
-	
-	if(!fileStream.good())
+	std::ifstream ifs;
+	ifs.open(theSource.c_str(), std::ios::in | std::ios::binary);
+
+	liblas::ReaderFactory f;
+	liblas::Reader reader = f.CreateWithStream(ifs);
+		
+	mMetadata.setFromLasHeader(reader.GetHeader());
+	if(theRegion == 0)
 	{
-		return false;
+		mPoints.reserve(mMetadata.numberOfPoints());
 	}
 
-	while(!fileStream.eof())
+	ChunkSummary subset;
+		
+	for(unsigned long i = 0; i < mMetadata.numberOfPoints(); ++i)
 	{
-		std::string line;
-		std::getline(fileStream, line);
+		reader.ReadNextPoint();
+		const liblas::Point& lasPoint = reader.GetPoint();
 
-		wykobi::point3d<double> coords;
-		if(extractCoordsFromString(line, coords))
+		if(theRegion != 0)
 		{
-			LidarPoint lidarPoint(mMetadata, coords);
-			mPoints.push_back(lidarPoint);
-			
-			// Update bounds
-			if(coords.x < minx)
+			if(!theRegion->contains(lasPoint.GetX(), lasPoint.GetY()))
 			{
-				minx = coords.x;
-			}
-			else
-			{
-				if(coords.x > maxx)
-				{
-					maxx = coords.x;
-				}
+				continue;
 			}
 
-			if(coords.y < miny)
+			long coords[3] = { lasPoint.GetRawX(), lasPoint.GetRawY(), lasPoint.GetRawZ() };
+			for(unsigned int j = 0; j < 3; ++j)
 			{
-				miny = coords.y;
-			}
-			else
-			{
-				if(coords.y > maxy)
-				{
-					maxy = coords.y;
-				}
-			}
-
-			if(coords.z < minz)
-			{
-				minz = coords.z;
-			}
-			else
-			{
-				if(coords.z > maxz)
-				{
-					maxz = coords.z;
-				}
+				subset.min[j] = std::min(subset.min[j], coords[j]);
+				subset.max[j] = std::max(subset.max[j], coords[j]);
 			}
+			++subset.count;
 		}
+
+		mPoints.add(static_cast<int32_t>(lasPoint.GetRawX()), 
+			static_cast<int32_t>(lasPoint.GetRawY()), 
+			static_cast<int32_t>(lasPoint.GetRawZ()), 
+			lasPoint.GetClassification().GetClass());
+	}
+
+	if(theRegion != 0)
+	{
+		fitToSubset(subset);
+	}
+}
+
+bool LidarDataset::loadFromXyz(const std::string& theSource, 
+							   const XyzFormat& theFormat, 
+							   const LoadOptions& theOptions)
+{
+	XyzReader xyzReader;
+	if(!xyzReader.open(theSource))
+	{
+		return false;
+	}
+
+	util::ThreadPool pool(theOptions.threads);
+	mydefs::BoundingBox boundingBox;
+	mPoints.setAttributes(theFormat.intensity != XyzFormat::NO_COLUMN ? PointCloud::INTENSITY : 0);
+	xyzReader.readPoints(mMetadata, theFormat, pool, mPoints, boundingBox);
+
+	if(xyzReader.malformedLines() > 0)
+	{
+		log() << "WARNING: Skipped " << xyzReader.malformedLines() 
+			<< " lines that could not be parsed.\n";
 	}
-	
-	fileStream.close();
 
 	mMetadata.setNumberOfPoints(mPoints.size());
-	mMetadata.setBoundingBox(wykobi::make_box(minx, miny, minz, maxx, maxy, maxz));
+	mMetadata.setBoundingBox(boundingBox);
 
 	return true;
 
 }
 
-bool LidarDataset::saveAs(const std::string& theDestination) const
+void LidarDataset::reorder(util::Curve theCurve, unsigned int theThreads)
+{
+	util::ThreadPool pool(theThreads);
+
+	std::vector<uint32_t> order;
+	spatialOrder(theCurve, pool, order);
+
+	mPoints.permute(order, pool);
+	mGridIndex.remap(order);
+	if(!mQuadtreeIndex.nodes().empty())
+	{
+		mQuadtreeIndex.remap(order);
+	}
+
+	mRecordOrder = false;
+	mCurve = theCurve;
+}
+
+bool LidarDataset::loadAttributes(unsigned int theAttributes, unsigned int theThreads)
+{
+	unsigned int missing = theAttributes & ~mPoints.attributes();
+	if(missing == 0)
+	{
+		return true;
+	}
+
+	if(!mRecordOrder)
+	{
+		std::cerr << "Info: Points are not in the order of records of " << mSource
+			<< ", attributes have to be requested when loading." << std::endl;
+		return false;
+	}
+
+	LasReader lasReader;
+	if(!lasReader.open(mSource) || !lasReader.supported() 
+		|| lasReader.header().numberOfPoints != mPoints.size())
+	{
+		std::cerr << "Info: Cannot read attributes from " << mSource << std::endl;
+		return false;
+	}
+
+	mPoints.setAttributes(mPoints.attributes() | (missing & lasReader.attributes()));
+
+	util::ThreadPool pool(theThreads);
+	lasReader.readAttributes(pool, mPoints);
+
+	return mPoints.hasAttributes(theAttributes & (mPoints.attributes() | lasReader.attributes()));
+}
+
+bool LidarDataset::saveAs(const std::string& theDestination, const SaveOptions& theOptions) const
 {
 	bool result = false;
 
@@ -219,28 +417,62 @@ bool LidarDataset::saveAs(const std::string& theDestination) const
 		{
 			try
 			{
-				std::ofstream ofs;
-				liblas::Create(ofs, theDestination);
-				// Create LAS header (version 1.2) from LidarMetadata
-				liblas::Header lasHeader;
-				lasHeader.SetCompressed(false);
-				mMetadata.populateLasHeader(lasHeader);
-
-				liblas::Writer writer(ofs, lasHeader);
-
-				std::vector<LidarPoint>::const_iterator it;
-				for(it = mPoints.begin(); it != mPoints.end(); ++it)
+				LasWriter writer;
+				if(writer.open(theDestination))
 				{
-					// Create LAS point (format 3) and populate 
-					// with values from LidarPoint 
-					liblas::Point lasPoint; 
-					(*it).populateLasPoint(lasPoint);
-					writer.WritePoint(lasPoint);
+					util::ThreadPool pool(theOptions.threads);
+
+					// Fields that are not loaded come from records of source
+					LasReader source;
+					if(mRecordOrder && source.open(mSource) 
+						&& source.header().numberOfPoints == mPoints.size())
+					{
+						writer.copyFieldsFrom(&source);
+					}
+
+					if(theOptions.order == SaveOptions::ORIGINAL)
+					{
+						writer.write(mMetadata, mPoints, pool);
+					}
+					else
+					{
+						std::vector<uint32_t> order;
+						spatialOrder(theOptions.order == SaveOptions::HILBERT ? util::HILBERT : util::MORTON, pool, order);
+
+						// Bounds of chunks of output records
+						const unsigned long chunkSize = std::max(theOptions.chunkSize, 1UL);
+						std::vector<ChunkSummary> chunks((order.size() + chunkSize - 1) / chunkSize);
+						pool.run(static_cast<unsigned int>(chunks.size()), [&](unsigned int i)
+						{
+							ChunkSummary& chunk = chunks[i];
+							chunk.first = i * chunkSize;
+							chunk.count = std::min(chunkSize, static_cast<unsigned long>(order.size()) - chunk.first);
+							for(unsigned long j = chunk.first; j < chunk.first + chunk.count; ++j)
+							{
+								wykobi::point3d<long> coords = mPoints.coords(order[j]);
+								chunk.min[0] = std::min(chunk.min[0], coords.x);
+								chunk.min[1] = std::min(chunk.min[1], coords.y);
+								chunk.min[2] = std::min(chunk.min[2], coords.z);
+								chunk.max[0] = std::max(chunk.max[0], coords.x);
+								chunk.max[1] = std::max(chunk.max[1], coords.y);
+								chunk.max[2] = std::max(chunk.max[2], coords.z);
+							}
+						});
+
+						std::vector<las::VariableLengthRecord> vlrs;
+						ChunkTable::encode(chunks, vlrs);
+
+						writer.write(mMetadata, mPoints, order, vlrs, pool);
+					}
+
+					writer.close();
+
+					result = true;
+				}
+				else
+				{
+					std::cerr << "Error: Cannot create file " << theDestination << std::endl;
 				}
-				
-				result = true;
-				
-				ofs.close();
 			}
 			catch (const std::exception& e)
 			{
@@ -261,49 +493,75 @@ bool LidarDataset::saveAs(const std::string& theDestination) const
 
 }
 
-double LidarDataset::estimateDensity() const
+void LidarDataset::spatialOrder(util::Curve theCurve, util::ThreadPool& thePool, std::vector<uint32_t>& theOrder) const
 {
-	std::map<unsigned int, unsigned int> histogram;
-	std::map<unsigned int, unsigned int>::iterator histogramIt;
-
-	for(std::vector< GridIndex::Cell >::const_iterator cellsIt = mGridIndex.cells()->begin(); cellsIt != mGridIndex.cells()->end(); ++cellsIt)
+	const mydefs::BoundingBox& bb = mMetadata.boundingBox();
+	const double side = (1u << util::CURVE_BITS) - 1;
+	const double scaleX = bb[1].x > bb[0].x ? side / (bb[1].x - bb[0].x) : 0;
+	const double scaleY = bb[1].y > bb[0].y ? side / (bb[1].y - bb[0].y) : 0;
+
+	// Code in upper and index in lower half, so sorting keys
+	// keeps points of the same cell in their original order
+	std::vector<uint64_t> keys(mPoints.size());
+	const std::size_t blockSize = 1 << 16;
+	const std::size_t numberOfBlocks = (keys.size() + blockSize - 1) / blockSize;
+
+	thePool.run(static_cast<unsigned int>(numberOfBlocks), [&](unsigned int block)
 	{
-		if( !(*cellsIt).empty() )
+		std::size_t first = block * blockSize;
+		std::size_t count = std::min(keys.size(), first + blockSize) - first;
+		std::vector<double> xs(count);
+		std::vector<double> ys(count);
+		mPoints.realCoords(first, count, &xs[0], &ys[0], 0);
+		for(std::size_t j = 0; j < count; ++j)
 		{
-			histogramIt = histogram.find((*cellsIt).size());
-			
-			if(histogramIt == histogram.end())
-			{
-				histogram[(*cellsIt).size()] = 1;
-			}
-			else
-			{
-				histogramIt->second++;
-			}
+			double column = std::min(side, std::max(0.0, (xs[j] - bb[0].x) * scaleX));
+			double row = std::min(side, std::max(0.0, (ys[j] - bb[0].y) * scaleY));
+			uint32_t code = util::curveCode(theCurve, static_cast<uint32_t>(column), static_cast<uint32_t>(row));
+			keys[first + j] = (static_cast<uint64_t>(code) << 32) | (first + j);
 		}
-	}	
+	});
 
-	double area = 0;
-	double cellArea = mGridIndex.cellSize() * mGridIndex.cellSize();
-	unsigned int numberOfPoints = 0;
-	for(histogramIt = histogram.begin(); histogramIt != histogram.end(); ++histogramIt)
+	util::radixSort(keys, 32, 32 + 2 * util::CURVE_BITS, thePool);
+
+	theOrder.resize(keys.size());
+	for(std::size_t i = 0; i < keys.size(); ++i)
 	{
-		area += histogramIt->second * cellArea;
-		numberOfPoints += histogramIt->first * histogramIt->second;
+		theOrder[i] = static_cast<uint32_t>(keys[i]);
 	}
+}
+
+double LidarDataset::estimateDensity() const
+{
+	// Index of lowest points has no cell sizes, so density is
+	// number of points divided by area of occupied cells
+	unsigned int occupiedCells = 0;
+	for(unsigned int i = 0; i < mGridIndex.rows() * mGridIndex.columns(); ++i)
+	{
+		if(mGridIndex.lowest(i) != PointCloud::NO_POINT)
+		{
+			++occupiedCells;
+		}
+	}
+
+	double cellArea = mGridIndex.cellSize() * mGridIndex.cellSize();
 
-	return double(numberOfPoints) / area;
+	return double(mGridIndex.numberOfPoints()) / (occupiedCells * cellArea);
 }
 
 unsigned int LidarDataset::classifyGround(double blockSize, 
 										  double angleTreshold,
 										  double distanceTreshold, 
-										  double edgeLengthTreshold)
+										  double edgeLengthTreshold,
+										  unsigned int theThreads,
+										  const std::string& theGroundPath)
 {
 	terrace::lidar::classification::GroundClassifier classifier(*this,  
 																angleTreshold, 
 																distanceTreshold, 
-																edgeLengthTreshold);
+																edgeLengthTreshold,
+																theThreads,
+																theGroundPath);
 	return classifier.classify();
 }
 
@@ -28,6 +28,15 @@ void LidarMetadata::setFromLasHeader(const liblas::Header& theHdr)
 		theHdr.GetScaleZ());
 }
 
+void LidarMetadata::setFromLasHeader(const las::Header& theHdr)
+{
+	mNumberOfPoints = theHdr.numberOfPoints; 
+	mBoundingBox = wykobi::make_box(theHdr.min[0], theHdr.min[1], theHdr.min[2], 
+		theHdr.max[0], theHdr.max[1], theHdr.max[2]);
+	mOffsets = wykobi::make_vector(theHdr.offset[0], theHdr.offset[1], theHdr.offset[2]);
+	mScales = wykobi::make_vector(theHdr.scale[0], theHdr.scale[1], theHdr.scale[2]);
+}
+
 void LidarMetadata::populateLasHeader(liblas::Header& theHdr) const
 {
 	try
@@ -48,5 +57,24 @@ void LidarMetadata::populateLasHeader(liblas::Header& theHdr) const
 	}
 }
 
+void LidarMetadata::populateLasHeader(las::Header& theHdr) const
+{
+	theHdr.pointDataFormat = las::OUTPUT_FORMAT;
+	theHdr.pointDataRecordLength = static_cast<uint16_t>(las::recordLength(las::OUTPUT_FORMAT));
+	theHdr.numberOfPoints = mNumberOfPoints;
+	theHdr.min[0] = mBoundingBox[0].x;
+	theHdr.min[1] = mBoundingBox[0].y;
+	theHdr.min[2] = mBoundingBox[0].z;
+	theHdr.max[0] = mBoundingBox[1].x;
+	theHdr.max[1] = mBoundingBox[1].y;
+	theHdr.max[2] = mBoundingBox[1].z;
+	theHdr.offset[0] = mOffsets.x;
+	theHdr.offset[1] = mOffsets.y;
+	theHdr.offset[2] = mOffsets.z;
+	theHdr.scale[0] = mScales.x;
+	theHdr.scale[1] = mScales.y;
+	theHdr.scale[2] = mScales.z;
+}
+
 }
 } // namespace terrace::lidar
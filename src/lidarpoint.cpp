@@ -19,40 +19,47 @@ namespace lidar
 
 void LidarPoint::setFromRealCoords(wykobi::point3d<double> realPoint)
 {
-	if(realPoint.x >= mMetadata->offsets().x) 
+	const LidarMetadata& metadata = mCloud->metadata();
+	wykobi::point3d<long> coords;
+
+	if(realPoint.x >= metadata.offsets().x) 
 	{
-		mCoords.x = long((realPoint.x - mMetadata->offsets().x) / mMetadata->scales().x + 0.5);
+		coords.x = long((realPoint.x - metadata.offsets().x) / metadata.scales().x + 0.5);
 	}
 	else
 	{
-		mCoords.x = long((realPoint.x - mMetadata->offsets().x) / mMetadata->scales().x - 0.5);
+		coords.x = long((realPoint.x - metadata.offsets().x) / metadata.scales().x - 0.5);
 	}
 	
-	if(realPoint.y >= mMetadata->offsets().y) 
+	if(realPoint.y >= metadata.offsets().y) 
 	{
-		mCoords.y = long((realPoint.y - mMetadata->offsets().y) / mMetadata->scales().y + 0.5);
+		coords.y = long((realPoint.y - metadata.offsets().y) / metadata.scales().y + 0.5);
 	}
 	else
 	{
-		mCoords.y = long((realPoint.y - mMetadata->offsets().y) / mMetadata->scales().y - 0.5);
+		coords.y = long((realPoint.y - metadata.offsets().y) / metadata.scales().y - 0.5);
 	}
 
-	if(realPoint.z >= mMetadata->offsets().z) 
+	if(realPoint.z >= metadata.offsets().z) 
 	{
-		mCoords.z = long((realPoint.z - mMetadata->offsets().z) / mMetadata->scales().z + 0.5);
+		coords.z = long((realPoint.z - metadata.offsets().z) / metadata.scales().z + 0.5);
 	}
 	else
 	{
-		mCoords.z = long((realPoint.z - mMetadata->offsets().z) / mMetadata->scales().z - 0.5);
+		coords.z = long((realPoint.z - metadata.offsets().z) / metadata.scales().z - 0.5);
 	}
+
+	mCloud->set(mIndex, static_cast<int32_t>(coords.x), static_cast<int32_t>(coords.y), 
+		static_cast<int32_t>(coords.z), classification());
 }
 
 void LidarPoint::populateLasPoint(liblas::Point& lasPoint) const
 {
-	lasPoint.SetRawX(mCoords.x);
-	lasPoint.SetRawY(mCoords.y);
-	lasPoint.SetRawZ(mCoords.z);
-	lasPoint.SetClassification(mCls);
+	wykobi::point3d<long> coords = mCloud->coords(mIndex);
+	lasPoint.SetRawX(coords.x);
+	lasPoint.SetRawY(coords.y);
+	lasPoint.SetRawZ(coords.z);
+	lasPoint.SetClassification(classification());
 }
 
 }
@@ -0,0 +1,155 @@
+/******************************************************************************
+ * mappedfile.cpp
+ *
+ *
+ ******************************************************************************
+ * Copyright (c) 2014, Vladimir Pajic
+ *
+ *****************************************************************************/
+
+///////////////////////////////////////////////////////////////////////////////
+// Included dependacies
+
+#include "mappedfile.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace terrace
+{
+namespace util
+{
+
+#ifdef _WIN32
+
+MappedFile::MappedFile() : mData(0), mSize(0), mFile(INVALID_HANDLE_VALUE), mMapping(0)
+{
+}
+
+bool MappedFile::open(const std::string& thePath)
+{
+	close();
+
+	mFile = CreateFileA(thePath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+		OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if(mFile == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if(!GetFileSizeEx(mFile, &fileSize) || fileSize.QuadPart == 0)
+	{
+		close();
+		return false;
+	}
+
+	mMapping = CreateFileMappingA(mFile, NULL, PAGE_READONLY, 0, 0, NULL);
+	if(mMapping == 0)
+	{
+		close();
+		return false;
+	}
+
+	mData = static_cast<const char*>(MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0));
+	if(mData == 0)
+	{
+		close();
+		return false;
+	}
+
+	mSize = static_cast<std::size_t>(fileSize.QuadPart);
+
+	return true;
+}
+
+void MappedFile::close()
+{
+	if(mData != 0)
+	{
+		UnmapViewOfFile(mData);
+		mData = 0;
+	}
+	if(mMapping != 0)
+	{
+		CloseHandle(mMapping);
+		mMapping = 0;
+	}
+	if(mFile != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(mFile);
+		mFile = INVALID_HANDLE_VALUE;
+	}
+	mSize = 0;
+}
+
+#else
+
+MappedFile::MappedFile() : mData(0), mSize(0), mFd(-1)
+{
+}
+
+bool MappedFile::open(const std::string& thePath)
+{
+	close();
+
+	mFd = ::open(thePath.c_str(), O_RDONLY);
+	if(mFd < 0)
+	{
+		return false;
+	}
+
+	struct stat fileStat;
+	if(fstat(mFd, &fileStat) != 0 || fileStat.st_size == 0)
+	{
+		close();
+		return false;
+	}
+
+	void* data = mmap(0, static_cast<std::size_t>(fileStat.st_size), PROT_READ, MAP_SHARED, mFd, 0);
+	if(data == MAP_FAILED)
+	{
+		close();
+		return false;
+	}
+
+	// Records are decoded front to back
+	madvise(data, static_cast<std::size_t>(fileStat.st_size), MADV_SEQUENTIAL);
+
+	mData = static_cast<const char*>(data);
+	mSize = static_cast<std::size_t>(fileStat.st_size);
+
+	return true;
+}
+
+void MappedFile::close()
+{
+	if(mData != 0)
+	{
+		munmap(const_cast<char*>(mData), mSize);
+		mData = 0;
+	}
+	if(mFd >= 0)
+	{
+		::close(mFd);
+		mFd = -1;
+	}
+	mSize = 0;
+}
+
+#endif
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+}
+} // namespace terrace::util
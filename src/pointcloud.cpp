@@ -0,0 +1,281 @@
+/******************************************************************************
+ * pointcloud.cpp
+ *
+ *
+ ******************************************************************************
+ * Copyright (c) 2014, Vladimir Pajic
+ *
+ *****************************************************************************/
+
+///////////////////////////////////////////////////////////////////////////////
+// Included dependacies
+
+#include "pointcloud.hpp"
+#include "dequantize.hpp"
+#include "threadpool.hpp"
+
+#include <algorithm>
+
+namespace terrace
+{
+namespace lidar
+{
+
+namespace
+{
+
+/// Gathers column into new order. theWidth values belong to one point.
+template <typename T>
+void permuteColumn(std::vector<T>& theColumn, const std::vector<uint32_t>& theOrder, 
+				   std::size_t theWidth, util::ThreadPool& thePool)
+{
+	if(theColumn.empty())
+	{
+		return;
+	}
+
+	std::vector<T> permuted(theColumn.size());
+	const std::size_t blockSize = 1 << 16;
+	const std::size_t numberOfBlocks = (theOrder.size() + blockSize - 1) / blockSize;
+
+	thePool.run(static_cast<unsigned int>(numberOfBlocks), [&](unsigned int block)
+	{
+		std::size_t end = std::min(theOrder.size(), (block + 1) * blockSize);
+		for(std::size_t i = block * blockSize; i < end; ++i)
+		{
+			for(std::size_t j = 0; j < theWidth; ++j)
+			{
+				permuted[i * theWidth + j] = theColumn[theOrder[i] * theWidth + j];
+			}
+		}
+	});
+
+	theColumn.swap(permuted);
+}
+
+} // anonymous namespace
+
+const unsigned int PointCloud::ALL_ATTRIBUTES;
+const std::size_t PointCloud::COORDS_BLOCK;
+const uint32_t PointCloud::NO_POINT;
+
+void PointCloud::clear()
+{
+	mX.clear();
+	mY.clear();
+	mZ.clear();
+	mClassification.clear();
+	resizeAttributes(0);
+}
+
+void PointCloud::reserve(std::size_t theSize)
+{
+	mX.reserve(theSize);
+	mY.reserve(theSize);
+	mZ.reserve(theSize);
+	mClassification.reserve(theSize);
+	if(mAttributes & INTENSITY)
+	{
+		mIntensity.reserve(theSize);
+	}
+	if(mAttributes & RETURNS)
+	{
+		mReturns.reserve(theSize);
+	}
+	if(mAttributes & GPS_TIME)
+	{
+		mGpsTime.reserve(theSize);
+	}
+	if(mAttributes & RGB)
+	{
+		mRgb.reserve(3 * theSize);
+	}
+}
+
+void PointCloud::resize(std::size_t theSize)
+{
+	mX.resize(theSize, 0);
+	mY.resize(theSize, 0);
+	mZ.resize(theSize, 0);
+	mClassification.resize(theSize, 0);
+	resizeAttributes(theSize);
+}
+
+void PointCloud::release()
+{
+	std::vector<int32_t>().swap(mX);
+	std::vector<int32_t>().swap(mY);
+	std::vector<int32_t>().swap(mZ);
+	std::vector<unsigned char>().swap(mClassification);
+	std::vector<uint16_t>().swap(mIntensity);
+	std::vector<unsigned char>().swap(mReturns);
+	std::vector<double>().swap(mGpsTime);
+	std::vector<uint16_t>().swap(mRgb);
+}
+
+void PointCloud::append(const PointCloud& theOther)
+{
+	mX.insert(mX.end(), theOther.mX.begin(), theOther.mX.end());
+	mY.insert(mY.end(), theOther.mY.begin(), theOther.mY.end());
+	mZ.insert(mZ.end(), theOther.mZ.begin(), theOther.mZ.end());
+	mClassification.insert(mClassification.end(), theOther.mClassification.begin(), theOther.mClassification.end());
+
+	if(mAttributes == 0)
+	{
+		return;
+	}
+
+	std::size_t first = mX.size() - theOther.size();
+	resizeAttributes(mX.size());
+	if(mAttributes & theOther.mAttributes & INTENSITY)
+	{
+		std::copy(theOther.mIntensity.begin(), theOther.mIntensity.end(), mIntensity.begin() + first);
+	}
+	if(mAttributes & theOther.mAttributes & RETURNS)
+	{
+		std::copy(theOther.mReturns.begin(), theOther.mReturns.end(), mReturns.begin() + first);
+	}
+	if(mAttributes & theOther.mAttributes & GPS_TIME)
+	{
+		std::copy(theOther.mGpsTime.begin(), theOther.mGpsTime.end(), mGpsTime.begin() + first);
+	}
+	if(mAttributes & theOther.mAttributes & RGB)
+	{
+		std::copy(theOther.mRgb.begin(), theOther.mRgb.end(), mRgb.begin() + 3 * first);
+	}
+}
+
+void PointCloud::assign(const PointCloud& theOther, const std::vector<uint32_t>& theIndices)
+{
+	// Attributes that are not copied stay zero
+	const std::size_t size = theIndices.size();
+	clear();
+	resize(size);
+
+	const unsigned int copied = mAttributes & theOther.mAttributes;
+	for(std::size_t i = 0; i < size; ++i)
+	{
+		const uint32_t j = theIndices[i];
+		mX[i] = theOther.mX[j];
+		mY[i] = theOther.mY[j];
+		mZ[i] = theOther.mZ[j];
+		mClassification[i] = theOther.mClassification[j];
+
+		if(copied & INTENSITY)
+		{
+			mIntensity[i] = theOther.mIntensity[j];
+		}
+		if(copied & RETURNS)
+		{
+			mReturns[i] = theOther.mReturns[j];
+		}
+		if(copied & GPS_TIME)
+		{
+			mGpsTime[i] = theOther.mGpsTime[j];
+		}
+		if(copied & RGB)
+		{
+			std::copy(&theOther.mRgb[3 * j], &theOther.mRgb[3 * j] + 3, &mRgb[3 * i]);
+		}
+	}
+}
+
+void PointCloud::permute(const std::vector<uint32_t>& theOrder, util::ThreadPool& thePool)
+{
+	// One column at a time, so only one extra column is allocated
+	permuteColumn(mX, theOrder, 1, thePool);
+	permuteColumn(mY, theOrder, 1, thePool);
+	permuteColumn(mZ, theOrder, 1, thePool);
+	permuteColumn(mClassification, theOrder, 1, thePool);
+	permuteColumn(mIntensity, theOrder, 1, thePool);
+	permuteColumn(mReturns, theOrder, 1, thePool);
+	permuteColumn(mGpsTime, theOrder, 1, thePool);
+	permuteColumn(mRgb, theOrder, 3, thePool);
+}
+
+void PointCloud::setAttributes(unsigned int theMask)
+{
+	unsigned int removed = mAttributes & ~theMask;
+	if(removed & INTENSITY)
+	{
+		std::vector<uint16_t>().swap(mIntensity);
+	}
+	if(removed & RETURNS)
+	{
+		std::vector<unsigned char>().swap(mReturns);
+	}
+	if(removed & GPS_TIME)
+	{
+		std::vector<double>().swap(mGpsTime);
+	}
+	if(removed & RGB)
+	{
+		std::vector<uint16_t>().swap(mRgb);
+	}
+
+	mAttributes = theMask & ALL_ATTRIBUTES;
+	resizeAttributes(mX.size());
+}
+
+void PointCloud::resizeAttributes(std::size_t theSize)
+{
+	if(mAttributes & INTENSITY)
+	{
+		mIntensity.resize(theSize, 0);
+	}
+	if(mAttributes & RETURNS)
+	{
+		mReturns.resize(theSize, 0);
+	}
+	if(mAttributes & GPS_TIME)
+	{
+		mGpsTime.resize(theSize, 0.0);
+	}
+	if(mAttributes & RGB)
+	{
+		mRgb.resize(3 * theSize, 0);
+	}
+}
+
+void PointCloud::realCoords(std::size_t theFirst, std::size_t theCount,
+							double* theX, double* theY, double* theZ) const
+{
+	const wykobi::vector3d<double>& scales = mMetadata->scales();
+	const wykobi::vector3d<double>& offsets = mMetadata->offsets();
+
+	if(theX != 0)
+	{
+		util::dequantize(xData() + theFirst, theCount, scales.x, offsets.x, theX);
+	}
+	if(theY != 0)
+	{
+		util::dequantize(yData() + theFirst, theCount, scales.y, offsets.y, theY);
+	}
+	if(theZ != 0)
+	{
+		util::dequantize(zData() + theFirst, theCount, scales.z, offsets.z, theZ);
+	}
+}
+
+void PointCloud::localCoords(std::size_t theFirst, std::size_t theCount, const wykobi::point3d<double>& theOrigin,
+							 float* theX, float* theY, float* theZ) const
+{
+	const wykobi::vector3d<double>& scales = mMetadata->scales();
+	const wykobi::vector3d<double>& offsets = mMetadata->offsets();
+
+	if(theX != 0)
+	{
+		util::dequantize(xData() + theFirst, theCount, scales.x, offsets.x - theOrigin.x, theX);
+	}
+	if(theY != 0)
+	{
+		util::dequantize(yData() + theFirst, theCount, scales.y, offsets.y - theOrigin.y, theY);
+	}
+	if(theZ != 0)
+	{
+		util::dequantize(zData() + theFirst, theCount, scales.z, offsets.z - theOrigin.z, theZ);
+	}
+}
+
+}
+} // namespace terrace::lidar
@@ -0,0 +1,583 @@
+/******************************************************************************
+ * quadtreeindex.cpp
+ *
+ *
+ ******************************************************************************
+ * Copyright (c) 2014, Vladimir Pajic
+ *
+ *****************************************************************************/
+
+///////////////////////////////////////////////////////////////////////////////
+// Included dependacies
+
+#include "quadtreeindex.hpp"
+#include "lidarmetadata.hpp"
+#include "radixsort.hpp"
+#include "threadpool.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+
+namespace terrace
+{
+namespace lidar
+{
+
+namespace
+{
+
+/// Number of columns (and rows) of grid of the deepest level
+const uint32_t SIDE = 1u << QuadtreeIndex::MAX_DEPTH;
+
+/// Column or row of coordinate offset from corner of root
+inline uint32_t gridCell(double theOffset, double theCellSize)
+{
+	double cell = std::floor(theOffset / theCellSize);
+	if(cell < 0)
+	{
+		return 0;
+	}
+	if(cell >= SIDE)
+	{
+		return SIDE - 1;
+	}
+	return static_cast<uint32_t>(cell);
+}
+
+/// Inserts point into neighbours ordered by distance if it is closer
+/// than the farthest of theK neighbours, which then drops out
+inline void addNeighbour(uint32_t thePoint, double theSquaredDistance, unsigned int theK,
+						 unsigned int& theFound, uint32_t* theIndices, double* theSquaredDistances)
+{
+	if(theFound == theK)
+	{
+		if(theSquaredDistance >= theSquaredDistances[theK - 1])
+		{
+			return;
+		}
+	}
+	else
+	{
+		++theFound;
+	}
+
+	unsigned int j = theFound - 1;
+	for( ; j > 0 && theSquaredDistances[j - 1] > theSquaredDistance; --j)
+	{
+		theSquaredDistances[j] = theSquaredDistances[j - 1];
+		theIndices[j] = theIndices[j - 1];
+	}
+	theSquaredDistances[j] = theSquaredDistance;
+	theIndices[j] = thePoint;
+}
+
+/// Runs theQuery(i, found) for every query in parallel blocks and
+/// concatenates found points by query. Blocks collect their points
+/// first, so result is filled once counts of all queries are known.
+void collectBatch(std::size_t theCount,
+				  util::ThreadPool& thePool,
+				  const std::function<void(std::size_t, std::vector<uint32_t>&)>& theQuery,
+				  std::vector<uint32_t>& theResult,
+				  std::vector<std::size_t>& theOffsets)
+{
+	theOffsets.assign(theCount + 1, 0);
+	theResult.clear();
+	if(theCount == 0)
+	{
+		return;
+	}
+
+	// Small blocks are handed out one at a time, so threads stay balanced
+	const std::size_t blockSize = 1024;
+	const unsigned int numberOfBlocks = static_cast<unsigned int>((theCount + blockSize - 1) / blockSize);
+	std::vector< std::vector<uint32_t> > blockResults(numberOfBlocks);
+
+	thePool.run(numberOfBlocks, [&](unsigned int block)
+	{
+		std::vector<uint32_t> found;
+		std::vector<uint32_t>& blockResult = blockResults[block];
+		std::size_t end = std::min(theCount, (block + 1) * blockSize);
+		for(std::size_t i = block * blockSize; i < end; ++i)
+		{
+			theQuery(i, found);
+			blockResult.insert(blockResult.end(), found.begin(), found.end());
+			theOffsets[i + 1] = found.size();
+		}
+	});
+
+	// Counts become offsets
+	for(std::size_t i = 0; i < theCount; ++i)
+	{
+		theOffsets[i + 1] += theOffsets[i];
+	}
+
+	theResult.resize(theOffsets[theCount]);
+	thePool.run(numberOfBlocks, [&](unsigned int block)
+	{
+		const std::vector<uint32_t>& blockResult = blockResults[block];
+		std::copy(blockResult.begin(), blockResult.end(), theResult.begin() + theOffsets[block * blockSize]);
+	});
+}
+
+} // anonymous namespace
+
+const unsigned int QuadtreeIndex::MAX_DEPTH;
+const unsigned int QuadtreeIndex::STACK_SIZE;
+
+QuadtreeIndex::QuadtreeIndex() : mMinX(0.0), mMinY(0.0), mCellSize(1.0), mNodes(), mIndices()
+{
+}
+
+void QuadtreeIndex::create(const LidarMetadata& theMetadata,
+						   const PointCloud& thePoints,
+						   util::ThreadPool& thePool,
+						   unsigned int theLeafCapacity)
+{
+	const mydefs::BoundingBox& bb = theMetadata.boundingBox();
+	mMinX = bb[0].x;
+	mMinY = bb[0].y;
+	double side = std::max(bb[1].x - bb[0].x, bb[1].y - bb[0].y);
+	mCellSize = side > 0 ? side / SIDE : 1.0;
+
+	// Morton code in upper and index in lower half, so sorting keys
+	// keeps points of the same grid cell in their original order
+	std::vector<uint64_t> keys(thePoints.size());
+	const std::size_t blockSize = 1 << 16;
+	const std::size_t numberOfBlocks = (keys.size() + blockSize - 1) / blockSize;
+
+	thePool.run(static_cast<unsigned int>(numberOfBlocks), [&](unsigned int block)
+	{
+		std::size_t first = block * blockSize;
+		std::size_t count = std::min(keys.size(), first + blockSize) - first;
+		std::vector<double> xs(count);
+		std::vector<double> ys(count);
+		thePoints.realCoords(first, count, &xs[0], &ys[0], 0);
+		for(std::size_t j = 0; j < count; ++j)
+		{
+			uint32_t code = util::mortonCode(gridCell(xs[j] - mMinX, mCellSize), gridCell(ys[j] - mMinY, mCellSize));
+			keys[first + j] = (static_cast<uint64_t>(code) << 32) | (first + j);
+		}
+	});
+
+	util::radixSort(keys, 32, 32 + 2 * MAX_DEPTH, thePool);
+
+	mIndices.resize(keys.size());
+	for(std::size_t i = 0; i < keys.size(); ++i)
+	{
+		mIndices[i] = static_cast<uint32_t>(keys[i]);
+	}
+
+	mNodes.clear();
+	Node root = { 0, static_cast<uint32_t>(keys.size()), 0 };
+	mNodes.push_back(root);
+	if(!keys.empty())
+	{
+		split(0, &keys[0], &keys[0] + keys.size(), 0, std::max(1u, theLeafCapacity));
+	}
+}
+
+void QuadtreeIndex::split(uint32_t theNode, const uint64_t* theBegin, const uint64_t* theEnd,
+						  unsigned int theDepth, unsigned int theLeafCapacity)
+{
+	if(static_cast<std::size_t>(theEnd - theBegin) <= theLeafCapacity || theDepth == MAX_DEPTH)
+	{
+		return;
+	}
+
+	// Codes of node share higher bits, the next two bits select child
+	const unsigned int shift = 32 + 2 * (MAX_DEPTH - 1 - theDepth);
+	const uint32_t children = static_cast<uint32_t>(mNodes.size());
+	mNodes[theNode].children = children;
+
+	const uint64_t* childBegin = theBegin;
+	for(uint32_t q = 0; q < 4; ++q)
+	{
+		const uint64_t* childEnd = std::partition_point(childBegin, theEnd, [&](uint64_t theKey)
+		{
+			return ((theKey >> shift) & 3) <= q;
+		});
+		Node child = { mNodes[theNode].first + static_cast<uint32_t>(childBegin - theBegin),
+					   static_cast<uint32_t>(childEnd - childBegin), 0 };
+		mNodes.push_back(child);
+		childBegin = childEnd;
+	}
+
+	childBegin = theBegin;
+	for(uint32_t q = 0; q < 4; ++q)
+	{
+		const uint64_t* childEnd = childBegin + mNodes[children + q].count;
+		split(children + q, childBegin, childEnd, theDepth + 1, theLeafCapacity);
+		childBegin = childEnd;
+	}
+}
+
+void QuadtreeIndex::remap(const std::vector<uint32_t>& theOrder)
+{
+	// New position of every point of previous order
+	std::vector<uint32_t> positions(theOrder.size());
+	for(std::size_t i = 0; i < theOrder.size(); ++i)
+	{
+		positions[theOrder[i]] = static_cast<uint32_t>(i);
+	}
+
+	for(std::vector<uint32_t>::iterator it = mIndices.begin(); it != mIndices.end(); ++it)
+	{
+		*it = positions[*it];
+	}
+}
+
+std::size_t QuadtreeIndex::numberOfLeaves() const
+{
+	std::size_t leaves = 0;
+	for(std::vector<Node>::const_iterator it = mNodes.begin(); it != mNodes.end(); ++it)
+	{
+		if((*it).children == 0 && (*it).count != 0)
+		{
+			++leaves;
+		}
+	}
+	return leaves;
+}
+
+unsigned int QuadtreeIndex::depth() const
+{
+	unsigned int result = 0;
+	if(mNodes.empty())
+	{
+		return result;
+	}
+
+	Visit stack[STACK_SIZE];
+	unsigned int size = 0;
+	Visit root = { 0, 0, 0, 0 };
+	stack[size++] = root;
+	while(size > 0)
+	{
+		Visit visit = stack[--size];
+		result = std::max(result, visit.depth);
+		const Node& node = mNodes[visit.node];
+		if(node.children != 0)
+		{
+			for(uint32_t q = 0; q < 4; ++q)
+			{
+				Visit child = { node.children + q, 0, 0, visit.depth + 1 };
+				stack[size++] = child;
+			}
+		}
+	}
+	return result;
+}
+
+double QuadtreeIndex::squaredGap(double theX, double theY, const Visit& theVisit) const
+{
+	const double size = double(SIDE >> theVisit.depth) * mCellSize;
+	const double minX = mMinX + theVisit.column * mCellSize;
+	const double minY = mMinY + theVisit.row * mCellSize;
+	double dx = theX < minX ? minX - theX : (theX > minX + size ? theX - minX - size : 0.0);
+	double dy = theY < minY ? minY - theY : (theY > minY + size ? theY - minY - size : 0.0);
+	return dx * dx + dy * dy;
+}
+
+std::size_t QuadtreeIndex::box(const PointCloud& thePoints,
+							   const BoundingRectangle& theBox,
+							   std::vector<uint32_t>& theResult) const
+{
+	theResult.clear();
+	if(mNodes.empty() || mNodes[0].count == 0)
+	{
+		return 0;
+	}
+
+	const wykobi::vector3d<double>& scales = thePoints.metadata().scales();
+	const wykobi::vector3d<double>& offsets = thePoints.metadata().offsets();
+
+	// Box in columns and rows of the deepest level. Points of columns
+	// strictly between those of box borders lie inside of box.
+	const double c0 = std::floor((theBox[0].x - mMinX) / mCellSize);
+	const double c1 = std::floor((theBox[1].x - mMinX) / mCellSize);
+	const double r0 = std::floor((theBox[0].y - mMinY) / mCellSize);
+	const double r1 = std::floor((theBox[1].y - mMinY) / mCellSize);
+
+	Visit stack[STACK_SIZE];
+	unsigned int size = 0;
+	Visit root = { 0, 0, 0, 0 };
+	stack[size++] = root;
+	while(size > 0)
+	{
+		Visit visit = stack[--size];
+		const Node& node = mNodes[visit.node];
+		if(node.count == 0)
+		{
+			continue;
+		}
+
+		// Columns and rows [first, last] of node. Border columns also
+		// hold points clamped to the grid, so they are widened.
+		const uint32_t span = SIDE >> visit.depth;
+		const double firstColumn = visit.column == 0 ? -std::numeric_limits<double>::infinity() : visit.column;
+		const double lastColumn = visit.column + span == SIDE ? std::numeric_limits<double>::infinity() : visit.column + span - 1;
+		const double firstRow = visit.row == 0 ? -std::numeric_limits<double>::infinity() : visit.row;
+		const double lastRow = visit.row + span == SIDE ? std::numeric_limits<double>::infinity() : visit.row + span - 1;
+
+		if(lastColumn < c0 || firstColumn > c1 || lastRow < r0 || firstRow > r1)
+		{
+			continue;
+		}
+
+		if(firstColumn > c0 && lastColumn < c1 && firstRow > r0 && lastRow < r1)
+		{
+			theResult.insert(theResult.end(), mIndices.begin() + node.first, mIndices.begin() + node.first + node.count);
+			continue;
+		}
+
+		if(node.children == 0)
+		{
+			for(uint32_t i = node.first; i < node.first + node.count; ++i)
+			{
+				uint32_t p = mIndices[i];
+				double x = thePoints.x(p) * scales.x + offsets.x;
+				double y = thePoints.y(p) * scales.y + offsets.y;
+				if(x >= theBox[0].x && x <= theBox[1].x && y >= theBox[0].y && y <= theBox[1].y)
+				{
+					theResult.push_back(p);
+				}
+			}
+			continue;
+		}
+
+		const uint32_t half = span / 2;
+		for(uint32_t q = 0; q < 4; ++q)
+		{
+			Visit child = { node.children + q, visit.column + (q & 1) * half, visit.row + (q >> 1) * half, visit.depth + 1 };
+			stack[size++] = child;
+		}
+	}
+
+	return theResult.size();
+}
+
+std::size_t QuadtreeIndex::radius(const PointCloud& thePoints,
+								  const wykobi::point3d<double>& theCenter,
+								  double theRadius,
+								  GridIndex::Distance theDistance,
+								  std::vector<uint32_t>& theResult) const
+{
+	theResult.clear();
+	if(mNodes.empty() || mNodes[0].count == 0 || theRadius < 0)
+	{
+		return 0;
+	}
+
+	const wykobi::vector3d<double>& scales = thePoints.metadata().scales();
+	const wykobi::vector3d<double>& offsets = thePoints.metadata().offsets();
+	const bool spatial = theDistance == GridIndex::SPATIAL;
+	const double squaredRadius = theRadius * theRadius;
+
+	Visit stack[STACK_SIZE];
+	unsigned int size = 0;
+	Visit root = { 0, 0, 0, 0 };
+	stack[size++] = root;
+	while(size > 0)
+	{
+		Visit visit = stack[--size];
+		const Node& node = mNodes[visit.node];
+		// Root also holds points clamped to its border, so it is not skipped
+		if(node.count == 0 || (visit.depth > 0 && squaredGap(theCenter.x, theCenter.y, visit) > squaredRadius))
+		{
+			continue;
+		}
+
+		if(node.children == 0)
+		{
+			for(uint32_t i = node.first; i < node.first + node.count; ++i)
+			{
+				uint32_t p = mIndices[i];
+				double dx = thePoints.x(p) * scales.x + offsets.x - theCenter.x;
+				double dy = thePoints.y(p) * scales.y + offsets.y - theCenter.y;
+				double squaredDistance = dx * dx + dy * dy;
+				if(spatial)
+				{
+					double dz = thePoints.z(p) * scales.z + offsets.z - theCenter.z;
+					squaredDistance += dz * dz;
+				}
+				if(squaredDistance <= squaredRadius)
+				{
+					theResult.push_back(p);
+				}
+			}
+			continue;
+		}
+
+		const uint32_t half = (SIDE >> visit.depth) / 2;
+		for(uint32_t q = 0; q < 4; ++q)
+		{
+			Visit child = { node.children + q, visit.column + (q & 1) * half, visit.row + (q >> 1) * half, visit.depth + 1 };
+			stack[size++] = child;
+		}
+	}
+
+	return theResult.size();
+}
+
+void QuadtreeIndex::box(const PointCloud& thePoints,
+						const std::vector<BoundingRectangle>& theBoxes,
+						util::ThreadPool& thePool,
+						std::vector<uint32_t>& theResult,
+						std::vector<std::size_t>& theOffsets) const
+{
+	collectBatch(theBoxes.size(), thePool, [&](std::size_t i, std::vector<uint32_t>& found)
+	{
+		box(thePoints, theBoxes[i], found);
+	}, theResult, theOffsets);
+}
+
+void QuadtreeIndex::radius(const PointCloud& thePoints,
+						   const std::vector< wykobi::point3d<double> >& theCenters,
+						   double theRadius,
+						   GridIndex::Distance theDistance,
+						   util::ThreadPool& thePool,
+						   std::vector<uint32_t>& theResult,
+						   std::vector<std::size_t>& theOffsets) const
+{
+	collectBatch(theCenters.size(), thePool, [&](std::size_t i, std::vector<uint32_t>& found)
+	{
+		radius(thePoints, theCenters[i], theRadius, theDistance, found);
+	}, theResult, theOffsets);
+}
+
+unsigned int QuadtreeIndex::nearest(const PointCloud& thePoints,
+									const wykobi::point3d<double>& theQuery,
+									unsigned int theK,
+									GridIndex::Distance theDistance,
+									std::vector<uint32_t>& theIndices,
+									std::vector<double>& theSquaredDistances) const
+{
+	theIndices.resize(theK);
+	theSquaredDistances.resize(theK);
+	unsigned int found = theK == 0 ? 0 : nearest(thePoints, theQuery, theK, theDistance,
+		&theIndices[0], &theSquaredDistances[0]);
+	theIndices.resize(found);
+	theSquaredDistances.resize(found);
+	return found;
+}
+
+void QuadtreeIndex::nearest(const PointCloud& thePoints,
+							const std::vector< wykobi::point3d<double> >& theQueries,
+							unsigned int theK,
+							GridIndex::Distance theDistance,
+							util::ThreadPool& thePool,
+							std::vector<uint32_t>& theIndices,
+							std::vector<double>& theSquaredDistances) const
+{
+	const std::size_t numberOfQueries = theQueries.size();
+	theIndices.resize(numberOfQueries * theK);
+	theSquaredDistances.resize(numberOfQueries * theK);
+	if(numberOfQueries == 0 || theK == 0)
+	{
+		return;
+	}
+
+	// Small blocks are handed out one at a time, so threads stay balanced
+	const std::size_t blockSize = 1024;
+	const unsigned int numberOfBlocks = static_cast<unsigned int>((numberOfQueries + blockSize - 1) / blockSize);
+
+	thePool.run(numberOfBlocks, [&](unsigned int block)
+	{
+		std::size_t end = std::min(numberOfQueries, (block + 1) * blockSize);
+		for(std::size_t i = block * blockSize; i < end; ++i)
+		{
+			uint32_t* indices = &theIndices[i * theK];
+			double* squaredDistances = &theSquaredDistances[i * theK];
+			unsigned int found = nearest(thePoints, theQueries[i], theK, theDistance, indices, squaredDistances);
+			std::fill(indices + found, indices + theK, PointCloud::NO_POINT);
+			std::fill(squaredDistances + found, squaredDistances + theK, std::numeric_limits<double>::infinity());
+		}
+	});
+}
+
+unsigned int QuadtreeIndex::nearest(const PointCloud& thePoints,
+									const wykobi::point3d<double>& theQuery,
+									unsigned int theK,
+									GridIndex::Distance theDistance,
+									uint32_t* theIndices,
+									double* theSquaredDistances) const
+{
+	unsigned int found = 0;
+	if(mNodes.empty())
+	{
+		return found;
+	}
+
+	const wykobi::vector3d<double>& scales = thePoints.metadata().scales();
+	const wykobi::vector3d<double>& offsets = thePoints.metadata().offsets();
+	const bool spatial = theDistance == GridIndex::SPATIAL;
+
+	Visit stack[STACK_SIZE];
+	unsigned int size = 0;
+	Visit root = { 0, 0, 0, 0 };
+	stack[size++] = root;
+	while(size > 0)
+	{
+		Visit visit = stack[--size];
+		const Node& node = mNodes[visit.node];
+		if(node.count == 0)
+		{
+			continue;
+		}
+		if(found == theK && visit.depth > 0
+			&& squaredGap(theQuery.x, theQuery.y, visit) >= theSquaredDistances[theK - 1])
+		{
+			continue;
+		}
+
+		if(node.children == 0)
+		{
+			for(uint32_t i = node.first; i < node.first + node.count; ++i)
+			{
+				uint32_t p = mIndices[i];
+				double dx = thePoints.x(p) * scales.x + offsets.x - theQuery.x;
+				double dy = thePoints.y(p) * scales.y + offsets.y - theQuery.y;
+				double squaredDistance = dx * dx + dy * dy;
+				if(spatial)
+				{
+					double dz = thePoints.z(p) * scales.z + offsets.z - theQuery.z;
+					squaredDistance += dz * dz;
+				}
+				addNeighbour(p, squaredDistance, theK, found, theIndices, theSquaredDistances);
+			}
+			continue;
+		}
+
+		// Children are pushed farthest first, so the nearest is visited first
+		const uint32_t half = (SIDE >> visit.depth) / 2;
+		Visit children[4];
+		double gaps[4];
+		for(uint32_t q = 0; q < 4; ++q)
+		{
+			Visit child = { node.children + q, visit.column + (q & 1) * half, visit.row + (q >> 1) * half, visit.depth + 1 };
+			children[q] = child;
+			gaps[q] = squaredGap(theQuery.x, theQuery.y, child);
+		}
+		for(unsigned int i = 0; i < 4; ++i)
+		{
+			unsigned int farthest = i;
+			for(unsigned int j = i + 1; j < 4; ++j)
+			{
+				if(gaps[j] > gaps[farthest])
+				{
+					farthest = j;
+				}
+			}
+			std::swap(gaps[i], gaps[farthest]);
+			std::swap(children[i], children[farthest]);
+			stack[size++] = children[i];
+		}
+	}
+
+	return found;
+}
+
+}
+} // namespace terrace::lidar
@@ -0,0 +1,105 @@
+/******************************************************************************
+ * radixsort.cpp
+ *
+ *
+ ******************************************************************************
+ * Copyright (c) 2014, Vladimir Pajic
+ *
+ *****************************************************************************/
+
+///////////////////////////////////////////////////////////////////////////////
+// Included dependacies
+
+#include "radixsort.hpp"
+
+#include <algorithm>
+
+namespace terrace
+{
+namespace util
+{
+
+void radixSort(std::vector<uint64_t>& theKeys, unsigned int theFirstBit, unsigned int theLastBit, ThreadPool& thePool)
+{
+	const std::size_t numberOfKeys = theKeys.size();
+	if(numberOfKeys < 2)
+	{
+		return;
+	}
+
+	const std::size_t radix = 1 << RADIX_BITS;
+	const uint64_t mask = radix - 1;
+
+	// Few large blocks, so every block is sequential in memory
+	const std::size_t minimalBlock = 1 << 16;
+	const unsigned int numberOfBlocks = static_cast<unsigned int>(std::max<std::size_t>(1,
+		std::min<std::size_t>(4 * thePool.size(), numberOfKeys / minimalBlock)));
+	const std::size_t blockSize = (numberOfKeys + numberOfBlocks - 1) / numberOfBlocks;
+
+	std::vector<uint64_t> buffer(numberOfKeys);
+	uint64_t* source = &theKeys[0];
+	uint64_t* target = &buffer[0];
+
+	// Counts and later scatter positions of digits, block after block
+	std::vector<std::size_t> positions(numberOfBlocks * radix);
+
+	for(unsigned int shift = theFirstBit; shift < theLastBit; shift += RADIX_BITS)
+	{
+		std::fill(positions.begin(), positions.end(), 0);
+
+		thePool.run(numberOfBlocks, [&](unsigned int block)
+		{
+			std::size_t* counts = &positions[block * radix];
+			const uint64_t* key = source + std::min(numberOfKeys, block * blockSize);
+			const uint64_t* end = source + std::min(numberOfKeys, (block + 1) * blockSize);
+			for( ; key != end; ++key)
+			{
+				++counts[(*key >> shift) & mask];
+			}
+		});
+
+		// Keys of digit d from block b follow keys of smaller digits
+		// and keys of digit d from earlier blocks
+		std::size_t position = 0;
+		bool sorted = false;
+		for(std::size_t digit = 0; digit < radix; ++digit)
+		{
+			std::size_t total = 0;
+			for(unsigned int block = 0; block < numberOfBlocks; ++block)
+			{
+				std::size_t count = positions[block * radix + digit];
+				positions[block * radix + digit] = position;
+				position += count;
+				total += count;
+			}
+			sorted = sorted || total == numberOfKeys;
+		}
+
+		if(sorted)
+		{
+			// All keys have the same digit
+			continue;
+		}
+
+		thePool.run(numberOfBlocks, [&](unsigned int block)
+		{
+			std::size_t* next = &positions[block * radix];
+			const uint64_t* key = source + std::min(numberOfKeys, block * blockSize);
+			const uint64_t* end = source + std::min(numberOfKeys, (block + 1) * blockSize);
+			for( ; key != end; ++key)
+			{
+				target[next[(*key >> shift) & mask]++] = *key;
+			}
+		});
+
+		std::swap(source, target);
+	}
+
+	if(source != &theKeys[0])
+	{
+		theKeys.swap(buffer);
+	}
+}
+
+}
+} // namespace terrace::util
@@ -0,0 +1,93 @@
+/******************************************************************************
+ * region.cpp
+ *
+ *
+ ******************************************************************************
+ * Copyright (c) 2014, Vladimir Pajic
+ *
+ *****************************************************************************/
+
+///////////////////////////////////////////////////////////////////////////////
+// Included dependacies
+
+#include "region.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace terrace
+{
+namespace lidar
+{
+
+Region::Region(double theMinX, double theMinY, double theMaxX, double theMaxY) :
+	mBounds(wykobi::make_rectangle(theMinX, theMinY, theMaxX, theMaxY)),
+	mPolygon()
+{
+}
+
+Region::Region(const mydefs::Points2d& thePolygon) :
+	mBounds(wykobi::make_rectangle(std::numeric_limits<double>::max(), std::numeric_limits<double>::max(),
+		-1 * std::numeric_limits<double>::max(), -1 * std::numeric_limits<double>::max())),
+	mPolygon(thePolygon)
+{
+	for(mydefs::Points2d::const_iterator it = mPolygon.begin(); it != mPolygon.end(); ++it)
+	{
+		mBounds[0].x = std::min(mBounds[0].x, (*it).x);
+		mBounds[0].y = std::min(mBounds[0].y, (*it).y);
+		mBounds[1].x = std::max(mBounds[1].x, (*it).x);
+		mBounds[1].y = std::max(mBounds[1].y, (*it).y);
+	}
+}
+
+bool Region::containedInPolygon(double theX, double theY) const
+{
+	bool inside = false;
+
+	std::size_t n = mPolygon.size();
+	for(std::size_t i = 0, j = n - 1; i < n; j = i++)
+	{
+		const wykobi::point2d<double>& a = mPolygon[i];
+		const wykobi::point2d<double>& b = mPolygon[j];
+		if((a.y > theY) != (b.y > theY)
+			&& theX < (b.x - a.x) * (theY - a.y) / (b.y - a.y) + a.x)
+		{
+			inside = !inside;
+		}
+	}
+
+	return inside;
+}
+
+bool Region::encloses(double theMinX, double theMinY, double theMaxX, double theMaxY) const
+{
+	if(theMinX < mBounds[0].x || theMaxX >= mBounds[1].x || theMinY < mBounds[0].y || theMaxY >= mBounds[1].y)
+	{
+		return false;
+	}
+
+	if(mPolygon.empty())
+	{
+		return true;
+	}
+
+	// All corners inside and no polygon vertex strictly inside the box
+	if(!containedInPolygon(theMinX, theMinY) || !containedInPolygon(theMaxX, theMinY)
+		|| !containedInPolygon(theMinX, theMaxY) || !containedInPolygon(theMaxX, theMaxY))
+	{
+		return false;
+	}
+
+	for(mydefs::Points2d::const_iterator it = mPolygon.begin(); it != mPolygon.end(); ++it)
+	{
+		if((*it).x > theMinX && (*it).x < theMaxX && (*it).y > theMinY && (*it).y < theMaxY)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+}
+} // namespace terrace::lidar
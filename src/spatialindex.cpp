@@ -0,0 +1,371 @@
+/******************************************************************************
+ * spatialindex.cpp
+ *
+ *
+ ******************************************************************************
+ * Copyright (c) 2014, Vladimir Pajic
+ *
+ *****************************************************************************/
+
+///////////////////////////////////////////////////////////////////////////////
+// Included dependacies
+
+#include "spatialindex.hpp"
+#include "datasetcache.hpp"
+#include "lidarmetadata.hpp"
+#include "mappedfile.hpp"
+#include "spacefillingcurve.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+namespace terrace
+{
+namespace lidar
+{
+
+const uint32_t SpatialIndex::VERSION;
+const unsigned int SpatialIndex::MAX_LEVEL;
+const unsigned long SpatialIndex::CELL_POINTS;
+const unsigned long SpatialIndex::MAX_GAP;
+
+namespace
+{
+
+const char MAGIC[8] = { 'T', 'R', 'I', 'N', 'D', 'E', 'X', '\0' };
+
+/// Records decoded at once while index is built
+const unsigned long BUILD_BLOCK = 1 << 16;
+
+/// Fixed size header of index file. Fields are ordered so
+/// the structure has no padding.
+struct IndexHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t headerSize;
+	uint64_t sourceSize;
+	uint64_t sourceChecksum;
+	uint64_t numberOfPoints;
+	double bounds[4];
+	uint32_t level;
+	uint32_t numberOfCells;
+	uint64_t numberOfRanges;
+};
+
+/// Column or row of cell containing the coordinate, clamped to grid
+inline uint32_t cellOf(double theCoord, double theMin, double theCellSize, uint32_t theSide)
+{
+	if(theCellSize <= 0 || theCoord < theMin)
+	{
+		return 0;
+	}
+	double cell = std::floor((theCoord - theMin) / theCellSize);
+	return cell < theSide ? static_cast<uint32_t>(cell) : theSide - 1;
+}
+
+/// Writes array of 32 bit words
+inline bool writeWords(std::FILE* theFile, const std::vector<uint32_t>& theWords)
+{
+	return theWords.empty() 
+		|| std::fwrite(&theWords[0], sizeof(uint32_t), theWords.size(), theFile) == theWords.size();
+}
+
+} // anonymous namespace
+
+SpatialIndex::SpatialIndex() :
+	mSourceSize(0),
+	mSourceChecksum(0),
+	mNumberOfPoints(0),
+	mBounds(wykobi::make_rectangle(0.0, 0.0, 0.0, 0.0)),
+	mLevel(0),
+	mCodes(),
+	mCellRanges(),
+	mRanges()
+{
+}
+
+std::string SpatialIndex::sidecarPath(const std::string& theSource)
+{
+	return theSource + ".tix";
+}
+
+bool SpatialIndex::build(const std::string& theSource)
+{
+	LasReader reader;
+	if(!reader.open(theSource) || !reader.supported())
+	{
+		return false;
+	}
+
+	if(!DatasetCache::checksum(theSource, mSourceSize, mSourceChecksum))
+	{
+		return false;
+	}
+
+	const las::Header& header = reader.header();
+	LidarMetadata metadata;
+	metadata.setFromLasHeader(header);
+
+	mNumberOfPoints = header.numberOfPoints;
+	mBounds = wykobi::make_rectangle(header.min[0], header.min[1], header.max[0], header.max[1]);
+
+	mLevel = 0;
+	while(mLevel < MAX_LEVEL && (1ULL << (2 * mLevel)) * CELL_POINTS < mNumberOfPoints)
+	{
+		++mLevel;
+	}
+
+	const uint32_t side = 1u << mLevel;
+	const double cellWidth = (mBounds[1].x - mBounds[0].x) / side;
+	const double cellHeight = (mBounds[1].y - mBounds[0].y) / side;
+
+	std::vector< std::vector<RecordRange> > cells(side * side);
+
+	PointCloud points(metadata);
+	points.resize(BUILD_BLOCK);
+	std::vector<double> xs(BUILD_BLOCK);
+	std::vector<double> ys(BUILD_BLOCK);
+	ChunkSummary summary;
+
+	for(unsigned long first = 0; first < header.numberOfPoints; first += BUILD_BLOCK)
+	{
+		unsigned long count = std::min(BUILD_BLOCK, header.numberOfPoints - first);
+		reader.readPoints(first, count, points, 0, summary);
+		points.realCoords(0, count, &xs[0], &ys[0], 0);
+
+		for(unsigned long i = 0; i < count; ++i)
+		{
+			uint32_t code = util::mortonCode(cellOf(xs[i], mBounds[0].x, cellWidth, side),
+				cellOf(ys[i], mBounds[0].y, cellHeight, side));
+
+			// Records close to the last range of cell extend it
+			std::vector<RecordRange>& ranges = cells[code];
+			unsigned long record = first + i;
+			if(!ranges.empty() && record - (ranges.back().first + ranges.back().count) <= MAX_GAP)
+			{
+				ranges.back().count = record - ranges.back().first + 1;
+			}
+			else
+			{
+				ranges.push_back(RecordRange(record, 1));
+			}
+		}
+	}
+
+	mCodes.clear();
+	mCellRanges.clear();
+	mRanges.clear();
+
+	mCellRanges.push_back(0);
+	for(uint32_t code = 0; code < cells.size(); ++code)
+	{
+		if(!cells[code].empty())
+		{
+			mCodes.push_back(code);
+			mRanges.insert(mRanges.end(), cells[code].begin(), cells[code].end());
+			mCellRanges.push_back(static_cast<uint32_t>(mRanges.size()));
+		}
+	}
+
+	return true;
+}
+
+bool SpatialIndex::write(const std::string& theIndex) const
+{
+	IndexHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.headerSize = sizeof(IndexHeader);
+	header.sourceSize = mSourceSize;
+	header.sourceChecksum = mSourceChecksum;
+	header.numberOfPoints = mNumberOfPoints;
+	header.bounds[0] = mBounds[0].x;
+	header.bounds[1] = mBounds[0].y;
+	header.bounds[2] = mBounds[1].x;
+	header.bounds[3] = mBounds[1].y;
+	header.level = mLevel;
+	header.numberOfCells = static_cast<uint32_t>(mCodes.size());
+	header.numberOfRanges = mRanges.size();
+
+	std::vector<uint32_t> ranges;
+	ranges.reserve(2 * mRanges.size());
+	for(std::vector<RecordRange>::const_iterator it = mRanges.begin(); it != mRanges.end(); ++it)
+	{
+		ranges.push_back(static_cast<uint32_t>((*it).first));
+		ranges.push_back(static_cast<uint32_t>((*it).count));
+	}
+
+	std::FILE* file = std::fopen(theIndex.c_str(), "wb");
+	if(file == 0)
+	{
+		return false;
+	}
+
+	bool result = std::fwrite(&header, 1, sizeof(header), file) == sizeof(header)
+		&& writeWords(file, mCodes)
+		&& writeWords(file, mCellRanges)
+		&& writeWords(file, ranges);
+
+	result = (std::fclose(file) == 0) && result;
+
+	if(!result)
+	{
+		std::remove(theIndex.c_str());
+	}
+
+	return result;
+}
+
+bool SpatialIndex::read(const std::string& theIndex, const std::string& theSource)
+{
+	util::MappedFile file;
+	if(!file.open(theIndex) || file.size() < sizeof(IndexHeader))
+	{
+		return false;
+	}
+
+	IndexHeader header;
+	std::memcpy(&header, file.data(), sizeof(header));
+
+	if(std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0
+		|| header.version != VERSION
+		|| header.headerSize != sizeof(IndexHeader)
+		|| header.level > MAX_LEVEL)
+	{
+		return false;
+	}
+
+	uint64_t expectedSize = sizeof(IndexHeader)
+		+ (2 * static_cast<uint64_t>(header.numberOfCells) + 1) * sizeof(uint32_t)
+		+ header.numberOfRanges * 2 * sizeof(uint32_t);
+	if(file.size() != expectedSize)
+	{
+		return false;
+	}
+
+	uint64_t sourceSize;
+	uint64_t sourceChecksum;
+	if(!DatasetCache::checksum(theSource, sourceSize, sourceChecksum)
+		|| sourceSize != header.sourceSize
+		|| sourceChecksum != header.sourceChecksum)
+	{
+		return false;
+	}
+
+	const uint32_t* codes = reinterpret_cast<const uint32_t*>(file.data() + sizeof(IndexHeader));
+	const uint32_t* cellRanges = codes + header.numberOfCells;
+	const uint32_t* ranges = cellRanges + header.numberOfCells + 1;
+
+	if(cellRanges[header.numberOfCells] != header.numberOfRanges)
+	{
+		return false;
+	}
+
+	mSourceSize = header.sourceSize;
+	mSourceChecksum = header.sourceChecksum;
+	mNumberOfPoints = header.numberOfPoints;
+	mBounds = wykobi::make_rectangle(header.bounds[0], header.bounds[1], header.bounds[2], header.bounds[3]);
+	mLevel = header.level;
+	mCodes.assign(codes, codes + header.numberOfCells);
+	mCellRanges.assign(cellRanges, cellRanges + header.numberOfCells + 1);
+
+	mRanges.clear();
+	mRanges.reserve(static_cast<std::size_t>(header.numberOfRanges));
+	for(uint64_t i = 0; i < header.numberOfRanges; ++i)
+	{
+		mRanges.push_back(RecordRange(ranges[2 * i], ranges[2 * i + 1]));
+	}
+
+	return true;
+}
+
+wykobi::rectangle<double> SpatialIndex::nodeRectangle(uint32_t theNode, unsigned int theDepth) const
+{
+	const uint32_t side = 1u << theDepth;
+	uint32_t column;
+	uint32_t row;
+	util::mortonDecode(theNode, column, row);
+	const double width = (mBounds[1].x - mBounds[0].x) / side;
+	const double height = (mBounds[1].y - mBounds[0].y) / side;
+
+	// Small margin covers rounding of cell coordinates while building
+	const double marginX = 1e-6 * width;
+	const double marginY = 1e-6 * height;
+	const double infinity = std::numeric_limits<double>::max();
+
+	return wykobi::make_rectangle(
+		column == 0 ? -infinity : mBounds[0].x + column * width - marginX,
+		row == 0 ? -infinity : mBounds[0].y + row * height - marginY,
+		column == side - 1 ? infinity : mBounds[0].x + (column + 1) * width + marginX,
+		row == side - 1 ? infinity : mBounds[0].y + (row + 1) * height + marginY);
+}
+
+void SpatialIndex::collect(const Region& theRegion,
+						   uint32_t theNode,
+						   unsigned int theDepth,
+						   std::size_t theBegin,
+						   std::size_t theEnd,
+						   std::vector<RecordRange>& theRanges) const
+{
+	if(theBegin == theEnd)
+	{
+		return;
+	}
+
+	wykobi::rectangle<double> rectangle = nodeRectangle(theNode, theDepth);
+	if(!theRegion.intersects(rectangle[0].x, rectangle[0].y, rectangle[1].x, rectangle[1].y))
+	{
+		return;
+	}
+
+	if(theDepth == mLevel || theRegion.encloses(rectangle[0].x, rectangle[0].y, rectangle[1].x, rectangle[1].y))
+	{
+		theRanges.insert(theRanges.end(), mRanges.begin() + mCellRanges[theBegin], mRanges.begin() + mCellRanges[theEnd]);
+		return;
+	}
+
+	// Children cover consecutive quarters of the codes of node
+	const unsigned int shift = 2 * (mLevel - theDepth - 1);
+	std::vector<uint32_t>::const_iterator begin = mCodes.begin() + theBegin;
+	std::vector<uint32_t>::const_iterator end = mCodes.begin() + theEnd;
+	for(uint32_t child = 4 * theNode; child < 4 * theNode + 4; ++child)
+	{
+		std::vector<uint32_t>::const_iterator childEnd = std::lower_bound(begin, end, (child + 1) << shift);
+		collect(theRegion, child, theDepth + 1, begin - mCodes.begin(), childEnd - mCodes.begin(), theRanges);
+		begin = childEnd;
+	}
+}
+
+void SpatialIndex::query(const Region& theRegion, std::vector<RecordRange>& theRanges) const
+{
+	std::vector<RecordRange> ranges;
+	collect(theRegion, 0, 0, 0, mCodes.size(), ranges);
+
+	std::sort(ranges.begin(), ranges.end(), [](const RecordRange& a, const RecordRange& b)
+	{
+		return a.first < b.first;
+	});
+
+	// Ranges of different cells may overlap, nearby ranges are read at once
+	theRanges.clear();
+	for(std::vector<RecordRange>::const_iterator it = ranges.begin(); it != ranges.end(); ++it)
+	{
+		if(!theRanges.empty() && (*it).first <= theRanges.back().first + theRanges.back().count + MAX_GAP)
+		{
+			unsigned long end = std::max(theRanges.back().first + theRanges.back().count, (*it).first + (*it).count);
+			theRanges.back().count = end - theRanges.back().first;
+		}
+		else
+		{
+			theRanges.push_back(*it);
+		}
+	}
+}
+
+}
+} // namespace terrace::lidar
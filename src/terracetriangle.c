@@ -652,9 +652,17 @@ REAL ccwerrboundA, ccwerrboundB, ccwerrboundC;
 REAL iccerrboundA, iccerrboundB, iccerrboundC;
 REAL o3derrboundA, o3derrboundB, o3derrboundC;
 
-/* Random number seed is not constant, but I've made it global anyway.       */
+/* Random number seed is not constant, but I've made it global anyway.  It  */
+/*   is kept per thread, so meshes can be built on several threads at once */
+/*   and each of them still sees the same sequence of random numbers.       */
 
-unsigned long randomseed;                     /* Current random number seed. */
+#ifdef _MSC_VER
+#define THREADLOCAL __declspec(thread)
+#else
+#define THREADLOCAL __thread
+#endif
+
+THREADLOCAL unsigned long randomseed;         /* Current random number seed. */
 
 
 //	/* Mesh data structure.  Triangle operates on only one mesh, but the mesh    */
@@ -5254,7 +5262,11 @@ vertex pc;
   REAL detleft, detright, det;
   REAL detsum, errbound;
 
-  m->counterclockcount++;
+  /* Statistics are only printed in verbose mode.  Not counting them   */
+  /*   otherwise lets point location run concurrently on a fixed mesh. */
+  if (b->verbose) {
+    m->counterclockcount++;
+  }
 
   detleft = (pa[0] - pc[0]) * (pb[1] - pc[1]);
   detright = (pa[1] - pc[1]) * (pb[0] - pc[0]);
@@ -6560,7 +6572,9 @@ int offcenter;
     /*   division by zero.                                          */
     denominator = 0.5 / counterclockwise(m, b, tdest, tapex, torg);
     /* Don't count the above as an orientation test. */
-    m->counterclockcount--;
+    if (b->verbose) {
+      m->counterclockcount--;
+    }
   }
   dx = (yao * dodist - ydo * aodist) * denominator;
   dy = (xdo * aodist - xao * dodist) * denominator;
@@ -6656,8 +6670,8 @@ struct mesh *m;
   m->incirclecount = m->counterclockcount = m->orient3dcount = 0;
   m->hyperbolacount = m->circletopcount = m->circumcentercount = 0;
   randomseed = 1;
-
-  exactinit();                     /* Initialize exact arithmetic constants. */
+  /* Exact arithmetic constants are shared by all meshes, so exactinit() is */
+  /*   called once by the caller, not for every mesh.                        */
 }
 
 /*****************************************************************************/
@@ -7652,6 +7666,7 @@ struct otri *searchtri;
   VOID **sampleblock;
   char *firsttri;
   struct otri sampletri;
+  struct otri backtracktri;
   vertex torg, tdest;
   unsigned long alignptr;
   REAL searchdist, dist;
@@ -7778,7 +7793,79 @@ struct otri *searchtri;
   if (ahead < 0.0) {
     /* Turn around so that `searchpoint' is to the left of the */
     /*   edge specified by `searchtri'.                        */
+    otricopy(*searchtri, backtracktri);
+    symself(*searchtri);
+    if (searchtri->tri == m->dummytri) {
+      /* The edge is on the convex hull, so the point lies outside. */
+      otricopy(backtracktri, *searchtri);
+      return OUTSIDE;
+    }
+  } else if (ahead == 0.0) {
+    /* Check if `searchpoint' is between `torg' and `tdest'. */
+    if (((torg[0] < searchpoint[0]) == (searchpoint[0] < tdest[0])) &&
+        ((torg[1] < searchpoint[1]) == (searchpoint[1] < tdest[1]))) {
+      return ONEDGE;
+    }
+  }
+  return preciselocate(m, b, searchpoint, searchtri, 0);
+}
+
+/*****************************************************************************/
+/*                                                                           */
+/*  hintlocate()   Find a triangle or edge containing a given point, walking */
+/*                 from a given triangle only.                               */
+/*                                                                           */
+/*  Unlike locate(), neither `recenttri' nor random samples are used, so     */
+/*  the mesh is not changed and several searches with their own `searchtri'  */
+/*  can run concurrently.  `searchtri' may be any live triangle; it is       */
+/*  oriented to fit the preconditions of preciselocate() first.  The search  */
+/*  is fast when `searchtri' is near the point, like the triangle found by   */
+/*  the previous search of a nearby point.                                   */
+/*                                                                           */
+/*  Results are the same as those of locate().                               */
+/*                                                                           */
+/*****************************************************************************/
+
+#ifdef ANSI_DECLARATORS
+enum locateresult hintlocate(struct mesh *m, struct behavior *b,
+                             vertex searchpoint, struct otri *searchtri)
+#else /* not ANSI_DECLARATORS */
+enum locateresult hintlocate(m, b, searchpoint, searchtri)
+struct mesh *m;
+struct behavior *b;
+vertex searchpoint;
+struct otri *searchtri;
+#endif /* not ANSI_DECLARATORS */
+
+{
+  struct otri backtracktri;
+  vertex torg, tdest;
+  REAL ahead;
+  triangle ptr;                         /* Temporary variable used by sym(). */
+
+  /* Where are we? */
+  org(*searchtri, torg);
+  dest(*searchtri, tdest);
+  /* Check the starting triangle's vertices. */
+  if ((torg[0] == searchpoint[0]) && (torg[1] == searchpoint[1])) {
+    return ONVERTEX;
+  }
+  if ((tdest[0] == searchpoint[0]) && (tdest[1] == searchpoint[1])) {
+    lnextself(*searchtri);
+    return ONVERTEX;
+  }
+  /* Orient `searchtri' to fit the preconditions of calling preciselocate(). */
+  ahead = counterclockwise(m, b, torg, tdest, searchpoint);
+  if (ahead < 0.0) {
+    /* Turn around so that `searchpoint' is to the left of the */
+    /*   edge specified by `searchtri'.                        */
+    otricopy(*searchtri, backtracktri);
     symself(*searchtri);
+    if (searchtri->tri == m->dummytri) {
+      /* The edge is on the convex hull, so the point lies outside. */
+      otricopy(backtracktri, *searchtri);
+      return OUTSIDE;
+    }
   } else if (ahead == 0.0) {
     /* Check if `searchpoint' is between `torg' and `tdest'. */
     if (((torg[0] < searchpoint[0]) == (searchpoint[0] < tdest[0])) &&
@@ -8789,6 +8876,196 @@ int triflaws;
   }
 }
 
+/*****************************************************************************/
+/*                                                                           */
+/*  hullflip()   Restore the Delaunay property of an edge opposite a newly   */
+/*               inserted vertex, flipping recursively as necessary.         */
+/*                                                                           */
+/*  The primary edge of `fixedge' is checked; its apex is the new vertex.    */
+/*  If the edge is not locally Delaunay it is flipped, and the two edges     */
+/*  that are exposed to the new vertex by the flip are checked in turn.      */
+/*  Flipped triangles all contain the new vertex, so triangles of its star   */
+/*  outside of the flipped wedge are left untouched.                         */
+/*                                                                           */
+/*****************************************************************************/
+
+#ifdef ANSI_DECLARATORS
+void hullflip(struct mesh *m, struct behavior *b, struct otri *fixedge)
+#else /* not ANSI_DECLARATORS */
+void hullflip(m, b, fixedge)
+struct mesh *m;
+struct behavior *b;
+struct otri *fixedge;
+#endif /* not ANSI_DECLARATORS */
+
+{
+  struct otri top;
+  struct otri otheredge;
+  vertex rightvertex, leftvertex, newvertex, farvertex;
+  triangle ptr;                         /* Temporary variable used by sym(). */
+
+  sym(*fixedge, top);
+  if (top.tri == m->dummytri) {
+    /* Edges on the convex hull are always locally Delaunay. */
+    return;
+  }
+  org(*fixedge, rightvertex);
+  dest(*fixedge, leftvertex);
+  apex(*fixedge, newvertex);
+  apex(top, farvertex);
+  if (incircle(m, b, rightvertex, leftvertex, newvertex, farvertex) > 0.0) {
+    flip(m, b, fixedge);
+    /* `fixedge' now holds the edge from `farvertex' to `newvertex'.   */
+    /*   The exposed edges are from `rightvertex' to `farvertex' and   */
+    /*   from `farvertex' to `leftvertex'.                             */
+    sym(*fixedge, otheredge);
+    lnextself(otheredge);
+    lprevself(*fixedge);
+    hullflip(m, b, fixedge);
+    hullflip(m, b, &otheredge);
+  }
+}
+
+/*****************************************************************************/
+/*                                                                           */
+/*  insertoutsidevertex()   Insert a vertex that lies outside of the convex  */
+/*                          hull into a Delaunay triangulation.              */
+/*                                                                           */
+/*  `searchtri' must be a handle whose primary edge is on the convex hull    */
+/*  and has `newvertex' strictly to its right, as returned by locate() when  */
+/*  it returns OUTSIDE.  Every hull edge that is visible from `newvertex'    */
+/*  is connected to it by a new triangle, so the hull is convex again, and   */
+/*  the covered hull edges are then flipped as necessary to maintain the     */
+/*  Delaunay property.  This makes up for insertvertex(), which can only     */
+/*  insert vertices inside of the triangulation.                             */
+/*                                                                           */
+/*  On return, `searchtri' is a handle whose origin is the new vertex.       */
+/*                                                                           */
+/*****************************************************************************/
+
+#ifdef ANSI_DECLARATORS
+void insertoutsidevertex(struct mesh *m, struct behavior *b,
+                         vertex newvertex, struct otri *searchtri)
+#else /* not ANSI_DECLARATORS */
+void insertoutsidevertex(m, b, newvertex, searchtri)
+struct mesh *m;
+struct behavior *b;
+vertex newvertex;
+struct otri *searchtri;
+#endif /* not ANSI_DECLARATORS */
+
+{
+  struct otri hulledge, testtri;
+  struct otri newtri, firsttri, lasttri;
+  struct otri fixedge, nextedge;
+  struct otri newedge, oldedge;
+  vertex hullorg, hulldest;
+  triangle ptr;                         /* Temporary variable used by sym(). */
+
+  if (b->verbose > 1) {
+    printf("  Inserting (%.12g, %.12g) outside of the convex hull.\n",
+           newvertex[0], newvertex[1]);
+  }
+
+  /* Cover the hull edge found by point location. */
+  org(*searchtri, hullorg);
+  dest(*searchtri, hulldest);
+  maketriangle(m, b, &newtri);
+  setorg(newtri, hulldest);
+  setdest(newtri, hullorg);
+  setapex(newtri, newvertex);
+  bond(newtri, *searchtri);
+  otricopy(newtri, firsttri);
+  otricopy(newtri, lasttri);
+  /* One hull edge is replaced by two. */
+  m->hullsize++;
+
+  /* Cover the following hull edges while they are visible.  The next hull */
+  /*   edge is found by spinning clockwise around the hull destination.    */
+  otricopy(*searchtri, hulledge);
+  while (1) {
+    lnextself(hulledge);
+    sym(hulledge, testtri);
+    while (testtri.tri != m->dummytri) {
+      lnext(testtri, hulledge);
+      sym(hulledge, testtri);
+    }
+    org(hulledge, hullorg);
+    dest(hulledge, hulldest);
+    if (counterclockwise(m, b, hullorg, hulldest, newvertex) >= 0.0) {
+      break;
+    }
+    maketriangle(m, b, &newtri);
+    setorg(newtri, hulldest);
+    setdest(newtri, hullorg);
+    setapex(newtri, newvertex);
+    bond(newtri, hulledge);
+    lnext(newtri, newedge);
+    lprev(lasttri, oldedge);
+    bond(newedge, oldedge);
+    otricopy(newtri, lasttri);
+    /* Two hull edges are replaced by one. */
+    m->hullsize--;
+  }
+
+  /* Cover the preceding hull edges while they are visible.  The previous */
+  /*   hull edge is found by spinning counterclockwise around the hull    */
+  /*   origin.                                                            */
+  otricopy(*searchtri, hulledge);
+  while (1) {
+    lprevself(hulledge);
+    sym(hulledge, testtri);
+    while (testtri.tri != m->dummytri) {
+      lprev(testtri, hulledge);
+      sym(hulledge, testtri);
+    }
+    org(hulledge, hullorg);
+    dest(hulledge, hulldest);
+    if (counterclockwise(m, b, hullorg, hulldest, newvertex) >= 0.0) {
+      break;
+    }
+    maketriangle(m, b, &newtri);
+    setorg(newtri, hulldest);
+    setdest(newtri, hullorg);
+    setapex(newtri, newvertex);
+    bond(newtri, hulledge);
+    lprev(newtri, newedge);
+    lnext(firsttri, oldedge);
+    bond(newedge, oldedge);
+    otricopy(newtri, firsttri);
+    m->hullsize--;
+  }
+
+  /* Restore the Delaunay property of the covered edges, walking from the */
+  /*   first new triangle to the last one.  Flips do not change the new   */
+  /*   triangles that are not yet checked.                                */
+  otricopy(firsttri, fixedge);
+  while (1) {
+    lprev(fixedge, testtri);
+    sym(testtri, nextedge);
+    hullflip(m, b, &fixedge);
+    if (nextedge.tri == m->dummytri) {
+      break;
+    }
+    lprev(nextedge, fixedge);
+  }
+
+  /* Flips keep the new vertex in every triangle they change, so the last */
+  /*   triangle still has the hull edge that leaves the new vertex.        */
+  lasttri.orient = 0;
+  org(lasttri, hullorg);
+  while (hullorg != newvertex) {
+    lnextself(lasttri);
+    org(lasttri, hullorg);
+  }
+  /* Keep a handle on the hull for point location. */
+  m->dummytri[0] = encode(lasttri);
+
+  /* Return a handle whose origin is the new vertex. */
+  otricopy(lasttri, *searchtri);
+  otricopy(lasttri, m->recenttri);
+}
+
 /*****************************************************************************/
 /*                                                                           */
 /*  triangulatepolygon()   Find the Delaunay triangulation of a polygon that */
@@ -15712,6 +15989,7 @@ char **argv;
 #endif /* not NO_TIMER */
 
   triangleinit(&m);
+  exactinit();
 #ifdef TRILIBRARY
   parsecommandline(1, &triswitches, &b);
 #else /* not TRILIBRARY */
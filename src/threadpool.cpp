@@ -0,0 +1,162 @@
+/******************************************************************************
+ * threadpool.cpp
+ *
+ *
+ ******************************************************************************
+ * Copyright (c) 2014, Vladimir Pajic
+ *
+ *****************************************************************************/
+
+///////////////////////////////////////////////////////////////////////////////
+// Included dependacies
+
+#include "threadpool.hpp"
+
+namespace terrace
+{
+namespace util
+{
+
+ThreadPool::ThreadPool(unsigned int theThreads) :
+	mTask(0),
+	mCount(0),
+	mNext(0),
+	mGeneration(0),
+	mActive(0),
+	mStop(false)
+{
+	if(theThreads == 0)
+	{
+		theThreads = hardwareThreads();
+	}
+
+	for(unsigned int i = 1; i < theThreads; ++i)
+	{
+		mWorkers.push_back(std::thread(&ThreadPool::workerLoop, this));
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStop = true;
+	}
+	mJobReady.notify_all();
+
+	for(std::vector<std::thread>::iterator it = mWorkers.begin(); it != mWorkers.end(); ++it)
+	{
+		(*it).join();
+	}
+}
+
+unsigned int ThreadPool::hardwareThreads()
+{
+	unsigned int n = std::thread::hardware_concurrency();
+	return n > 0 ? n : 1;
+}
+
+void ThreadPool::run(unsigned int theCount, const Task& theTask)
+{
+	if(theCount == 0)
+	{
+		return;
+	}
+
+	if(mWorkers.empty() || theCount == 1)
+	{
+		for(unsigned int i = 0; i < theCount; ++i)
+		{
+			theTask(i);
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mTask = &theTask;
+		mCount = theCount;
+		mNext = 0;
+		mError = std::exception_ptr();
+		mActive = static_cast<unsigned int>(mWorkers.size());
+		++mGeneration;
+	}
+	mJobReady.notify_all();
+
+	work();
+
+	std::exception_ptr error;
+	{
+		std::unique_lock<std::mutex> lock(mMutex);
+		while(mActive > 0)
+		{
+			mJobDone.wait(lock);
+		}
+		mTask = 0;
+		error = mError;
+	}
+
+	if(error)
+	{
+		std::rethrow_exception(error);
+	}
+}
+
+void ThreadPool::workerLoop()
+{
+	unsigned long generation = 0;
+
+	for(;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			while(!mStop && mGeneration == generation)
+			{
+				mJobReady.wait(lock);
+			}
+			if(mStop)
+			{
+				return;
+			}
+			generation = mGeneration;
+		}
+
+		work();
+
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			--mActive;
+		}
+		mJobDone.notify_one();
+	}
+}
+
+void ThreadPool::work()
+{
+	for(;;)
+	{
+		unsigned int i = mNext.fetch_add(1);
+		if(i >= mCount)
+		{
+			break;
+		}
+
+		try
+		{
+			(*mTask)(i);
+		}
+		catch (...)
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			if(!mError)
+			{
+				mError = std::current_exception();
+			}
+			// Skip remaining tasks
+			mNext = mCount;
+		}
+	}
+}
+
+}
+} // namespace terrace::util
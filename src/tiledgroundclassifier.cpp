@@ -0,0 +1,279 @@
+/******************************************************************************
+ * tiledgroundclassifier.cpp
+ *
+ *
+ ******************************************************************************
+ * Copyright (c) 2014, Vladimir Pajic
+ *
+ *****************************************************************************/
+
+///////////////////////////////////////////////////////////////////////////////
+// Included dependacies
+
+#include "tiledgroundclassifier.hpp"
+#include "lidardataset.hpp"
+#include "lasreader.hpp"
+#include "laswriter.hpp"
+#include "threadpool.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+namespace terrace
+{
+namespace lidar
+{
+namespace classification
+{
+
+namespace
+{
+	// Tiles classified concurrently write their messages one tile at a time
+	std::mutex logMutex;
+
+	/// Collects progress messages of tile and writes them to std::cout
+	/// when tile is done, every line prefixed with column and row of tile
+	struct TileLog
+	{
+		std::string prefix;
+		std::ostringstream messages;
+
+		TileLog(unsigned int theColumn, unsigned int theRow)
+		{
+			std::ostringstream name;
+			name << "Tile " << theColumn << "_" << theRow << ": ";
+			prefix = name.str();
+		}
+
+		~TileLog()
+		{
+			std::istringstream lines(messages.str());
+			std::ostringstream out;
+			std::string line;
+			while(std::getline(lines, line))
+			{
+				if(!line.empty())
+				{
+					out << prefix << line << "\n";
+				}
+			}
+
+			std::lock_guard<std::mutex> lock(logMutex);
+			std::cout << out.str() << std::flush;
+		}
+	};
+}
+
+TiledGroundClassifier::TiledGroundClassifier(double theTileSize, double theBuffer,
+											 double theBlockSize, double theAngleTreshold,
+											 double theDistanceTreshold, double theEdgeLengthTreshold) :
+	mSource(), mTileSize(theTileSize), mBuffer(std::max(theBuffer, 0.0)), mMinX(0.0), mMinY(0.0),
+	mColumns(0), mRows(0), mCellSize(0.0), mBlockSize(theBlockSize), mAngleTreshold(theAngleTreshold),
+	mDistanceTreshold(theDistanceTreshold), mEdgeLengthTreshold(theEdgeLengthTreshold)
+{
+}
+
+bool TiledGroundClassifier::open(const std::string& theSource)
+{
+	mColumns = mRows = 0;
+
+	if(mTileSize <= 0)
+	{
+		std::cerr << "Error: Tile size has to be greater than 0." << std::endl;
+		return false;
+	}
+
+	LasReader lasReader;
+	if(!lasReader.open(theSource))
+	{
+		std::cerr << "Error: Cannot open " << theSource << std::endl;
+		return false;
+	}
+
+	const las::Header& header = lasReader.header();
+	if(header.numberOfPoints == 0)
+	{
+		std::cerr << "Info: No points in " << theSource << std::endl;
+		return false;
+	}
+
+	mSource = theSource;
+	mMinX = header.min[0];
+	mMinY = header.min[1];
+
+	// Points on the upper and right border of bounds get a tile too
+	mColumns = static_cast<unsigned int>(std::floor((header.max[0] - mMinX) / mTileSize)) + 1;
+	mRows = static_cast<unsigned int>(std::floor((header.max[1] - mMinY) / mTileSize)) + 1;
+
+	// Average point spacing of the whole source
+	const double area = std::max((header.max[0] - mMinX) * (header.max[1] - mMinY),
+		std::numeric_limits<double>::min());
+	mCellSize = std::sqrt(area / header.numberOfPoints);
+
+	std::cout << "Classifying " << theSource << " in " << mColumns << " x " << mRows
+		<< " tiles of size " << mTileSize << " with buffer of " << mBuffer << ".\n";
+
+	return true;
+}
+
+Region TiledGroundClassifier::tileBounds(unsigned int theTile) const
+{
+	const unsigned int column = theTile % mColumns;
+	const unsigned int row = theTile / mColumns;
+	const double minX = mMinX + column * mTileSize;
+	const double minY = mMinY + row * mTileSize;
+
+	// Header bounds may not enclose all points, so border tiles
+	// take the points outside of them
+	const double infinity = std::numeric_limits<double>::max();
+
+	return Region(column == 0 ? -infinity : minX,
+		row == 0 ? -infinity : minY,
+		column == mColumns - 1 ? infinity : minX + mTileSize,
+		row == mRows - 1 ? infinity : minY + mTileSize);
+}
+
+std::string TiledGroundClassifier::tilePath(const std::string& theDestination, unsigned int theTile) const
+{
+	std::ostringstream path;
+	path << theDestination << "_" << theTile % mColumns << "_" << theTile / mColumns << ".las";
+	return path.str();
+}
+
+bool TiledGroundClassifier::classifyTile(unsigned int theTile,
+										 const std::string& theDestination,
+										 unsigned int theThreads,
+										 unsigned long& theGroundPoints) const
+{
+	theGroundPoints = 0;
+
+	if(theTile >= numberOfTiles())
+	{
+		std::cerr << "Error: There is no tile " << theTile << std::endl;
+		return false;
+	}
+
+	TileLog log(theTile % mColumns, theTile / mColumns);
+
+	const Region tile = tileBounds(theTile);
+	const Region::BoundingRectangle& bounds = tile.bounds();
+	const Region buffered(bounds[0].x - mBuffer, bounds[0].y - mBuffer,
+		bounds[1].x + mBuffer, bounds[1].y + mBuffer);
+
+	// Lowest points are enough for classification, attributes are
+	// loaded so they are written with the tile
+	LoadOptions options;
+	options.threads = theThreads;
+	options.cellSize = mCellSize;
+	options.gridMode = GridIndex::LOWEST_POINT;
+	options.attributes = PointCloud::ALL_ATTRIBUTES;
+
+	LidarDataset dataset;
+	dataset.setLog(log.messages);
+	if(!dataset.load(mSource, buffered, options))
+	{
+		// Tile and its buffer are empty
+		return false;
+	}
+
+	dataset.classifyGround(mBlockSize, mAngleTreshold, mDistanceTreshold, mEdgeLengthTreshold, theThreads);
+
+	// Buffer only supports the tile, its points are written by their own tiles
+	const PointCloud& points = dataset.points();
+	std::vector<uint32_t> owned;
+	mydefs::BoundingBox bb = wykobi::make_box(
+		std::numeric_limits<double>::max(), std::numeric_limits<double>::max(), std::numeric_limits<double>::max(),
+		-std::numeric_limits<double>::max(), -std::numeric_limits<double>::max(), -std::numeric_limits<double>::max());
+
+	for(std::size_t i = 0; i < points.size(); ++i)
+	{
+		wykobi::point3d<double> point = points.realCoords(i);
+		if(!tile.contains(point.x, point.y))
+		{
+			continue;
+		}
+
+		owned.push_back(static_cast<uint32_t>(i));
+		if(points.classification(i) == 2)
+		{
+			++theGroundPoints;
+		}
+
+		bb[0].x = std::min(bb[0].x, point.x);
+		bb[0].y = std::min(bb[0].y, point.y);
+		bb[0].z = std::min(bb[0].z, point.z);
+		bb[1].x = std::max(bb[1].x, point.x);
+		bb[1].y = std::max(bb[1].y, point.y);
+		bb[1].z = std::max(bb[1].z, point.z);
+	}
+
+	if(owned.empty())
+	{
+		// Only buffer has points
+		return false;
+	}
+
+	LidarMetadata metadata = dataset.metadata();
+	metadata.setNumberOfPoints(static_cast<unsigned long>(owned.size()));
+	metadata.setBoundingBox(bb);
+
+	PointCloud tilePoints(metadata);
+	tilePoints.setAttributes(points.attributes());
+	tilePoints.assign(points, owned);
+
+	const std::string destination = tilePath(theDestination, theTile);
+	try
+	{
+		LasWriter writer;
+		if(!writer.open(destination))
+		{
+			std::cerr << "Error: Cannot create file " << destination << std::endl;
+			return false;
+		}
+
+		util::ThreadPool pool(theThreads);
+		writer.write(metadata, tilePoints, pool);
+		writer.close();
+
+		log.messages << "Wrote " << owned.size() << " points with " << theGroundPoints 
+			<< " ground points to " << destination << ".\n";
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << "Error: " << e.what() << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+unsigned long TiledGroundClassifier::classify(const std::string& theDestination, unsigned int theTiles) const
+{
+	std::vector<unsigned long> groundPoints(numberOfTiles(), 0);
+
+	// Every tile is classified by one thread, so theTiles tiles are in memory at a time
+	util::ThreadPool pool(theTiles);
+	pool.run(numberOfTiles(), [&](unsigned int tile)
+	{
+		classifyTile(tile, theDestination, 1, groundPoints[tile]);
+	});
+
+	unsigned long total = 0;
+	for(std::vector<unsigned long>::const_iterator it = groundPoints.begin(); it != groundPoints.end(); ++it)
+	{
+		total += *it;
+	}
+
+	std::cout << "Classified " << total << " ground points in " << numberOfTiles() << " tiles.\n";
+
+	return total;
+}
+
+}
+}
+} // namespace terrace::lidar::classification
@@ -7,7 +7,9 @@
  *
  *****************************************************************************/
 
+#include <algorithm>
 #include <limits> 
+#include <mutex>
 
 #include "tin.hpp"
 #include "triangleiterator.hpp"
@@ -17,6 +19,12 @@ namespace terrace
 namespace tin
 {
 
+namespace
+{
+	// Constants of exact arithmetic are shared by all TINs
+	std::once_flag exactArithmetic;
+}
+
 TIN::TIN() : mMesh(NULL), mBehavior(NULL), mRecentTri(NULL), mMinZ(std::numeric_limits<double>::max()), mMaxZ(-1 * std::numeric_limits<double>::max())
 {
 	mMesh = new TMesh;
@@ -26,6 +34,8 @@ TIN::TIN() : mMesh(NULL), mBehavior(NULL), mRecentTri(NULL), mMinZ(std::numeric_
 	// Using incremental algorithm for triangulation
 	char * switches = {"zQ"}; 
 
+	std::call_once(exactArithmetic, exactinit);
+
 	triangleinit(mMesh);
 
 	parsecommandline(1, &switches, mBehavior);
@@ -127,19 +137,23 @@ int minus1mod3[3] = {2, 0, 1};
   vertexptr = (vertex) (otri).tri[(otri).orient + 3]
 ////////////////////////////////////////////////////////////////////////////////
 	
-	double z;
-	TVertex v;
+	double z = -1 * std::numeric_limits<double>::max();
 	TVertex t1;
 	TVertex t2;
 	TVertex t3;
 	wykobi::segment<double, 3> segment;
 	wykobi::triangle<double, 3> triangle;
 
-	v = static_cast<TVertex>(new double[2]);
-	v[0] = theX;
-	v[1] = theY;
+	if(mRecentTri->tri == NULL)
+	{
+		return z;
+	}
 
-	switch (preciselocate(mMesh, mBehavior, v, mRecentTri, 0)) {
+	// Like findTriangle, hintlocate orients the recent triangle
+	// to the point before walking from it
+	double v[2] = {theX, theY};
+
+	switch (hintlocate(mMesh, mBehavior, v, mRecentTri)) {
 		case ONVERTEX:
 			org(*mRecentTri, t1);
 			// Take elevation of vertex
@@ -173,12 +187,32 @@ int minus1mod3[3] = {2, 0, 1};
 			break;
 	}
 
-	delete [] v;
-
 	return z;
 }
 
 bool TIN::findTriangle(double theX, double theY, mydefs::Triangle3d& theTriangle3d) const
+{
+	return findTriangle(theX, theY, theTriangle3d, *mRecentTri);
+}
+
+bool TIN::findTriangle(double theX, double theY, mydefs::Triangle3d& theTriangle3d, 
+					   TOrientedTriangle& theHint) const
+{
+	bool result = false;
+
+	// Search point lives on stack, so concurrent searches do not allocate
+	double searchPoint[2] = {theX, theY};
+
+	if(theHint.tri != NULL && hintlocate(mMesh, mBehavior, searchPoint, &theHint) != OUTSIDE) 
+	{
+		triangleVertices(theHint, theTriangle3d);
+		result = true;
+	} 
+
+	return result;
+}
+
+void TIN::triangleVertices(const TOrientedTriangle& theTriangle, mydefs::Triangle3d& theTriangle3d) const
 {
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -195,54 +229,80 @@ int minus1mod3[3] = {2, 0, 1};
   vertexptr = (vertex) (otri).tri[(otri).orient + 3]
 ////////////////////////////////////////////////////////////////////////////////
 
-	bool result = false;
-
-	TVertex v;
 	TVertex t1;
 	TVertex t2;
 	TVertex t3;
 
-	v = static_cast<TVertex>(new double[2]);
+	org(theTriangle, t1);
+	dest(theTriangle, t2);
+	apex(theTriangle, t3);
+	theTriangle3d = wykobi::make_triangle(t1[0], t1[1], t1[2],
+		t2[0], t2[1], t2[2],
+		t3[0], t3[1], t3[2]);
+}
+
+bool TIN::insertVertex(double theX, double theY, double theZ)
+{
+	bool result = false;
+
+	// Vertex is owned by mesh once it is inserted
+	TVertex v = (TVertex) poolalloc(&mMesh->vertices);
 	v[0] = theX;
 	v[1] = theY;
+	v[2] = theZ;
+	((int *) v)[mMesh->vertexmarkindex] = 0;
+	((int *) v)[mMesh->vertexmarkindex + 1] = FREEVERTEX;
+
+	// Walk from the most recent triangle. Unlike insertvertex, locate 
+	// reports points outside of mesh instead of splitting hull edge. 
+	TOrientedTriangle searchTri = *mRecentTri;
+	if(searchTri.tri != NULL)
+	{
+		if(locate(mMesh, mBehavior, v, &searchTri) == OUTSIDE)
+		{
+			insertoutsidevertex(mMesh, mBehavior, v, &searchTri);
+			result = true;
+		}
+		else
+		{
+			// Point is inside of triangle or on its primary edge, so it is
+			// to the left of the next edge as insertvertex requires
+			searchTri.orient = (searchTri.orient + 1) % 3;
+
+			if(insertvertex(mMesh, mBehavior, v, &searchTri, NULL, 0, 0) == SUCCESSFULVERTEX)
+			{
+				result = true;
+			}
+		}
+	}
 
-	if(preciselocate(mMesh, mBehavior, v, mRecentTri, 0) != OUTSIDE) 
+	if(result)
 	{
-		org(*mRecentTri, t1);
-		dest(*mRecentTri, t2);
-		apex(*mRecentTri, t3);
-		theTriangle3d = wykobi::make_triangle(t1[0], t1[1], t1[2],
-			t2[0], t2[1], t2[2],
-			t3[0], t3[1], t3[2]);
-		result = true;
-	} 
+		*mRecentTri = searchTri;
 
-	delete [] v;
+		mMesh->edges = (3l * mMesh->triangles.items + mMesh->hullsize) / 2l;
 
-	return result;
-}
+		mMesh->xmin = std::min(mMesh->xmin, theX);
+		mMesh->xmax = std::max(mMesh->xmax, theX);
+		mMesh->ymin = std::min(mMesh->ymin, theY);
+		mMesh->ymax = std::max(mMesh->ymax, theY);
 
-//bool TIN::insertVertex(double theX, double theY, double theZ)
-//{
-//	bool result = false;
-//
-//	TVertex v;
-//
-//	//v = static_cast<TVertex>(new double[3]);
-//	v = (TVertex) poolalloc(&mMesh->vertices);
-//	v[0] = theX;
-//	v[1] = theY;
-//	v[2] = theZ;
-//
-//	if(insertvertex(mMesh, mBehavior, v, mRecentTri, NULL, 0, 0) == SUCCESSFULVERTEX)
-//	{
-//		result = true;
-//	}
-//
-//	pooldealloc(&mMesh->vertices, reinterpret_cast<VOID *>(v));
-//
-//	return result; 
-//}
+		if(mMinZ > theZ)
+		{
+			mMinZ = theZ;
+		}
+		if(mMaxZ < theZ)
+		{
+			mMaxZ = theZ;
+		}
+	}
+	else
+	{
+		vertexdealloc(mMesh, v);
+	}
+
+	return result; 
+}
 
 //bool TIN::deleteVertex(double theX, double theY)
 //{
@@ -0,0 +1,397 @@
+/******************************************************************************
+ * xyzreader.cpp
+ *
+ *
+ ******************************************************************************
+ * Copyright (c) 2014, Vladimir Pajic
+ *
+ *****************************************************************************/
+
+///////////////////////////////////////////////////////////////////////////////
+// Included dependacies
+
+#include "xyzreader.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace terrace
+{
+namespace lidar
+{
+
+const int XyzFormat::NO_COLUMN;
+const std::size_t XyzReader::BLOCK_SIZE;
+
+namespace
+{
+
+/// Points parsed from one block of file
+struct ParsedBlock
+{
+public:
+	const char* begin;
+	const char* end;
+	PointCloud points;
+	unsigned long malformed;
+	double min[3];
+	double max[3];
+
+	ParsedBlock(const char* theBegin, const char* theEnd) :
+		begin(theBegin), end(theEnd), points(), malformed(0)
+	{
+		for(unsigned int i = 0; i < 3; ++i)
+		{
+			min[i] = std::numeric_limits<double>::max();
+			max[i] = -1 * std::numeric_limits<double>::max();
+		}
+	}
+};
+
+inline bool isDigit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+/// Parses decimal number with optional sign, fraction and exponent.
+/// Only characters in [theBegin, theEnd) are read, so the text does
+/// not have to be terminated.
+/// \return pointer past the last parsed character, 0 if there is no number
+const char* parseDouble(const char* theBegin, const char* theEnd, double& theValue)
+{
+	// Exactly representable powers of ten
+	static const double powers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+		1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+	const char* p = theBegin;
+	bool negative = false;
+	if(p != theEnd && (*p == '-' || *p == '+'))
+	{
+		negative = *p == '-';
+		++p;
+	}
+
+	unsigned long long mantissa = 0;
+	int significant = 0;
+	int exponent = 0;
+	bool anyDigit = false;
+
+	for( ; p != theEnd && isDigit(*p); ++p)
+	{
+		anyDigit = true;
+		if(significant < 19)
+		{
+			mantissa = mantissa * 10 + (*p - '0');
+			if(mantissa != 0)
+			{
+				++significant;
+			}
+		}
+		else
+		{
+			++exponent;
+		}
+	}
+
+	if(p != theEnd && *p == '.')
+	{
+		for(++p; p != theEnd && isDigit(*p); ++p)
+		{
+			anyDigit = true;
+			if(significant < 19)
+			{
+				mantissa = mantissa * 10 + (*p - '0');
+				if(mantissa != 0)
+				{
+					++significant;
+				}
+				--exponent;
+			}
+		}
+	}
+
+	if(!anyDigit)
+	{
+		return 0;
+	}
+
+	if(p != theEnd && (*p == 'e' || *p == 'E'))
+	{
+		const char* e = p + 1;
+		bool negativeExponent = false;
+		if(e != theEnd && (*e == '-' || *e == '+'))
+		{
+			negativeExponent = *e == '-';
+			++e;
+		}
+		if(e != theEnd && isDigit(*e))
+		{
+			int value = 0;
+			for( ; e != theEnd && isDigit(*e); ++e)
+			{
+				if(value < 10000)
+				{
+					value = value * 10 + (*e - '0');
+				}
+			}
+			exponent += negativeExponent ? -value : value;
+			p = e;
+		}
+	}
+
+	double result = static_cast<double>(mantissa);
+	if(exponent >= 0 && exponent <= 22)
+	{
+		result *= powers[exponent];
+	}
+	else if(exponent < 0 && exponent >= -22)
+	{
+		result /= powers[-exponent];
+	}
+	else
+	{
+		result *= std::pow(10.0, exponent);
+	}
+
+	theValue = negative ? -result : result;
+	return p;
+}
+
+/// Parses unsigned integer not greater than theMax.
+/// \return pointer past the last parsed character, 0 if there is no number
+const char* parseUnsigned(const char* theBegin, const char* theEnd, unsigned long theMax, unsigned long& theValue)
+{
+	const char* p = theBegin;
+	unsigned long value = 0;
+	for( ; p != theEnd && isDigit(*p); ++p)
+	{
+		value = value * 10 + (*p - '0');
+		if(value > theMax)
+		{
+			return 0;
+		}
+	}
+	theValue = value;
+	return p == theBegin ? 0 : p;
+}
+
+/// Parses one line into real coordinates, class and intensity.
+/// \return true if all mapped columns are present and valid
+bool parseLine(const char* theBegin,
+			   const char* theEnd,
+			   const XyzFormat& theFormat,
+			   int theLastColumn,
+			   double theCoords[3],
+			   unsigned char& theClass,
+			   uint16_t& theIntensity)
+{
+	const char* delimBegin = theFormat.delimiters.data();
+	const char* delimEnd = delimBegin + theFormat.delimiters.size();
+
+	const char* field = theBegin;
+	for(int column = 0; column <= theLastColumn; ++column)
+	{
+		if(field > theEnd)
+		{
+			return false;
+		}
+
+		const char* fieldEnd = std::find_first_of(field, theEnd, delimBegin, delimEnd);
+
+		if(column == theFormat.x || column == theFormat.y || column == theFormat.z)
+		{
+			double value;
+			if(parseDouble(field, fieldEnd, value) != fieldEnd)
+			{
+				return false;
+			}
+			theCoords[column == theFormat.x ? 0 : (column == theFormat.y ? 1 : 2)] = value;
+		}
+		else if(column == theFormat.classification || column == theFormat.intensity)
+		{
+			unsigned long value;
+			unsigned long max = column == theFormat.classification ? 255 : 65535;
+			if(parseUnsigned(field, fieldEnd, max, value) != fieldEnd)
+			{
+				return false;
+			}
+			if(column == theFormat.classification)
+			{
+				theClass = static_cast<unsigned char>(value);
+			}
+			else
+			{
+				theIntensity = static_cast<uint16_t>(value);
+			}
+		}
+
+		field = fieldEnd + 1;
+		if(theFormat.mergeDelimiters)
+		{
+			while(field < theEnd && std::find(delimBegin, delimEnd, *field) != delimEnd)
+			{
+				++field;
+			}
+		}
+	}
+
+	return true;
+}
+
+/// Parses all lines of the block
+void parseBlock(const LidarMetadata& theMetadata, const XyzFormat& theFormat, ParsedBlock& theBlock)
+{
+	int lastColumn = std::max(std::max(theFormat.x, theFormat.y),
+		std::max(theFormat.z, std::max(theFormat.classification, theFormat.intensity)));
+
+	theBlock.points.setMetadata(theMetadata);
+	const bool intensity = theFormat.intensity != XyzFormat::NO_COLUMN;
+	theBlock.points.setAttributes(intensity ? PointCloud::INTENSITY : 0);
+
+	// Rough guess of line length to avoid most reallocations
+	theBlock.points.reserve((theBlock.end - theBlock.begin) / 24 + 1);
+
+	const char* line = theBlock.begin;
+	while(line < theBlock.end)
+	{
+		const char* lineEnd = static_cast<const char*>(std::memchr(line, '\n', theBlock.end - line));
+		if(lineEnd == 0)
+		{
+			lineEnd = theBlock.end;
+		}
+
+		const char* contentEnd = lineEnd;
+		if(contentEnd != line && *(contentEnd - 1) == '\r')
+		{
+			--contentEnd;
+		}
+
+		const char* content = line;
+		if(theFormat.mergeDelimiters)
+		{
+			while(content < contentEnd
+				&& theFormat.delimiters.find(*content) != std::string::npos)
+			{
+				++content;
+			}
+		}
+
+		if(content != contentEnd)
+		{
+			double coords[3];
+			unsigned char cls = 0;
+			uint16_t intensityValue = 0;
+			if(parseLine(content, contentEnd, theFormat, lastColumn, coords, cls, intensityValue))
+			{
+				std::size_t index = theBlock.points.size();
+				theBlock.points.add(0, 0, 0, cls);
+				theBlock.points[index].setFromRealCoords(wykobi::make_point(coords[0], coords[1], coords[2]));
+				if(intensity)
+				{
+					theBlock.points.intensityData()[index] = intensityValue;
+				}
+				for(unsigned int i = 0; i < 3; ++i)
+				{
+					theBlock.min[i] = std::min(theBlock.min[i], coords[i]);
+					theBlock.max[i] = std::max(theBlock.max[i], coords[i]);
+				}
+			}
+			else
+			{
+				++theBlock.malformed;
+			}
+		}
+
+		line = lineEnd + 1;
+	}
+}
+
+} // anonymous namespace
+
+bool XyzReader::open(const std::string& theSource)
+{
+	mMalformedLines = 0;
+	return mFile.open(theSource);
+}
+
+unsigned long XyzReader::readPoints(const LidarMetadata& theMetadata,
+									const XyzFormat& theFormat,
+									util::ThreadPool& thePool,
+									PointCloud& thePoints,
+									mydefs::BoundingBox& theBoundingBox)
+{
+	mMalformedLines = 0;
+
+	// Split file into blocks that end at line boundaries
+	std::vector<ParsedBlock> blocks;
+	const char* begin = mFile.data();
+	const char* fileEnd = mFile.data() + mFile.size();
+	while(begin < fileEnd)
+	{
+		const char* end = begin + std::min(BLOCK_SIZE, static_cast<std::size_t>(fileEnd - begin));
+		if(end < fileEnd)
+		{
+			const char* newline = static_cast<const char*>(std::memchr(end, '\n', fileEnd - end));
+			end = newline != 0 ? newline + 1 : fileEnd;
+		}
+		blocks.push_back(ParsedBlock(begin, end));
+		begin = end;
+	}
+
+	thePool.run(static_cast<unsigned int>(blocks.size()), [&](unsigned int i)
+	{
+		parseBlock(theMetadata, theFormat, blocks[i]);
+	});
+
+	// Merge blocks in file order
+	std::vector<std::size_t> offsets(blocks.size() + 1, thePoints.size());
+	double min[3];
+	double max[3];
+	for(unsigned int i = 0; i < 3; ++i)
+	{
+		min[i] = std::numeric_limits<double>::max();
+		max[i] = -1 * std::numeric_limits<double>::max();
+	}
+
+	for(std::size_t i = 0; i < blocks.size(); ++i)
+	{
+		offsets[i + 1] = offsets[i] + blocks[i].points.size();
+		mMalformedLines += blocks[i].malformed;
+		for(unsigned int j = 0; j < 3; ++j)
+		{
+			min[j] = std::min(min[j], blocks[i].min[j]);
+			max[j] = std::max(max[j], blocks[i].max[j]);
+		}
+	}
+
+	thePoints.resize(offsets.back());
+
+	thePool.run(static_cast<unsigned int>(blocks.size()), [&](unsigned int i)
+	{
+		const PointCloud& block = blocks[i].points;
+		std::size_t count = block.size();
+		if(count > 0)
+		{
+			std::copy(block.xData(), block.xData() + count, thePoints.xData() + offsets[i]);
+			std::copy(block.yData(), block.yData() + count, thePoints.yData() + offsets[i]);
+			std::copy(block.zData(), block.zData() + count, thePoints.zData() + offsets[i]);
+			std::copy(block.classificationData(), block.classificationData() + count,
+				thePoints.classificationData() + offsets[i]);
+			if(block.hasAttributes(PointCloud::INTENSITY) && thePoints.hasAttributes(PointCloud::INTENSITY))
+			{
+				std::copy(block.intensityData(), block.intensityData() + count,
+					thePoints.intensityData() + offsets[i]);
+			}
+		}
+		blocks[i].points.release();
+	});
+
+	theBoundingBox = wykobi::make_box(min[0], min[1], min[2], max[0], max[1], max[2]);
+
+	return static_cast<unsigned long>(offsets.back() - offsets.front());
+}
+
+}
+} // namespace terrace::lidar
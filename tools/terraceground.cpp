@@ -0,0 +1,124 @@
+/******************************************************************************
+ * terraceground.cpp
+ *
+ * Project:  terrace - A library for processing of Lidar
+ *           data.
+ * Purpose:  Command line tool that classifies ground points of LAS
+ *           file in tiles. A single tile can be given, so tiles can
+ *           be shared out among separate processes.
+ * Author:   Vladimir Pajic, pajicv@gmail.com
+ *
+ ******************************************************************************
+ * Copyright (c) 2014, Vladimir Pajic
+ *
+ *****************************************************************************/
+
+///////////////////////////////////////////////////////////////////////////////
+// Included dependacies
+
+#include "tiledgroundclassifier.hpp"
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+namespace
+{
+	// Defaults of classification thresholds
+	
+	/// Block size of LidarDataset::classifyGround
+	const double DEFAULT_BLOCK_SIZE = 10.0;
+
+	/// Largest angle in degrees between TIN triangle and the
+	/// line from its vertex to ground point
+	const double DEFAULT_ANGLE = 6.0;
+
+	/// Largest distance of ground point from TIN triangle
+	const double DEFAULT_DISTANCE = 1.0;
+
+	/// Triangles with shorter longest edge get reduced angle
+	const double DEFAULT_EDGE_LENGTH = 5.0;
+
+	void usage()
+	{
+		std::cerr << "Usage: terraceground [-b block] [-a angle] [-d distance] [-e edge]\n"
+			<< "                     file.las prefix tilesize buffer [threads [tile]]\n"
+			<< "  -b block     block size (default " << DEFAULT_BLOCK_SIZE << ")\n"
+			<< "  -a angle     angle threshold in degrees (default " << DEFAULT_ANGLE << ")\n"
+			<< "  -d distance  distance threshold (default " << DEFAULT_DISTANCE << ")\n"
+			<< "  -e edge      edge length threshold (default " << DEFAULT_EDGE_LENGTH << ")" << std::endl;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	double blockSize = DEFAULT_BLOCK_SIZE;
+	double angle = DEFAULT_ANGLE;
+	double distance = DEFAULT_DISTANCE;
+	double edgeLength = DEFAULT_EDGE_LENGTH;
+
+	// Options precede positional arguments
+	int first = 1;
+	for( ; first + 1 < argc && argv[first][0] == '-' && argv[first][1] != '\0' && argv[first][2] == '\0'; first += 2)
+	{
+		double value = std::atof(argv[first + 1]);
+		switch(argv[first][1])
+		{
+			case 'b':
+				blockSize = value;
+				break;
+			case 'a':
+				angle = value;
+				break;
+			case 'd':
+				distance = value;
+				break;
+			case 'e':
+				edgeLength = value;
+				break;
+			default:
+				usage();
+				return 1;
+		}
+	}
+
+	argc -= first - 1;
+	argv += first - 1;
+
+	if(argc < 5)
+	{
+		usage();
+		return 1;
+	}
+
+	std::string source(argv[1]);
+	std::string prefix(argv[2]);
+	double tileSize = std::atof(argv[3]);
+	double buffer = std::atof(argv[4]);
+	unsigned int threads = argc > 5 ? static_cast<unsigned int>(std::atoi(argv[5])) : 1;
+
+	terrace::lidar::classification::TiledGroundClassifier classifier(tileSize, buffer, 
+		blockSize, angle, distance, edgeLength);
+	if(!classifier.open(source))
+	{
+		return 1;
+	}
+
+	if(argc > 6)
+	{
+		unsigned int tile = static_cast<unsigned int>(std::atoi(argv[6]));
+		unsigned long groundPoints = 0;
+		if(!classifier.classifyTile(tile, prefix, threads, groundPoints))
+		{
+			std::cerr << "Info: Nothing written for tile " << tile << std::endl;
+			return 1;
+		}
+
+		std::cout << classifier.tilePath(prefix, tile) << ": " << groundPoints << " ground points\n";
+		return 0;
+	}
+
+	classifier.classify(prefix, threads);
+
+	return 0;
+}
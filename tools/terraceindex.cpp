@@ -0,0 +1,59 @@
+/******************************************************************************
+ * terraceindex.cpp
+ *
+ * Project:  terrace - A library for processing of Lidar
+ *           data.
+ * Purpose:  Command line tool that builds sidecar spatial index
+ *           next to each of the given LAS files.
+ * Author:   Vladimir Pajic, pajicv@gmail.com
+ *
+ ******************************************************************************
+ * Copyright (c) 2014, Vladimir Pajic
+ *
+ *****************************************************************************/
+
+///////////////////////////////////////////////////////////////////////////////
+// Included dependacies
+
+#include "spatialindex.hpp"
+
+#include <iostream>
+#include <string>
+
+int main(int argc, char* argv[])
+{
+	if(argc < 2)
+	{
+		std::cerr << "Usage: terraceindex file.las [file.las ...]" << std::endl;
+		return 1;
+	}
+
+	int failed = 0;
+
+	for(int i = 1; i < argc; ++i)
+	{
+		std::string source(argv[i]);
+		std::string index = terrace::lidar::SpatialIndex::sidecarPath(source);
+
+		terrace::lidar::SpatialIndex spatialIndex;
+		if(!spatialIndex.build(source))
+		{
+			std::cerr << "Error: Cannot index " << source << std::endl;
+			++failed;
+			continue;
+		}
+
+		if(!spatialIndex.write(index))
+		{
+			std::cerr << "Error: Cannot write " << index << std::endl;
+			++failed;
+			continue;
+		}
+
+		std::cout << index << ": level " << spatialIndex.level()
+			<< ", " << spatialIndex.numberOfCells() << " cells"
+			<< ", " << spatialIndex.numberOfRanges() << " ranges\n";
+	}
+
+	return failed == 0 ? 0 : 1;
+}